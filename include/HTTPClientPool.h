@@ -0,0 +1,120 @@
+//============================================================================================================================= 132
+//
+//  HTTPClientPool.h
+//
+//      Warm keep-alive HTTPClient connections, keyed by "ip:port".
+//
+//      Acquire() hands out the most recently released idle connection for the host (after checking that the server has
+//      not closed it in the meantime) or connects a new one; Release() puts it back.  Hosts are spread over independent
+//      shards so threads talking to different upstreams never share a lock, and no lock is held across connect() or
+//      the staleness probe.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "Socket.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// idle connections kept per host, how long (uS) one may sit idle, and the number of lock shards
+#define HTTP_POOL_MAX_IDLE      32
+#define HTTP_POOL_IDLE_TIMEOUT  (30 * 1000 * 1000)
+#define HTTP_POOL_SHARDS        16
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class HTTPClientPool
+{
+    public:
+                                HTTPClientPool
+                                (
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout,
+                                    uint32_t            u32MaxIdlePerHost = HTTP_POOL_MAX_IDLE,
+                                    int64_t             i64IdleTimeout = HTTP_POOL_IDLE_TIMEOUT
+                                );
+                                // closes the idle connections; those still acquired belong to their callers
+        virtual                 ~HTTPClientPool();
+
+                                // a live idle connection to the host if there is one, otherwise a freshly connected one
+        virtual HTTPClient *    Acquire(const std::string& strIPAddr, uint16_t u16Port);
+                                // bReusable false - e.g. the response was not read to its end - closes it instead
+        virtual void            Release(HTTPClient * pClient, bool bReusable = true);
+                                // close connections idle longer than the idle timeout; returns how many
+        virtual size_t          Prune();
+
+        virtual size_t          GetNumIdle();
+
+        static const std::string Key(const std::string& strIPAddr, uint16_t u16Port)
+                                { return InetSocket::AddrString(strIPAddr, u16Port); }
+
+    protected:
+
+        struct Idle
+        {
+            HTTPClient        * pClient;
+            int64_t             i64Since;
+        };
+
+        struct Shard
+        {
+            libthrocket::Mutex  m_CSLocal;
+            std::map<std::string, std::vector<Idle> > mapIdle;     // oldest first
+        };
+
+        Shard &                 GetShard(const std::string& strKey);
+
+    private:
+
+        int64_t                 m_i64RecvTimeout;
+        int64_t                 m_i64SendTimeout;
+        uint32_t                m_u32MaxIdlePerHost;
+        int64_t                 m_i64IdleTimeout;
+        Shard                   m_aShards[HTTP_POOL_SHARDS];
+
+                                // disallow default construction / copy constructors
+                                HTTPClientPool();
+                                HTTPClientPool(const HTTPClientPool &);
+        void                    operator=(const HTTPClientPool &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
@@ -0,0 +1,288 @@
+//============================================================================================================================= 132
+//
+//  HTTPParser.h
+//
+//      Incremental, allocation-free HTTP/1.1 message parsing.
+//
+//      Feed bytes as they arrive with Parse(); the parser calls back with the status or request line, each header, and
+//      body data as it is framed (Content-Length, chunked, or - responses only - read-until-close).  Header lines are
+//      assembled in a fixed buffer inside the parser and body bytes are handed straight out of the caller's buffer, so
+//      nothing is allocated and a body of any size streams through.  Parse() stops at the end of a message and returns
+//      how much it consumed; the remainder belongs to the next message on the connection.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Exception.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,HTTPParser)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPParser,Syntax)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPParser,Overflow)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPParser,Truncated)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// longest status/header/chunk-size line accepted
+#define HTTP_PARSER_LINE_MAX    8192
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement the parts you need - pointers are only valid for the duration of the call
+class HTTPResponseHandler
+{
+    public:
+                                HTTPResponseHandler()
+                                {}
+        virtual                 ~HTTPResponseHandler()
+                                {}
+
+        virtual void            OnStatus(uint32_t u32Status, const char* pcReason, size_t uReasonLen)
+                                { (void) u32Status; (void) pcReason; (void) uReasonLen; }
+                                // chunked trailers arrive here too, after the body
+        virtual void            OnHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen)
+                                { (void) pcName; (void) uNameLen; (void) pcValue; (void) uValueLen; }
+        virtual void            OnHeadersComplete()
+                                {}
+        virtual void            OnBody(const uint8_t* pu8Bytes, size_t uBytes)
+                                { (void) pu8Bytes; (void) uBytes; }
+        virtual void            OnComplete()
+                                {}
+
+    private:
+                                // disallow copy constructors
+                                HTTPResponseHandler(const HTTPResponseHandler &);
+        void                    operator=(const HTTPResponseHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement the parts you need - pointers are only valid for the duration of the call
+class HTTPRequestHandler
+{
+    public:
+                                HTTPRequestHandler()
+                                {}
+        virtual                 ~HTTPRequestHandler()
+                                {}
+
+        virtual void            OnRequestLine(const char* pcMethod, size_t uMethodLen, const char* pcTarget, size_t uTargetLen)
+                                { (void) pcMethod; (void) uMethodLen; (void) pcTarget; (void) uTargetLen; }
+        virtual void            OnHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen)
+                                { (void) pcName; (void) uNameLen; (void) pcValue; (void) uValueLen; }
+        virtual void            OnHeadersComplete()
+                                {}
+        virtual void            OnBody(const uint8_t* pu8Bytes, size_t uBytes)
+                                { (void) pu8Bytes; (void) uBytes; }
+        virtual void            OnComplete()
+                                {}
+
+    private:
+                                // disallow copy constructors
+                                HTTPRequestHandler(const HTTPRequestHandler &);
+        void                    operator=(const HTTPRequestHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// line assembly, headers and body framing shared by the request and response parsers
+class HTTPMessageParser
+{
+    public:
+        virtual                 ~HTTPMessageParser()
+                                {}
+
+                                // returns the bytes consumed - less than uBytes only once the message is complete
+        size_t                  Parse(const uint8_t* pu8Bytes, size_t uBytes);
+                                // the peer closed - ends a read-until-close body, throws if the message is cut short
+        void                    ParseEOF();
+
+        bool                    IsComplete() const
+                                { return m_eState == eDone; }
+                                // nothing of the message seen yet
+        bool                    IsIdle() const
+                                { return m_eState == eStartLine && m_bStarted == false && m_uLineLen == 0; }
+                                // the connection may carry another message once this one is complete
+        bool                    IsKeepAlive() const
+                                { return m_bKeepAlive && m_eBody != eBodyUntilClose; }
+        uint64_t                GetBodyBytes() const
+                                { return m_u64BodyBytes; }
+                                // the body length the headers declared - 0 when chunked or unframed; from OnHeadersComplete()
+        uint64_t                GetContentLength() const
+                                { return m_eBody == eBodyLength ? m_u64ContentLength : 0; }
+
+    protected:
+
+        enum eState
+        {
+            eStartLine,
+            eHeaderLine,
+            eBodyFixed,
+            eChunkSize,
+            eChunkData,
+            eChunkEnd,
+            eTrailerLine,
+            eBodyClose,
+            eDone
+        };
+
+        enum eBody
+        {
+            eBodyNone,
+            eBodyLength,
+            eBodyChunked,
+            eBodyUntilClose
+        };
+
+                                HTTPMessageParser()
+                                { ResetMessage(false); }
+
+        void                    ResetMessage(bool bNoBody);
+
+                                // false until a whole line is in m_acLine
+        bool                    TakeLine(const uint8_t* & pu8Bytes, const uint8_t* pu8End);
+                                // "HTTP/1.x" at pcVersion - sets m_bHTTP11 and the default m_bKeepAlive
+        bool                    ParseVersion(const char* pcVersion);
+        void                    ResetFraming();
+        void                    ParseHeaderLine(bool bTrailer);
+        void                    ParseChunkSize();
+                                // settles m_eBody from the headers before they are reported complete
+        void                    ResolveFraming(bool bUntilClose);
+                                // after the headers - chunked, Content-Length, or bUntilClose / no body
+        void                    FrameBody(bool bUntilClose);
+        void                    Complete();
+
+                                // the first line is in m_acLine
+        virtual void            ParseStartLine()                                                        =   0;
+                                // the blank line after the headers has arrived - report it and call FrameBody()
+        virtual void            HeadersComplete()                                                       =   0;
+        virtual void            EmitHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen) = 0;
+        virtual void            EmitBody(const uint8_t* pu8Bytes, size_t uBytes)                        =   0;
+        virtual void            EmitComplete()                                                          =   0;
+
+        enum eState             m_eState;
+        enum eBody              m_eBody;
+        bool                    m_bStarted;
+        bool                    m_bNoBody;
+        bool                    m_bKeepAlive;
+        bool                    m_bHTTP11;
+        bool                    m_bHaveLength;
+        bool                    m_bHaveTE;
+        bool                    m_bTEChunked;           // the last Transfer-Encoding coding seen is chunked
+        uint64_t                m_u64ContentLength;
+        uint64_t                m_u64Remaining;         // in the current fixed body or chunk
+        uint64_t                m_u64BodyBytes;
+        size_t                  m_uLineLen;
+        char                    m_acLine[HTTP_PARSER_LINE_MAX];
+
+    private:
+                                // disallow copy constructors
+                                HTTPMessageParser(const HTTPMessageParser &);
+        void                    operator=(const HTTPMessageParser &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class HTTPResponseParser    :   public HTTPMessageParser
+{
+    public:
+                                HTTPResponseParser(HTTPResponseHandler * pHandler = NULL)
+                                { Reset(pHandler); }
+        virtual                 ~HTTPResponseParser()
+                                {}
+
+                                // ready for the next response; bNoBody for the response to a HEAD request
+        void                    Reset(HTTPResponseHandler * pHandler, bool bNoBody = false);
+
+        uint32_t                GetStatus() const
+                                { return m_u32Status; }
+
+    protected:
+
+        virtual void            ParseStartLine();
+        virtual void            HeadersComplete();
+        virtual void            EmitHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen)
+                                { m_pHandler->OnHeader(pcName, uNameLen, pcValue, uValueLen); }
+        virtual void            EmitBody(const uint8_t* pu8Bytes, size_t uBytes)
+                                { m_pHandler->OnBody(pu8Bytes, uBytes); }
+        virtual void            EmitComplete()
+                                { m_pHandler->OnComplete(); }
+
+    private:
+
+        HTTPResponseHandler   * m_pHandler;
+        uint32_t                m_u32Status;
+
+                                // disallow copy constructors
+                                HTTPResponseParser(const HTTPResponseParser &);
+        void                    operator=(const HTTPResponseParser &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// requests without Content-Length or chunked encoding have no body
+class HTTPRequestParser     :   public HTTPMessageParser
+{
+    public:
+                                HTTPRequestParser(HTTPRequestHandler * pHandler = NULL)
+                                { Reset(pHandler); }
+        virtual                 ~HTTPRequestParser()
+                                {}
+
+                                // ready for the next request
+        void                    Reset(HTTPRequestHandler * pHandler);
+
+    protected:
+
+        virtual void            ParseStartLine();
+        virtual void            HeadersComplete();
+        virtual void            EmitHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen)
+                                { m_pHandler->OnHeader(pcName, uNameLen, pcValue, uValueLen); }
+        virtual void            EmitBody(const uint8_t* pu8Bytes, size_t uBytes)
+                                { m_pHandler->OnBody(pu8Bytes, uBytes); }
+        virtual void            EmitComplete()
+                                { m_pHandler->OnComplete(); }
+
+    private:
+
+        HTTPRequestHandler    * m_pHandler;
+
+                                // disallow copy constructors
+                                HTTPRequestParser(const HTTPRequestParser &);
+        void                    operator=(const HTTPRequestParser &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
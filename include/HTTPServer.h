@@ -0,0 +1,232 @@
+//============================================================================================================================= 132
+//
+//  HTTPServer.h
+//
+//      Small embedded HTTP/1.1 server - status pages, metrics scrapes and the like.
+//
+//      One thread runs a Reactor that accepts connections and parses requests incrementally as bytes arrive.  A complete
+//      request is handed to a fixed pool of worker threads, which call the matching route handler and write the
+//      response.  While a worker owns a connection the Reactor stops watching it; afterwards it is re-armed for the next
+//      request (keep-alive), so an idle connection costs a map entry and no thread.  When every worker is busy and the
+//      queue is full new requests get 503 instead of piling up.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Exception.h"
+#include "HTTPParser.h"
+#include "Reactor.h"
+#include "Socket.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,HTTPServer)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPServer,Param)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPServer,Init)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPServer,TooLarge)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// defaults - worker threads, requests waiting for a worker before 503, how long (uS) a response write may take, largest
+// request body, how long (uS) a keep-alive connection may sit idle, how long (uS) a request may take to arrive from its
+// first byte (however steadily it trickles in), how often (uS) the server threads look for idle connections and stop
+// requests, receive buffer
+#define HTTP_SERVER_WORKERS         4
+#define HTTP_SERVER_MAX_QUEUE       1024
+#define HTTP_SERVER_SEND_TIMEOUT    (5 * 1000 * 1000)
+#define HTTP_SERVER_MAX_BODY        (1024 * 1024)
+#define HTTP_SERVER_IDLE_TIMEOUT    (15 * 1000 * 1000)
+#define HTTP_SERVER_REQUEST_TIMEOUT (30 * 1000 * 1000)
+#define HTTP_SERVER_POLL            (100 * 1000)
+#define HTTP_SERVER_RECV_BUF        (16 * 1024)
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+struct HTTPServerRequest
+{
+    std::string                 strMethod;
+    std::string                 strTarget;              // as sent, e.g. "/metrics?format=text"
+    std::string                 strPath;                // up to '?'
+    std::string                 strQuery;               // after '?'
+    std::vector<std::pair<std::string, std::string> > vecHeaders;
+    std::string                 strBody;
+    std::string                 strPeer;
+    bool                        bKeepAlive;
+
+                                // first header of that name (case-insensitive), NULL if none
+    const std::string *         GetHeader(const char* pcName) const;
+    void                        clear();
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// Content-Length and Connection are filled in by the server
+struct HTTPServerResponse
+{
+    uint32_t                    u32Status;
+    std::vector<std::pair<std::string, std::string> > vecHeaders;
+    std::string                 strBody;
+
+    void                        AddHeader(const std::string& strName, const std::string& strValue)
+                                { vecHeaders.push_back(std::make_pair(strName, strValue)); }
+    void                        clear()
+                                { u32Status = 200; vecHeaders.clear(); strBody.clear(); }
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - called concurrently from every worker thread
+class HTTPRouteHandler
+{
+    public:
+                                HTTPRouteHandler()
+                                {}
+        virtual                 ~HTTPRouteHandler()
+                                {}
+
+                                // rsp arrives as an empty 200; throwing a libthrocket::Exception answers 500
+        virtual void            OnRequest(const HTTPServerRequest & req, HTTPServerResponse & rsp)  =   0;
+
+    private:
+                                // disallow copy constructors
+                                HTTPRouteHandler(const HTTPRouteHandler &);
+        void                    operator=(const HTTPRouteHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class HTTPServer            :   public ThreadMother, public ReactorHandler
+{
+    friend class HTTPServerReactorThread;
+    friend class HTTPServerWorkerThread;
+
+    public:
+                                // u32Workers and u32MaxQueue must be at least 1 - no workers would queue forever, no queue
+                                // would answer every request 503
+                                HTTPServer
+                                (
+                                    uint32_t            u32Workers = HTTP_SERVER_WORKERS,
+                                    uint32_t            u32MaxQueue = HTTP_SERVER_MAX_QUEUE,
+                                    int64_t             i64SendTimeout = HTTP_SERVER_SEND_TIMEOUT,
+                                    int64_t             i64IdleTimeout = HTTP_SERVER_IDLE_TIMEOUT,
+                                    uint32_t            u32MaxBody = HTTP_SERVER_MAX_BODY,
+                                    int64_t             i64RequestTimeout = HTTP_SERVER_REQUEST_TIMEOUT
+                                );
+        virtual                 ~HTTPServer();
+
+                                // before Start() - strMethod "" matches any method, a strPath ending in '*' is a prefix;
+                                // the first matching route wins and no match is a 404
+        virtual void            Route(const std::string& strMethod, const std::string& strPath, HTTPRouteHandler * pHandler);
+
+                                // a server wants a real backlog - listen(0) drops bursts of connects
+        virtual void            Bind(const std::string& strIPAddr, uint16_t u16Port, int nListenLen = SOMAXCONN);
+        virtual void            Start();
+                                // closes every connection; the listener stays bound for another Start()
+        virtual void            Stop();
+
+        virtual uint16_t        GetDecodedLocalPort();
+        virtual size_t          GetNumConnections()
+                                { libthrocket::Lock l(&m_CSLocal); return m_mapConnections.size(); }
+
+    protected:
+
+        struct Connection;
+
+        struct RouteEntry
+        {
+            std::string         strMethod;
+            std::string         strPath;
+            bool                bPrefix;
+            HTTPRouteHandler  * pHandler;
+        };
+
+                                // taken before the Reactor's own lock, never after - a worker re-arms a connection holding it
+        libthrocket::Mutex      m_CSLocal;
+
+                                // Reactor callbacks - the listener or a connection between requests
+        virtual void            OnReadable(Socket * pSocket);
+        virtual void            OnWritable(Socket * pSocket);
+
+                                // one Reactor pass plus the idle sweep; reactor thread
+        void                    Service();
+                                // take the next queued request, if any within i64Timeout; worker threads
+        void                    Work(int64_t i64Timeout);
+
+        void                    AcceptConnections();
+        void                    ReadConnection(Connection * pConn);
+                                // false when the buffered bytes do not yet hold a whole request
+        bool                    ParseConnection(Connection * pConn);
+                                // output the server makes up itself - without waiting, and what is left of it ahead of a response
+        bool                    WritePending(Connection * pConn);
+        void                    FinishPending(Connection * pConn);
+        void                    DispatchConnection(Connection * pConn);
+        void                    ServeConnection(Connection * pConn);
+        void                    SweepConnections();
+        void                    CloseConnection(Connection * pConn);
+
+        HTTPRouteHandler *      FindRoute(const HTTPServerRequest & req);
+                                // writes status line, headers and body in one gathered send
+        void                    SendResponse(Connection * pConn, const HTTPServerResponse & rsp, bool bKeepAlive);
+                                // for responses the server makes up itself (400, 413, 503, ...) - always closes, never waits
+        void                    SendError(Connection * pConn, uint32_t u32Status);
+
+    private:
+
+        uint32_t                m_u32Workers;
+        uint32_t                m_u32MaxQueue;
+        int64_t                 m_i64SendTimeout;
+        int64_t                 m_i64IdleTimeout;
+        uint32_t                m_u32MaxBody;
+        int64_t                 m_i64RequestTimeout;
+        int64_t                 m_i64LastSweep;
+                                // reactor thread - an accept failed with the backlog not yet drained
+        bool                    m_bAcceptStalled;
+        TCPAcceptSocket       * m_pListener;
+        Reactor                 m_reactor;
+        ThreadQueue             m_qWork;
+        std::vector<RouteEntry> m_vecRoutes;
+        std::map<Socket *, Connection *> m_mapConnections;
+
+                                // disallow copy constructors
+                                HTTPServer(const HTTPServer &);
+        void                    operator=(const HTTPServer &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
@@ -0,0 +1,169 @@
+//============================================================================================================================= 132
+//
+//  IOUring.h
+//
+//      io_uring I/O engine for Socket - accept/connect/send/recv submitted to a shared ring instead of poll() + syscall.
+//
+//      One IOUringEngine is shared by any number of sockets and threads (Socket::SetIOEngine()).  Each operation is
+//      submitted with a linked timeout and the caller sleeps until its own completion arrives; whichever waiting thread
+//      is in the kernel reaps completions for everyone.  Fixed files (RegisterFile()) save the per-operation fd lookup
+//      and registered buffers (RegisterBuffers()) save the per-operation page pinning for ReadFixed()/WriteFixed().
+//
+//      Built on the raw io_uring syscalls so there is no liburing dependency.  Linux only.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <stdint.h>
+#include <vector>
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "Exception.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,IOUring)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,IOUring,Sys)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,IOUring,Param)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// submission queue depth, and fixed-file table size
+#define IOURING_DEFAULT_ENTRIES 256
+#define IOURING_DEFAULT_FILES   1024
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class IOUringEngine
+{
+    public:
+                                // throws IOUringSysException when the kernel has no io_uring (or it is disabled)
+                                IOUringEngine(uint32_t u32Entries = IOURING_DEFAULT_ENTRIES, uint32_t u32Files = IOURING_DEFAULT_FILES);
+        virtual                 ~IOUringEngine();
+
+                                // cheap probe - lets callers pick the poll() path up front
+        static bool             Available();
+
+        bool                    Supports(uint8_t u8Op) const
+                                { return u8Op < IORING_OP_LAST && m_abSupported[u8Op]; }
+
+                                // fixed files - returns the slot to pass as nFixedSlot, or -1 if the table is full
+        virtual int             RegisterFile(int nFD);
+        virtual void            UnregisterFile(int nFixedSlot);
+                                // replaces any previous set; ReadFixed()/WriteFixed() u16BufIndex indexes piov
+        virtual void            RegisterBuffers(const struct iovec* piov, uint32_t u32Count);
+        virtual void            UnregisterBuffers();
+
+                                // each returns the syscall result or -errno, -ETIMEDOUT once i64Timeout uS pass
+                                // i64Timeout < 1 waits forever; nFixedSlot -1 means use nFD
+        virtual int32_t         Accept(int nFD, int nFixedSlot, int nFlags, int64_t i64Timeout);
+        virtual int32_t         Connect(int nFD, int nFixedSlot, const struct sockaddr* psa, socklen_t slen, int64_t i64Timeout);
+        virtual int32_t         Send(int nFD, int nFixedSlot, const void* pvBytes, uint32_t u32Bytes, int64_t i64Timeout);
+        virtual int32_t         Recv(int nFD, int nFixedSlot, void* pvBytes, uint32_t u32Bytes, int64_t i64Timeout);
+        virtual int32_t         SendMsg(int nFD, int nFixedSlot, const struct msghdr* pmsg, int64_t i64Timeout);
+        virtual int32_t         RecvMsg(int nFD, int nFixedSlot, struct msghdr* pmsg, int64_t i64Timeout);
+        virtual int32_t         WriteFixed(int nFD, int nFixedSlot, const void* pvBytes, uint32_t u32Bytes, uint16_t u16BufIndex,
+                                           int64_t i64Timeout);
+        virtual int32_t         ReadFixed(int nFD, int nFixedSlot, void* pvBytes, uint32_t u32Bytes, uint16_t u16BufIndex,
+                                          int64_t i64Timeout);
+                                // returns the ready poll() events
+        virtual int32_t         Poll(int nFD, int nFixedSlot, short sEvents, int64_t i64Timeout);
+                                // cancels every operation in flight on nFD and returns once each has completed
+        virtual int32_t         CancelFD(int nFD);
+
+    protected:
+
+                                // on the heap - an operation outlives a submitter that throws while it is in flight, and
+                                // its completion is then freed by whichever thread reaps it
+        struct Completion
+        {
+            int32_t             i32Result;
+            bool                bDone;
+            bool                bAbandoned;
+            struct __kernel_timespec ts;                // the linked timeout reads it at submission
+        };
+
+        libthrocket::Mutex      m_CSLocal;
+        libthrocket::Condition  m_condReaped;
+
+                                // submit, and if a non-blocking socket says EAGAIN wait for sEvents and go again
+        int32_t                 Execute(struct io_uring_sqe & sqe, short sEvents, int64_t i64Timeout);
+        int32_t                 SubmitAndWait(const struct io_uring_sqe & sqe, int64_t i64Timeout);
+        void                    LockedWaitCompletion(Completion * pCompletion, uint32_t u32Submit);
+        void                    LockedCancel(Completion * pCompletion);
+        void                    PrepSQE(struct io_uring_sqe & sqe, uint8_t u8Op, int nFD, int nFixedSlot);
+
+        struct io_uring_sqe *   LockedGetSQE();
+        void                    LockedEnter(uint32_t u32Submit, uint32_t u32MinComplete, uint32_t u32Flags);
+        void                    LockedReap();
+        void                    LockedRegister(uint32_t u32Opcode, void* pvArg, uint32_t u32Args, const char* pcWhat);
+
+    private:
+
+        int                     m_nRing;
+        bool                    m_bReaping;             // a thread is blocked in io_uring_enter() harvesting for everyone
+        bool                    m_bPollFirst;           // IORING_RECVSEND_POLL_FIRST understood
+        bool                    m_abSupported[IORING_OP_LAST];
+
+        void                  * m_pvSQRing;
+        size_t                  m_uSQRingSize;
+        void                  * m_pvCQRing;
+        size_t                  m_uCQRingSize;
+        struct io_uring_sqe   * m_psqes;
+        size_t                  m_uSQEsSize;
+
+        uint32_t              * m_pu32SQHead;
+        uint32_t              * m_pu32SQTail;
+        uint32_t                m_u32SQMask;
+        uint32_t                m_u32SQEntries;
+        uint32_t              * m_pu32SQArray;
+        uint32_t              * m_pu32CQHead;
+        uint32_t              * m_pu32CQTail;
+        uint32_t                m_u32CQMask;
+        struct io_uring_cqe   * m_pcqes;
+
+        std::vector<int>        m_vecFreeFiles;         // unused fixed-file slots
+
+                                // disallow copy constructors
+                                IOUringEngine(const IOUringEngine &);
+        void                    operator=(const IOUringEngine &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
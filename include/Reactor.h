@@ -0,0 +1,156 @@
+//============================================================================================================================= 132
+//
+//  Reactor.h
+//
+//      Drive many Socket instances from one thread with edge-triggered epoll readiness dispatch.
+//
+//      Register() a Socket along with a ReactorHandler; Run() (or Poll()) waits for readiness and calls back into the
+//      handler.  Notification is edge-triggered: a handler MUST transfer until the socket would block (i.e. until
+//      SocketWouldBlockException) or it will not be called again for that direction.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <map>
+#include <vector>
+
+#include <sys/epoll.h>
+
+#include "Exception.h"
+#include "Socket.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,Reactor)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Reactor,Sys)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Reactor,Param)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// maximum number of readiness events harvested per epoll_wait()
+#define REACTOR_DEFAULT_EVENTS  256
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - callbacks are made on the thread calling Reactor::Poll()/Run() with no Reactor lock held
+class ReactorHandler
+{
+    public:
+                                ReactorHandler()
+                                {}
+        virtual                 ~ReactorHandler()
+                                {}
+
+        virtual void            OnReadable(Socket * pSocket)    =   0;
+        virtual void            OnWritable(Socket * pSocket)
+                                { (void) pSocket; }
+                                // EPOLLHUP/EPOLLERR - default lets the read path discover EOF or the socket error
+        virtual void            OnHangup(Socket * pSocket)
+                                { OnReadable(pSocket); }
+
+    private:
+                                // disallow copy constructors
+                                ReactorHandler(const ReactorHandler &);
+        void                    operator=(const ReactorHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class Reactor
+{
+    public:
+                                Reactor(uint32_t u32MaxEvents = REACTOR_DEFAULT_EVENTS);
+        virtual                 ~Reactor();
+
+                                // registered sockets are set non-blocking; the Reactor does not own the Socket or handler
+        virtual void            Register(Socket * pSocket, ReactorHandler * pHandler, bool bWantRead, bool bWantWrite)
+                                { libthrocket::Lock l(&m_CSLocal); LockedRegister(pSocket, pHandler, bWantRead, bWantWrite); }
+        virtual void            Modify(Socket * pSocket, bool bWantRead, bool bWantWrite)
+                                { libthrocket::Lock l(&m_CSLocal); LockedModify(pSocket, bWantRead, bWantWrite); }
+                                // call before closing the Socket.  From any thread but the one dispatching, waits out a
+                                // callback already running for the socket, so the handler may be deleted once it returns -
+                                // do not call it holding a lock that callback takes
+        virtual void            Unregister(Socket * pSocket)
+                                { libthrocket::Lock l(&m_CSLocal); LockedUnregister(pSocket); }
+
+                                // wait up to i64Timeout uS (-1 is forever) and dispatch; returns the number of callbacks
+                                // only one thread may Poll()/Run() a given Reactor at a time
+        virtual size_t          Poll(int64_t i64Timeout);
+        virtual void            Run();
+                                // may be called from any thread (or from a handler)
+        virtual void            Stop();
+
+        virtual size_t          GetNumRegistered()
+                                { libthrocket::Lock l(&m_CSLocal); return m_mapRegistrations.size(); }
+
+    protected:
+
+        struct Registration
+        {
+            Socket            * pSocket;
+            ReactorHandler    * pHandler;
+            uint32_t            u32Generation;
+        };
+
+        libthrocket::Mutex      m_CSLocal;
+
+        virtual void            LockedRegister(Socket * pSocket, ReactorHandler * pHandler, bool bWantRead, bool bWantWrite);
+        virtual void            LockedModify(Socket * pSocket, bool bWantRead, bool bWantWrite);
+        virtual void            LockedUnregister(Socket * pSocket);
+
+        void                    LockedControl(int nOp, int nFD, uint32_t u32Generation, bool bWantRead, bool bWantWrite);
+        void                    DispatchDone();
+
+    private:
+
+        int                     m_nEpoll;
+        int                     m_nWakeFD;
+        uint32_t                m_u32Generation;
+        volatile bool           m_bStopRequested;
+        std::vector<struct epoll_event> m_vecEvents;
+        std::map<int, Registration> m_mapRegistrations;
+        int                     m_nDispatchFD;          // registration whose callback is running, -1 between callbacks
+        uint32_t                m_u32DispatchGeneration;
+        pthread_t               m_tidDispatch;
+        uint32_t                m_u32DispatchWaiters;   // in Unregister() for it
+        libthrocket::Condition  m_condDispatch;
+
+                                // disallow copy constructors
+                                Reactor(const Reactor &);
+        void                    operator=(const Reactor &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
@@ -0,0 +1,220 @@
+//============================================================================================================================= 132
+//
+//  Resolver.h
+//
+//      Thread-safe, caching host name resolution.
+//
+//      Lookups run on a small pool of worker threads (getaddrinfo() is reentrant, unlike the gethostbyname() that
+//      Resolv() used to serialize every thread behind), so one slow name server stalls only the names waiting on it.
+//      Answers - and "no such host" answers - are cached; concurrent requests for a name that is already being looked up
+//      share the one lookup.  ResolveAsync() hands back a future, Resolve() waits on it.
+//
+//      Where answers come from is a ResolverSource: getaddrinfo() by default, or an /etc/hosts style table for tests and
+//      pinned names.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Exception.h"
+#include "Socket.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Resolv,Param)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// defaults - lookup threads, how long (uS) an answer and a "no such host" are cached, cache size, and how often (uS) an
+// idle lookup thread checks for a stop request
+#define RESOLVER_WORKERS        4
+#define RESOLVER_TTL            (60 * 1000 * 1000)
+#define RESOLVER_NEGATIVE_TTL   (5 * 1000 * 1000)
+#define RESOLVER_MAX_ENTRIES    4096
+#define RESOLVER_POLL           (100 * 1000)
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - called concurrently from every lookup thread
+class ResolverSource
+{
+    public:
+                                ResolverSource()
+                                {}
+        virtual                 ~ResolverSource()
+                                {}
+
+                                // false (or no addresses) for "no such host", which is cached for the negative TTL;
+                                // throw for a transient failure, which is not cached.  i64TTL arrives as the Resolver's
+                                // default - lower it if the source knows better
+        virtual bool            Lookup(const std::string& strHostname, std::vector<std::string>& vecIPAddrs, int64_t& i64TTL) = 0;
+
+    private:
+                                // disallow copy constructors
+                                ResolverSource(const ResolverSource &);
+        void                    operator=(const ResolverSource &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// addresses from getaddrinfo() - it does not report record TTLs, so answers live for the Resolver's default
+// nFamily AF_UNSPEC answers both families in getaddrinfo()'s preference order, ready for TCPSocket's happy eyeballs Connect()
+class ResolverGetAddrInfo   :   public ResolverSource
+{
+    public:
+                                ResolverGetAddrInfo(int nFamily = AF_INET)  :
+                                    m_nFamily(nFamily)
+                                {}
+        virtual                 ~ResolverGetAddrInfo()
+                                {}
+
+        virtual bool            Lookup(const std::string& strHostname, std::vector<std::string>& vecIPAddrs, int64_t& i64TTL);
+
+    private:
+
+        int                     m_nFamily;
+
+                                // disallow copy constructors
+                                ResolverGetAddrInfo(const ResolverGetAddrInfo &);
+        void                    operator=(const ResolverGetAddrInfo &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a fixed table - "address name [alias ...]" lines with '#' comments, as in /etc/hosts
+class ResolverHosts         :   public ResolverSource
+{
+    public:
+                                ResolverHosts()
+                                {}
+        virtual                 ~ResolverHosts()
+                                {}
+
+        virtual void            Load(const std::string& strPath);
+                                // i64TTL 0 uses the Resolver's default
+        virtual void            Add(const std::string& strHostname, const std::string& strIPAddr, int64_t i64TTL = 0);
+        virtual void            Clear();
+
+        virtual bool            Lookup(const std::string& strHostname, std::vector<std::string>& vecIPAddrs, int64_t& i64TTL);
+
+    protected:
+
+        struct Host
+        {
+            std::vector<std::string> vecIPAddrs;
+            int64_t             i64TTL;
+        };
+
+        libthrocket::Mutex      m_CSLocal;
+
+    private:
+
+        std::map<std::string, Host> m_mapHosts;         // lower case names
+
+                                // disallow copy constructors
+                                ResolverHosts(const ResolverHosts &);
+        void                    operator=(const ResolverHosts &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class Resolver              :   public ThreadMother
+{
+    friend class ResolverThread;
+
+    public:
+                                // pSource NULL is getaddrinfo(); the Resolver does not own a source it is given
+                                Resolver
+                                (
+                                    ResolverSource    * pSource = NULL,
+                                    uint32_t            u32Workers = RESOLVER_WORKERS,
+                                    int64_t             i64TTL = RESOLVER_TTL,
+                                    int64_t             i64NegativeTTL = RESOLVER_NEGATIVE_TTL,
+                                    uint32_t            u32MaxEntries = RESOLVER_MAX_ENTRIES
+                                );
+        virtual                 ~Resolver();
+
+                                // address literals answer at once; get() throws ResolvLookupException for no such host
+        virtual std::shared_future<std::vector<std::string> > ResolveAsync(const std::string& strHostname);
+                                // the first address, waiting for the lookup if it is not cached
+        virtual const std::string Resolve(const std::string& strHostname)
+                                { return ResolveAsync(strHostname).get()[0]; }
+
+                                // forget every cached answer; lookups in progress still complete their futures
+        virtual void            Flush();
+        virtual size_t          GetNumCached()
+                                { libthrocket::Lock l(&m_CSLocal); return m_mapCache.size(); }
+
+    protected:
+
+        struct Entry
+        {
+            std::shared_future<std::vector<std::string> > future;
+            int64_t             i64Expire;              // INT64_MAX while the lookup is in progress
+            uint64_t            u64Generation;          // tells a lookup whether its entry has been replaced since
+        };
+
+        libthrocket::Mutex      m_CSLocal;
+
+                                // lookup threads - run one queued lookup, if any within i64Timeout
+        void                    Work(int64_t i64Timeout);
+        void                    Expire(const std::string& strKey, uint64_t u64Generation, int64_t i64TTL);
+        void                    LockedPrune(int64_t i64Now);
+
+    private:
+
+        ResolverSource        * m_pSource;
+        bool                    m_bOwnSource;
+        int64_t                 m_i64TTL;
+        int64_t                 m_i64NegativeTTL;
+        uint32_t                m_u32MaxEntries;
+        uint64_t                m_u64Generation;
+        ThreadQueue             m_qLookups;
+        std::map<std::string, Entry> m_mapCache;        // lower case names
+
+                                // disallow copy constructors
+                                Resolver(const Resolver &);
+        void                    operator=(const Resolver &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// where the process-wide Resolver behind Resolv() gets its answers - a stub for tests, or pinned names; call it before the
+// first Resolv() (after, it throws ResolvParamException), and keep pSource alive for the life of the process
+void SetResolvSource(ResolverSource * pSource);
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
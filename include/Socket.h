@@ -46,13 +46,17 @@ typedef uint32_t in_addr_t;
 	//#include <netinet/in.h>
     #include <sys/socket.h>
 	#include <sys/time.h>
+    #include <sys/uio.h>
     #define SOCKET_ERROR (-1)
     #define INVALID_SOCKET (-1)
 #endif  // WIN32
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
+#include <vector>
+
 #include "Exception.h"
+#include "HTTPParser.h"
 #include "ThreadMinimal.h"
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
@@ -64,6 +68,7 @@ DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Socket,Init)
 DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Socket,Param)
 DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Socket,Connect)
 DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Socket,Timeout)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Socket,WouldBlock)
 
 DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,Resolv)
 DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,Resolv,Lookup)
@@ -79,13 +84,93 @@ DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,HTTPClient,Send)
 #define SOCKET_TRANSFER_RECV    true
 #define SOCKET_TRANSFER_SEND    false
 
+// scatter/gather lists up to this length are worked on the stack
+#define SOCKET_IOV_LOCAL        16
+// batched datagram calls up to this many messages are worked on the stack
+#define SOCKET_MMSG_LOCAL       64
+// largest single sendfile()/splice() request
+#define SOCKET_SPLICE_CHUNK     (1024 * 1024)
+// MSG_ZEROCOPY sends smaller than this are copied - page pinning + notification costs more than the copy
+#define SOCKET_ZEROCOPY_MIN     (16 * 1024)
+// HTTPClient receive buffer for streamed responses
+#define HTTP_CLIENT_RECV_BUF    (16 * 1024)
+// happy eyeballs - how long (uS) a connect attempt has to itself before the next address is raced against it (RFC 8305)
+#define SOCKET_CONNECT_ATTEMPT_DELAY    (250 * 1000)
+
 namespace libthrocket
 {
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
+// hostname to dotted quad through a process-wide Resolver (see Resolver.h); addresses pass straight through
 const std::string Resolv(const std::string& strHostname);
 
+class IOUringEngine;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// an IPv4 or IPv6 address and port - what bind()/connect()/sendto() take and getpeername()/recvfrom() hand back
+class SocketAddress
+{
+    public:
+                                SocketAddress()
+                                { clear(); }
+                                // throws SocketParamException for anything but an address literal
+                                SocketAddress(const std::string& strIPAddr, uint16_t u16Port)
+                                { Set(strIPAddr, u16Port); }
+                                SocketAddress(in_addr_t inaIPAddr, uint16_t u16Port)
+                                { Set(inaIPAddr, u16Port); }
+                                SocketAddress(const struct sockaddr* psa, socklen_t slen)
+                                { Set(psa, slen); }
+
+                                // "10.1.2.3", "::1", "fe80::1%eth0" - false (and cleared) for anything else, e.g. hostnames
+        bool                    Parse(const std::string& strIPAddr, uint16_t u16Port);
+                                // "10.1.2.3:80" or "[::1]:80", as AddrString() writes them
+        bool                    ParseAddrString(const std::string& strAddr);
+        void                    Set(const std::string& strIPAddr, uint16_t u16Port);
+        void                    Set(in_addr_t inaIPAddr, uint16_t u16Port);
+        void                    Set(const struct sockaddr* psa, socklen_t slen);
+        void                    clear();
+
+        int                     GetFamily() const
+                                { return m_ss.ss_family; }
+        bool                    IsValid() const
+                                { return m_ss.ss_family == AF_INET || m_ss.ss_family == AF_INET6; }
+        bool                    IsIPv6() const
+                                { return m_ss.ss_family == AF_INET6; }
+                                // AF_INET, or IPv4-mapped AF_INET6 (::ffff:a.b.c.d) as a dual-stack socket reports IPv4 peers
+        bool                    GetIPv4(in_addr_t& inaIPAddr) const;
+                                // an AF_INET address as IPv4-mapped AF_INET6, for sending from a dual-stack socket
+        SocketAddress           MapToIPv6() const;
+
+        uint16_t                GetDecodedPort() const;
+        void                    SetDecodedPort(uint16_t u16Port);
+
+        const struct sockaddr * GetSockAddr() const
+                                { return (const struct sockaddr*) &m_ss; }
+        socklen_t               GetLength() const
+                                { return m_slen; }
+                                // for the kernel to fill in - offer GetCapacity() bytes, then SetLength() what came back
+        struct sockaddr *       GetSockAddrBuffer()
+                                { return (struct sockaddr*) &m_ss; }
+        static socklen_t        GetCapacity()
+                                { return sizeof(struct sockaddr_storage); }
+        void                    SetLength(socklen_t slen)
+                                { m_slen = slen; }
+
+                                // "10.1.2.3" or "::1" - "0.0.0.0" when empty, as the IPv4 getters always answered
+        const std::string       IPString() const;
+                                // "10.1.2.3:80" or "[::1]:80"
+        const std::string       AddrString() const;
+
+        bool                    operator==(const SocketAddress& other) const;
+        bool                    operator!=(const SocketAddress& other) const
+                                { return (*this == other) == false; }
+
+    private:
+
+        struct sockaddr_storage m_ss;
+        socklen_t               m_slen;
+};
+
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 class Socket
@@ -101,7 +186,13 @@ class Socket
                                     m_nSocket(nSocket),
                                     m_nSocketType(nSocketType),
                                     m_i64RecvTimeout(i64RecvTimeout),
-                                    m_i64SendTimeout(i64SendTimeout)
+                                    m_i64SendTimeout(i64SendTimeout),
+                                    m_bOptimisticIO(false),
+                                    m_pIOEngine(NULL),
+                                    m_nIOFixedSlot(-1),
+                                    m_bIOFixedFile(false),
+                                    m_u32RingIOs(0),
+                                    m_bRingQuiescing(false)
                                 { Init(); }
 
                                 Socket
@@ -113,7 +204,13 @@ class Socket
                                     m_nSocket(INVALID_SOCKET),
                                     m_nSocketType(nSocketType),
                                     m_i64RecvTimeout(i64RecvTimeout),
-                                    m_i64SendTimeout(i64SendTimeout)
+                                    m_i64SendTimeout(i64SendTimeout),
+                                    m_bOptimisticIO(false),
+                                    m_pIOEngine(NULL),
+                                    m_nIOFixedSlot(-1),
+                                    m_bIOFixedFile(false),
+                                    m_u32RingIOs(0),
+                                    m_bRingQuiescing(false)
                                 { Init(); }
 
         virtual                 ~Socket();
@@ -128,18 +225,30 @@ class Socket
 
         virtual void            SetRecvTimeout(int64_t i64RecvTimeout);
         virtual int64_t         GetRecvTimeout()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetRecvTimeout(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetRecvTimeout(); }
 
         virtual void            SetSendTimeout(int64_t i64SendTimeout);
         virtual int64_t         GetSendTimeout()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetSendTimeout(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetSendTimeout(); }
 
         virtual void            SetFD(int nSocket);
         virtual int             GetFD()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetFD(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetFD(); }
 
         void                    Select(bool bWantRead, bool bWantWrite, int64_t i64Timeout);
 
+                                // try the transfer without waiting first and only poll() if it would block
+        void                    SetOptimisticIO(bool bOptimisticIO)
+                                { libthrocket::Lock l(&m_CSLocal); m_bOptimisticIO = bOptimisticIO; }
+        bool                    GetOptimisticIO()
+                                { libthrocket::Lock l(&m_CSLocal); return m_bOptimisticIO; }
+                                // submit blocking I/O to an io_uring engine instead of poll() + syscall; NULL is the poll()
+                                // path.  bFixedFile registers the descriptor with the ring.  The engine must outlive us.
+        void                    SetIOEngine(IOUringEngine * pEngine, bool bFixedFile = false)
+                                { libthrocket::Lock l(&m_CSLocal); LockedSetIOEngine(pEngine, bFixedFile); }
+        IOUringEngine *         GetIOEngine()
+                                { libthrocket::Lock l(&m_CSLocal); return m_pIOEngine; }
+
         void                    SetNonBlocking()
                                 { libthrocket::Lock l(&m_CSLocal); LockedSetNonBlocking(); }
         void                    SetBlocking(bool bBlocking = true)
@@ -150,11 +259,21 @@ class Socket
 
     protected:
 
-        libthrocket::Mutex             m_CSLocal;
+        libthrocket::FutexMutex m_CSLocal;
+                                // m_nSocket and the timeouts change under m_CSLocal AND m_SMMeta, so either is enough to read
+                                // them - the metadata getters take m_SMMeta shared and do not queue behind a transfer
+        libthrocket::SharedMutex m_SMMeta;
         int                     m_nSocket;
         int                     m_nSocketType;
         int64_t                 m_i64RecvTimeout;
         int64_t                 m_i64SendTimeout;
+        bool                    m_bOptimisticIO;
+        IOUringEngine         * m_pIOEngine;
+        int                     m_nIOFixedSlot;         // registered on first use; changes under m_CSLocal AND m_SMMeta
+        bool                    m_bIOFixedFile;
+        uint32_t                m_u32RingIOs;           // engine operations running with m_CSLocal let go
+        libthrocket::FutexCondition m_condRingIOs;
+        bool                    m_bRingQuiescing;       // LockedQuiesceRingIO() is waiting them out
 
         virtual void            LockedClose();
         virtual void            LockedWait(bool bWantRead, bool bWantWrite, int64_t i64Timeout);
@@ -164,10 +283,36 @@ class Socket
                                 { return m_i64SendTimeout; }
         virtual int             LockedGetFD() const
                                 { return m_nSocket; }
+                                // every change of m_nSocket - errno is kept for the caller's socket() check
+        void                    LockedSetFD(int nSocket)
+                                {
+                                    int nSaveErrno = errno;
+                                    libthrocket::Lock l(&m_SMMeta);
+                                    m_nSocket = nSocket;
+                                    errno = nSaveErrno;
+                                }
         virtual void            LockedSetNonBlocking();
         virtual void            LockedSetBlocking(bool bBlocking);
         virtual const std::string LockedGetPeerAddrString()
                                 { return ""; }
+        virtual void            LockedSetIOEngine(IOUringEngine * pEngine, bool bFixedFile);
+                                // true when u8Op (IORING_OP_*) should go to the engine
+        bool                    LockedUseIOEngine(uint8_t u8Op, int64_t i64Timeout);
+        void                    LockedReleaseIOFixedFile();
+                                // around an engine call on the descriptor and slot read under m_CSLocal - they stay valid
+                                // until EndRingIO(), because LockedQuiesceRingIO() waits for it
+        void                    LockedBeginRingIO()
+                                { m_u32RingIOs++; m_CSLocal.unlock(); }
+        void                    EndRingIO()
+                                {
+                                    m_CSLocal.lock();
+                                    if (--m_u32RingIOs == 0)
+                                        m_condRingIOs.broadcast();
+                                }
+                                // cancels engine operations in flight on the socket and waits for every EndRingIO()
+        void                    LockedQuiesceRingIO();
+                                // after EndRingIO() - throws if the socket is being closed, or was (and nFD perhaps reused)
+        void                    LockedCheckRingClosed(int nFD, const char* pcFunc);
 
         #ifdef WIN32
 
@@ -195,7 +340,10 @@ class InetSocket            :   public Socket
                                     int64_t             i64RecvTimeout,
                                     int64_t             i64SendTimeout
                                 )   :
-                                    Socket(nSocket, nSocketType, i64RecvTimeout, i64SendTimeout)
+                                    Socket(nSocket, nSocketType, i64RecvTimeout, i64SendTimeout),
+                                    m_nFamily(AF_UNSPEC),
+                                    m_bReusePort(false),
+                                    m_bV6Only(false)
                                 {}
                                 
                                 InetSocket
@@ -204,16 +352,22 @@ class InetSocket            :   public Socket
                                     int64_t             i64RecvTimeout,
                                     int64_t             i64SendTimeout
                                 )   :
-                                    Socket(nSocketType, i64RecvTimeout, i64SendTimeout)
+                                    Socket(nSocketType, i64RecvTimeout, i64SendTimeout),
+                                    m_nFamily(AF_INET),
+                                    m_bReusePort(false),
+                                    m_bV6Only(false)
                                 {}
         virtual                 ~InetSocket()
                                 {}
 
         static const std::string IPAddrString(uint32_t u32IPAddr);
         static const std::string AddrString(uint32_t u32IPAddr, uint16_t u16Port = 0);
+                                // IPv6 addresses come back bracketed - "[::1]:80"
         static const std::string AddrString(const std::string& strIPAddr, uint16_t u16Port = 0);
 		static bool				ValidIPv4Addr(const std::string & strIPAddr)
 								{ return inet_addr(strIPAddr.c_str()) != (in_addr_t) -1; }
+        static bool             ValidIPAddr(const std::string & strIPAddr)
+                                { SocketAddress addr; return addr.Parse(strIPAddr, 0); }
 		static bool				ValidIPv4Port(int32_t i32Port)
 								{ return i32Port >= 0 && i32Port <= 0xFFFF; }
 
@@ -221,30 +375,59 @@ class InetSocket            :   public Socket
                                 { libthrocket::Lock l(&m_CSLocal); LockedOpen(); }
         virtual void            Bind(const std::string& strIPAddr, uint16_t u16Port, int nListenLen = 0)
                                 { libthrocket::Lock l(&m_CSLocal); LockedBind(strIPAddr, u16Port, nListenLen); }
-
+        virtual void            Bind(const SocketAddress& addr, int nListenLen = 0)
+                                { libthrocket::Lock l(&m_CSLocal); LockedBind(addr, nListenLen); }
+                                // call before Bind() to let several sockets (e.g. one per thread) share a port
+        virtual void            ReusePort()
+                                { libthrocket::Lock l(&m_CSLocal); LockedReusePort(); }
+                                // AF_INET or AF_INET6 for Open() - Bind() and Connect() take it from the address
+        virtual void            SetFamily(int nFamily)
+                                { libthrocket::Lock l(&m_CSLocal); m_nFamily = nFamily; }
+        virtual int             GetFamily()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedGetFamily(); }
+                                // before Bind() - by default "::" also takes IPv4, whatever net.ipv6.bindv6only says; turn
+                                // that off to bind "0.0.0.0" and "::" to the same port on separate sockets
+        virtual void            SetV6Only(bool bV6Only)
+                                { libthrocket::Lock l(&m_CSLocal); m_bV6Only = bV6Only; }
+        virtual void            SetFD(int nSocket)
+                                { libthrocket::Lock l(&m_CSLocal); Socket::SetFD(nSocket); m_nFamily = AF_UNSPEC; }
+
+        virtual const SocketAddress GetLocalAddress()
+                                { libthrocket::SharedLock l(&m_SMMeta); SocketAddress addr; LockedGetLocalAddress(addr); return addr; }
         virtual uint16_t        GetDecodedLocalPort()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetDecodedLocalPort(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetDecodedLocalPort(); }
         virtual const std::string GetLocalIPString()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetLocalIPString(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetLocalIPString(); }
         virtual const std::string GetLocalAddrString()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetLocalAddrString(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetLocalAddrString(); }
 
     protected:
 
         virtual void            LockedOpen();
         virtual void            LockedBind(const std::string& strIPAddr, uint16_t u16Port, int nListenLen = 0);
+        virtual void            LockedBind(const SocketAddress& addr, int nListenLen = 0);
         virtual void            LockedReuseAddr();
+        virtual void            LockedReusePort();
+        virtual void            LockedV6Only();
+                                // descriptors handed to us (accept(), SetFD()) are asked once
+        virtual int             LockedGetFamily();
 
+        virtual bool            LockedGetLocalAddress(SocketAddress& addr);
+                                // 0 for IPv6
         virtual uint32_t        LockedGetEncodedLocalIP();
         virtual uint16_t        LockedGetDecodedLocalPort();
         virtual const std::string LockedGetLocalIPString();
         virtual const std::string LockedGetLocalPortString();
         virtual const std::string LockedGetLocalAddrString();
 
+        int                     m_nFamily;              // AF_UNSPEC until a descriptor handed to us is asked
+
     private:
 
         std::string             m_strIPAddr;
         uint16_t                m_u16Port;
+        bool                    m_bReusePort;
+        bool                    m_bV6Only;
 
                                 // disallow default construction / copy constructors
                                 InetSocket();
@@ -284,6 +467,25 @@ class UDPSocket             :   public InetSocket
                                 { libthrocket::Lock l(&m_CSLocal); return LockedSend(inaIPAddr, u16Port, (uint8_t*) pu8Bytes, u32Bytes); }
         virtual uint32_t        Recv(in_addr_t& inaIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes)
                                 { libthrocket::Lock l(&m_CSLocal); return LockedRecv(inaIPAddr, u16Port, pu8Bytes, u32Bytes); }
+                                // either family - an IPv4 destination from an AF_INET6 socket goes out IPv4-mapped
+        virtual uint32_t        Send(const SocketAddress& addr, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSend(addr, pu8Bytes, u32Bytes); }
+        virtual uint32_t        Recv(SocketAddress& addr, uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecv(addr, pu8Bytes, u32Bytes); }
+
+                                // move up to u32Count datagrams per syscall - pu32Bytes is buffer size in, datagram size out
+                                // pinaIPAddr/pu16Port may be NULL when the peers are of no interest; returns datagrams moved
+        virtual uint32_t        RecvBatch(uint8_t* const* ppu8Bytes, uint32_t* pu32Bytes, in_addr_t* pinaIPAddr, uint16_t* pu16Port,
+                                          uint32_t u32Count)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecvBatch(ppu8Bytes, pu32Bytes, pinaIPAddr, pu16Port, u32Count); }
+        virtual uint32_t        SendBatch(const uint8_t* const* ppu8Bytes, const uint32_t* pu32Bytes, const in_addr_t* pinaIPAddr,
+                                          const uint16_t* pu16Port, uint32_t u32Count)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSendBatch(ppu8Bytes, pu32Bytes, pinaIPAddr, pu16Port, u32Count); }
+        virtual uint32_t        RecvBatch(uint8_t* const* ppu8Bytes, uint32_t* pu32Bytes, SocketAddress* paddr, uint32_t u32Count)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecvBatch(ppu8Bytes, pu32Bytes, paddr, u32Count); }
+        virtual uint32_t        SendBatch(const uint8_t* const* ppu8Bytes, const uint32_t* pu32Bytes, const SocketAddress* paddr,
+                                          uint32_t u32Count)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSendBatch(ppu8Bytes, pu32Bytes, paddr, u32Count); }
 
         virtual void            Broadcast() // call this if you're going to be doing mcast or bcast Send()s
                                 { libthrocket::Lock l(&m_CSLocal); LockedBroadcast(); }
@@ -295,8 +497,21 @@ class UDPSocket             :   public InetSocket
         virtual uint32_t        LockedRecv(std::string& strIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes);
         virtual uint32_t        LockedSend(in_addr_t inaIPAddr, uint16_t u16Port, const uint8_t* pu8Bytes, uint32_t u32Bytes);
         virtual uint32_t        LockedRecv(in_addr_t& inaIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes);
+        virtual uint32_t        LockedSend(const SocketAddress& addr, const uint8_t* pu8Bytes, uint32_t u32Bytes);
+        virtual uint32_t        LockedRecv(SocketAddress& addr, uint8_t* pu8Bytes, uint32_t u32Bytes);
+
+        virtual uint32_t        LockedRecvBatch(uint8_t* const* ppu8Bytes, uint32_t* pu32Bytes, in_addr_t* pinaIPAddr, uint16_t* pu16Port,
+                                                uint32_t u32Count);
+        virtual uint32_t        LockedSendBatch(const uint8_t* const* ppu8Bytes, const uint32_t* pu32Bytes, const in_addr_t* pinaIPAddr,
+                                                const uint16_t* pu16Port, uint32_t u32Count);
+        virtual uint32_t        LockedRecvBatch(uint8_t* const* ppu8Bytes, uint32_t* pu32Bytes, SocketAddress* paddr, uint32_t u32Count);
+        virtual uint32_t        LockedSendBatch(const uint8_t* const* ppu8Bytes, const uint32_t* pu32Bytes, const SocketAddress* paddr,
+                                                uint32_t u32Count);
 
         virtual void            LockedBroadcast();
+                                // *pslen is the name buffer size in, the peer's address length out
+        int                     LockedTransferMsgIOEngine(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes,
+                                                          struct sockaddr* psa, socklen_t* pslen, int64_t i64Timeout);
 
     private:
                                 // disallow default construction / copy constructors
@@ -305,6 +520,27 @@ class UDPSocket             :   public InetSocket
         void                    operator=(const UDPSocket &);
 };
 
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - told when the kernel no longer references a SendZeroCopy() buffer and the caller may reuse it
+// bCopied means the kernel fell back to copying (e.g. loopback), so zero-copy bought nothing for that buffer
+class TCPZeroCopyHandler
+{
+    public:
+                                TCPZeroCopyHandler()
+                                {}
+        virtual                 ~TCPZeroCopyHandler()
+                                {}
+
+        virtual void            OnSendComplete(uint64_t u64Cookie, bool bCopied)    =   0;
+
+    private:
+                                // disallow copy constructors
+                                TCPZeroCopyHandler(const TCPZeroCopyHandler &);
+        void                    operator=(const TCPZeroCopyHandler &);
+};
+
+struct TCPZeroCopyState;
+
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 class TCPSocket             :   public InetSocket
@@ -317,8 +553,9 @@ class TCPSocket             :   public InetSocket
                                     int64_t             i64SendTimeout
                                 )   :
                                     InetSocket(nSocket, SOCK_STREAM, i64RecvTimeout, i64SendTimeout),
-                                    m_bConnected(false)
-                                {}
+                                    m_bConnected(false),
+                                    m_pZeroCopy(NULL)
+                                { m_anSplicePipe[0] = m_anSplicePipe[1] = -1; }
                                 
                                 TCPSocket
                                 (
@@ -326,13 +563,20 @@ class TCPSocket             :   public InetSocket
                                     int64_t             i64SendTimeout
                                 )   :
                                     InetSocket(SOCK_STREAM, i64RecvTimeout, i64SendTimeout),
-                                    m_bConnected(false)
-                                {}
-        virtual                 ~TCPSocket()
-                                {}
+                                    m_bConnected(false),
+                                    m_pZeroCopy(NULL)
+                                { m_anSplicePipe[0] = m_anSplicePipe[1] = -1; }
+        virtual                 ~TCPSocket();
 
         virtual void            Connect(const std::string& strIPAddr, uint16_t u16Port)
                                 { libthrocket::Lock l(&m_CSLocal); LockedConnect(strIPAddr, u16Port); }
+        virtual void            Connect(const SocketAddress& addr)
+                                { libthrocket::Lock l(&m_CSLocal); LockedConnect(addr); }
+                                // happy eyeballs - alternating families from the first listed, a new attempt starts every
+                                // i64AttemptDelay uS (or as soon as one fails) alongside those still in progress, and the first
+                                // to complete wins; the send timeout covers the whole race
+        virtual void            Connect(const std::vector<SocketAddress>& vecAddrs, int64_t i64AttemptDelay = SOCKET_CONNECT_ATTEMPT_DELAY)
+                                { libthrocket::Lock l(&m_CSLocal); LockedConnect(vecAddrs, i64AttemptDelay); }
         virtual void            Disconnect()
                                 { libthrocket::Lock l(&m_CSLocal); LockedDisconnect(); }
 
@@ -342,15 +586,57 @@ class TCPSocket             :   public InetSocket
                                 { libthrocket::Lock l(&m_CSLocal); return LockedTransfer(SOCKET_TRANSFER_RECV, pu8Bytes, u32Bytes, bShort); }
         virtual uint32_t        RecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes)
                                 { libthrocket::Lock l(&m_CSLocal); return LockedRecvAll(pu8Bytes, u32Bytes); }
-
+                                // straight into a new SharedBuffer of up to u32Bytes, ready to hand to other threads
+                                // (ThreadMessage::SetBuf(), PostAllChildren()) without a copy; empty at end of stream
+        virtual SharedBuffer    RecvShared(uint32_t u32Bytes, bool bShort = true)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecvShared(u32Bytes, bShort); }
+                                // scatter/gather - same timeout and partial-transfer semantics as Send()/Recv()
+        virtual uint32_t        SendV(const struct iovec* piov, int nIOV)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransferV(SOCKET_TRANSFER_SEND, piov, nIOV, false/*bShort*/); }
+        virtual uint32_t        RecvV(const struct iovec* piov, int nIOV, bool bShort = false)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransferV(SOCKET_TRANSFER_RECV, piov, nIOV, bShort); }
+                                // io_uring registered buffers - pu8Bytes must lie inside buffer u16BufIndex passed to
+                                // IOUringEngine::RegisterBuffers(); plain Send()/Recv() without an engine
+        virtual uint32_t        SendFixed(uint16_t u16BufIndex, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransferFixed(SOCKET_TRANSFER_SEND, u16BufIndex, (uint8_t*) pu8Bytes, u32Bytes, false/*bShort*/); }
+        virtual uint32_t        RecvFixed(uint16_t u16BufIndex, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort = false)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransferFixed(SOCKET_TRANSFER_RECV, u16BufIndex, pu8Bytes, u32Bytes, bShort); }
+                                // zero-copy: file page cache -> socket, and socket -> pipe -> socket for proxying
+                                // same send timeout and partial-transfer semantics as Send()
+        virtual uint64_t        SendFile(int nFileFD, off_t offOffset, uint64_t u64Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSendFile(nFileFD, offOffset, u64Bytes); }
+                                // sockFrom's descriptor and timeout are read before we lock, never with our lock held
+        virtual uint64_t        Splice(TCPSocket & sockFrom, uint64_t u64Bytes, bool bShort = false)
+                                {
+                                    int nFromFD = sockFrom.GetFD();
+                                    int64_t i64RecvTimeout = sockFrom.GetRecvTimeout();
+                                    libthrocket::Lock l(&m_CSLocal);
+                                    return LockedSplice(sockFrom, nFromFD, i64RecvTimeout, u64Bytes, bShort);
+                                }
+                                // MSG_ZEROCOPY - pHandler (NULL turns it off) learns when each buffer may be reused
+                                // the buffer must stay untouched until OnSendComplete(u64Cookie), which is called
+                                // from SendZeroCopy() or ReapZeroCopy() with no socket lock held
+        virtual void            SetZeroCopy(TCPZeroCopyHandler * pHandler)
+                                { libthrocket::Lock l(&m_CSLocal); LockedSetZeroCopy(pHandler); }
+        virtual uint32_t        SendZeroCopy(const uint8_t* pu8Bytes, uint32_t u32Bytes, uint64_t u64Cookie);
+                                // wait up to i64Timeout uS for completions; returns the number of buffers completed
+        virtual size_t          ReapZeroCopy(int64_t i64Timeout);
+        virtual size_t          GetZeroCopyPending()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedGetZeroCopyPending(); }
+
+        virtual const SocketAddress GetPeerAddress()
+                                { libthrocket::SharedLock l(&m_SMMeta); SocketAddress addr; LockedGetPeerAddress(addr); return addr; }
         virtual uint16_t        GetDecodedPeerPort()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetDecodedPeerPort(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetDecodedPeerPort(); }
         virtual const std::string GetPeerIPString()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetPeerIPString(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetPeerIPString(); }
         virtual const std::string GetPeerAddrString()
-                                { libthrocket::Lock l(&m_CSLocal); return LockedGetPeerAddrString(); }
+                                { libthrocket::SharedLock l(&m_SMMeta); return LockedGetPeerAddrString(); }
         virtual void            NoNagle()
                                 { libthrocket::Lock l(&m_CSLocal); LockedNoNagle(); }
+                                // never waits - true if an idle connection was closed by the peer or has unsolicited bytes
+        virtual bool            IsStale()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedIsStale(); }
 
         virtual bool            IsConnected() const
                                 { return m_nSocket != -1 && m_bConnected; }
@@ -358,22 +644,47 @@ class TCPSocket             :   public InetSocket
     protected:
 
         virtual void            LockedConnect(const std::string& strIPAddr, uint16_t u16Port);
+        virtual void            LockedConnect(const SocketAddress& addr);
+        virtual void            LockedConnect(const std::vector<SocketAddress>& vecAddrs, int64_t i64AttemptDelay);
         virtual void            LockedDisconnect()
                                 { m_bConnected = false; Socket::LockedClose(); }
 
         virtual uint32_t        LockedTransfer(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort);
+        virtual uint32_t        LockedTransferV(bool bDirection, const struct iovec* piov, int nIOV, bool bShort);
         virtual uint32_t        LockedRecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes);
+        virtual SharedBuffer    LockedRecvShared(uint32_t u32Bytes, bool bShort);
+        virtual uint32_t        LockedTransferFixed(bool bDirection, uint16_t u16BufIndex, uint8_t* pu8Bytes, uint32_t u32Bytes,
+                                                    bool bShort);
+                                // i32BufIndex -1 is an ordinary send/recv
+        virtual uint32_t        LockedTransferIOEngine(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort,
+                                                       int32_t i32BufIndex);
+        virtual uint64_t        LockedSendFile(int nFileFD, off_t offOffset, uint64_t u64Bytes);
+        virtual uint64_t        LockedSplice(TCPSocket & sockFrom, int nFromFD, int64_t i64RecvTimeout, uint64_t u64Bytes,
+                                             bool bShort);
+        void                    LockedCloseSplicePipe();
+        virtual void            LockedSetZeroCopy(TCPZeroCopyHandler * pHandler);
+        virtual uint32_t        LockedSendZeroCopy(const uint8_t* pu8Bytes, uint32_t u32Bytes, uint64_t u64Cookie);
+        virtual void            LockedReapZeroCopy(int64_t i64Timeout);
+        virtual size_t          LockedGetZeroCopyPending();
+                                // reaps zero-copy completions first - left queued they keep POLLERR up and every wait returns at once
+        virtual void            LockedWait(bool bWantRead, bool bWantWrite, int64_t i64Timeout);
+        size_t                  DispatchZeroCopy();
 
+        virtual bool            LockedGetPeerAddress(SocketAddress& addr);
+                                // 0 for IPv6
         virtual uint32_t        LockedGetEncodedPeerIP();
         virtual uint16_t        LockedGetDecodedPeerPort();
         virtual const std::string LockedGetPeerIPString();
         virtual const std::string LockedGetPeerPortString();
         virtual const std::string LockedGetPeerAddrString();
         virtual void            LockedNoNagle();
+        virtual bool            LockedIsStale();
 
     private:
 
         bool                    m_bConnected;
+        int                     m_anSplicePipe[2];  // created on first Splice() into this socket
+        TCPZeroCopyState      * m_pZeroCopy;        // created by SetZeroCopy()
 
                                 // disallow default construction / copy constructors
                                 TCPSocket();
@@ -391,19 +702,44 @@ class TCPAcceptSocket		:	public InetSocket
                                     int64_t             i64RecvTimeout,
                                     int64_t             i64SendTimeout
                                 )   :
-                                    InetSocket(SOCK_STREAM, i64RecvTimeout, i64SendTimeout)
+                                    InetSocket(SOCK_STREAM, i64RecvTimeout, i64SendTimeout),
+                                    m_bAcceptNoNagle(false),
+                                    m_bAcceptNonBlocking(false)
                                 {}
 		virtual					~TCPAcceptSocket()
 								{}
 
 		virtual TCPSocket *		Accept(int64_t i64AcceptTimeout)
 								{ libthrocket::Lock l(&m_CSLocal); return LockedAccept(i64AcceptTimeout); }						
+                                // never waits - returns NULL once the backlog is drained; the TCPSocket is non-blocking
+        virtual TCPSocket *     AcceptNonBlocking()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedAcceptNonBlocking(); }
+                                // one wakeup, then drain up to uMax connections into vecSockets (cleared and reserved)
+        virtual size_t          AcceptBatch(std::vector<TCPSocket *> & vecSockets, size_t uMax, int64_t i64AcceptTimeout)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedAcceptBatch(vecSockets, uMax, i64AcceptTimeout); }
+
+                                // options for accepted sockets; NoNagle is set once on the listener and inherited
+        virtual void            SetAcceptOptions(bool bNoNagle, bool bNonBlocking)
+                                { libthrocket::Lock l(&m_CSLocal); LockedSetAcceptOptions(bNoNagle, bNonBlocking); }
 
 	protected:
 
+        using                   InetSocket::LockedBind;
+        virtual void            LockedBind(const SocketAddress& addr, int nListenLen = 0);
 		virtual TCPSocket *		LockedAccept(int64_t i64AcceptTimeout);
+        virtual TCPSocket *     LockedAcceptNonBlocking();
+        virtual size_t          LockedAcceptBatch(std::vector<TCPSocket *> & vecSockets, size_t uMax, int64_t i64AcceptTimeout);
+        virtual int             LockedAcceptFD(int nFlags);
+        virtual void            LockedSetAcceptOptions(bool bNoNagle, bool bNonBlocking);
+        virtual void            LockedApplyAcceptNoNagle();
+        int                     LockedGetAcceptFlags() const
+                                { return m_bAcceptNonBlocking ? (SOCK_NONBLOCK | SOCK_CLOEXEC) : SOCK_CLOEXEC; }
 
     private:
+
+        bool                    m_bAcceptNoNagle;
+        bool                    m_bAcceptNonBlocking;
+
                                 // disallow default construction / copy constructors
                                 TCPAcceptSocket();
                                 TCPAcceptSocket(const TCPAcceptSocket &);
@@ -418,20 +754,27 @@ class HTTPClient            :   public TCPSocket
                                 HTTPClient
                                 (
                                     const std::string&  strIPAddr,
-                                    int16_t             u16Port,
+                                    uint16_t            u16Port,
                                     int64_t             i64RecvTimeout,
                                     int64_t             i64SendTimeout
                                 )   :
                                     TCPSocket(i64RecvTimeout, i64SendTimeout),
                                     m_strIPAddr(strIPAddr),
-                                    m_u16Port(u16Port)
+                                    m_u16Port(u16Port),
+                                    m_u32RecvBufOff(0),
+                                    m_u32RecvBufLen(0)
                                 {}
         virtual                 ~HTTPClient()
                                 {}
 
 
         virtual void            Connect()
-                                { TCPSocket::Connect(m_strIPAddr, m_u16Port); }
+                                { m_u32RecvBufOff = m_u32RecvBufLen = 0; TCPSocket::Connect(m_strIPAddr, m_u16Port); }
+
+        const std::string &     GetIPAddr() const
+                                { return m_strIPAddr; }
+        uint16_t                GetPort() const
+                                { return m_u16Port; }
 
         virtual uint32_t        Request
                                 (
@@ -440,11 +783,59 @@ class HTTPClient            :   public TCPSocket
                                     uint8_t*            pu8Response,
                                     uint32_t            u32ResponseLen
                                 );
+                                // streams the response to pHandler as it arrives, framed by Content-Length, chunked
+                                // encoding or close; bHead when the request was a HEAD.  Returns true if the connection
+                                // may carry another request (see HTTPClientPool::Release())
+        virtual bool            Request
+                                (
+                                    const uint8_t*      pu8Request,
+                                    uint32_t            u32RequestLen,
+                                    HTTPResponseHandler* pHandler,
+                                    bool                bHead = false
+                                );
+
+
+                                // pipelining - Queue() requests, which must stay valid until Flush() writes them all in
+                                // one gathered write and reads the responses back in order.  Flush() returns how many
+                                // were answered; fewer than queued when the server closes part way, in which case the
+                                // rest are back in the queue (GetNumQueued()) to go out again on a new connection.  If it
+                                // throws, the unanswered requests are back in the queue too (the first may have had part
+                                // of its response) and the connection must be dropped before another Flush().  Only
+                                // pipeline idempotent requests
+        virtual void            Queue
+                                (
+                                    const uint8_t*      pu8Request,
+                                    uint32_t            u32RequestLen,
+                                    HTTPResponseHandler* pHandler,
+                                    bool                bHead = false
+                                );
+        virtual size_t          Flush(bool& bReusable);
+        size_t                  GetNumQueued() const
+                                { return m_vecQueue.size(); }
+
+    protected:
+
+        struct Queued
+        {
+            const uint8_t     * pu8Request;
+            uint32_t            u32RequestLen;
+            HTTPResponseHandler* pHandler;
+            bool                bHead;
+        };
+
+                                // runs m_parser over buffered then received bytes until the response is complete;
+                                // false if the server closed before sending any of it
+        virtual bool            RecvResponse();
 
     private:
 
         std::string             m_strIPAddr;
         uint16_t                m_u16Port;
+        std::vector<Queued>     m_vecQueue;
+        HTTPResponseParser      m_parser;
+        uint32_t                m_u32RecvBufOff;
+        uint32_t                m_u32RecvBufLen;        // received but not yet parsed
+        uint8_t                 m_au8RecvBuf[HTTP_CLIENT_RECV_BUF];
 
                                 // disallow default construction / copy constructors
                                 HTTPClient();
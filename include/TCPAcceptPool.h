@@ -0,0 +1,118 @@
+//============================================================================================================================= 132
+//
+//  TCPAcceptPool.h
+//
+//      N listen sockets sharing one port via SO_REUSEPORT, each served by its own acceptor thread.
+//
+//      The kernel spreads incoming connections across the listen sockets, so connection establishment scales across
+//      cores instead of serializing every accept() behind one socket's lock.  Each acceptor waits for readiness and then
+//      drains its backlog with accept4() until EAGAIN, handing each (non-blocking) TCPSocket to a TCPAcceptHandler.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <vector>
+
+#include "Exception.h"
+#include "Socket.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// how often (uS) an idle acceptor checks for a stop request
+#define TCP_ACCEPT_POOL_POLL    (100 * 1000)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// while accepts keep failing (e.g. EMFILE) an acceptor logs at most once per this many uS
+#define TCP_ACCEPT_POOL_LOG_INTERVAL    (10 * 1000 * 1000)
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - called concurrently from every acceptor thread; takes ownership of the TCPSocket
+class TCPAcceptHandler
+{
+    public:
+                                TCPAcceptHandler()
+                                {}
+        virtual                 ~TCPAcceptHandler()
+                                {}
+
+        virtual void            OnAccept(TCPSocket * pSocket)   =   0;
+
+    private:
+                                // disallow copy constructors
+                                TCPAcceptHandler(const TCPAcceptHandler &);
+        void                    operator=(const TCPAcceptHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class TCPAcceptPool         :   public ThreadMother
+{
+    public:
+                                TCPAcceptPool
+                                (
+                                    uint32_t            u32Acceptors,
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout,
+                                    int64_t             i64PollInterval = TCP_ACCEPT_POOL_POLL
+                                );
+        virtual                 ~TCPAcceptPool();
+
+                                // u16Port 0 lets the first listener pick a port that the rest then share; each listener
+                                // gets nListenLen - listen(0) would drop the reconnect storms the pool is there to absorb
+        virtual void            Bind(const std::string& strIPAddr, uint16_t u16Port, int nListenLen = SOMAXCONN);
+        virtual void            Start(TCPAcceptHandler * pHandler);
+        virtual void            Stop();
+
+        virtual uint16_t        GetDecodedLocalPort();
+        virtual size_t          GetNumAcceptors() const
+                                { return m_vecListeners.size(); }
+
+    private:
+
+        uint32_t                m_u32Acceptors;
+        int64_t                 m_i64RecvTimeout;
+        int64_t                 m_i64SendTimeout;
+        int64_t                 m_i64PollInterval;
+        std::vector<TCPAcceptSocket *> m_vecListeners;
+
+                                // disallow default construction / copy constructors
+                                TCPAcceptPool();
+                                TCPAcceptPool(const TCPAcceptPool &);
+        void                    operator=(const TCPAcceptPool &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
@@ -36,24 +36,52 @@ SOFTWARE.
 
 //---------------------------------------------------------------------------------------------------------------------------------
 //
+#include <atomic>
 #include <cassert>
 #include <cerrno>
+#include <climits>
 #include <cstdint>
 #include <cstring>
+#include <functional>
 #include <iostream>
 #include <iomanip>
 #include <list>
+#include <new>
 #include <queue>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include <pthread.h>
+#include <sched.h>
 #include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 #include <sys/time.h>
 
 //---------------------------------------------------------------------------------------------------------------------------------
 // default stack - best to specify your own value for constructor
 #define THREAD_DEFAULT_STACK    (4 * 1024 * 1024)
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// stack size that leaves the stack to pthread_create() (RLIMIT_STACK, commonly 8 MB) - what Thread and ThreadPool use unless
+// given a size, so threads that never asked keep the stack they had before stack sizes were applied
+#define THREAD_SYSTEM_STACK     0
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// FutexMutex - how many times a contended lock() polls the owner before parking (none on one CPU - the owner cannot run
+// while we spin)
+#define FUTEX_MUTEX_SPIN        100
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// MessagePool - largest pooled block (size classes are powers of two from 16 up to it), and how many bytes of each class a
+// thread's cache and the shared depot may hold before returning blocks to malloc
+#define MESSAGE_POOL_MAX_BLOCK      (64 * 1024)
+#define MESSAGE_POOL_THREAD_BYTES   (256 * 1024)
+#define MESSAGE_POOL_DEPOT_BYTES    (4 * 1024 * 1024)
+
 namespace libthrocket
 {
 
@@ -74,26 +102,158 @@ public:
     void                        operator=(const Lockable &);
 };
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// tell the core we are spinning - it stops speculating ahead and leaves the sibling hyperthread the pipeline
+inline void CPURelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// microseconds on CLOCK_MONOTONIC - for timeouts, deadlines and ages; unlike the time of day it never steps when the clock is set
+inline int64_t TimeuS64()
+{
+    struct timespec             ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t) ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// park on / wake a 32-bit word - private to this process
+// FutexWait() returns 0 when woken (or spuriously), EAGAIN if *pvWord was no longer u32Expected, ETIMEDOUT; pts NULL is forever,
+// otherwise a CLOCK_MONOTONIC interval, or a CLOCK_REALTIME time of day when bAbsolute
+inline int FutexWait(void * pvWord, uint32_t u32Expected, const struct timespec * pts = NULL, bool bAbsolute = false)
+{
+    long rc;
+    if (bAbsolute)
+        rc = syscall(SYS_futex, pvWord, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME, u32Expected, pts,
+                     NULL, FUTEX_BITSET_MATCH_ANY);
+    else
+        rc = syscall(SYS_futex, pvWord, FUTEX_WAIT | FUTEX_PRIVATE_FLAG, u32Expected, pts, NULL, 0);
+    if (rc == 0)
+        return 0;
+    int nErrno = errno;
+    if (nErrno == EAGAIN || nErrno == ETIMEDOUT)
+        return nErrno;
+    if (nErrno == EINTR)
+        return 0;
+    std::cerr << "futex wait: errno: " << nErrno << " " << std::strerror(nErrno) << std::endl;
+    abort();
+}
+inline void FutexWake(void * pvWord, int nWaiters)
+{
+    if (syscall(SYS_futex, pvWord, FUTEX_WAKE | FUTEX_PRIVATE_FLAG, nWaiters, NULL, NULL, 0) >= 0)
+        return;
+    int nErrno = errno;
+    std::cerr << "futex wake: errno: " << nErrno << " " << std::strerror(nErrno) << std::endl;
+    abort();
+}
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// a Mutex without the virtual calls or the pthread layer - for short, hot critical sections
+// uncontended lock() and unlock() are one atomic each; a contended lock() spins a little for the owner to leave, then
+// parks in the kernel, and unlock() only makes a system call when somebody may be parked.  Not recursive, and not Lockable:
+// Lock and Unlock take it directly, FutexCondition waits on it
+class FutexMutex
+{
+public:
+                                FutexMutex()    :
+                                    m_nState(0)
+                                {}
+                                ~FutexMutex()
+                                {}
+
+    void                        lock()
+                                {
+                                    int nFree = 0;
+                                    if (m_nState.compare_exchange_strong(nFree, 1, std::memory_order_acquire))
+                                        return;
+                                    LockContended();
+                                }
+    bool                        try_lock()
+                                {
+                                    int nFree = 0;
+                                    return m_nState.compare_exchange_strong(nFree, 1, std::memory_order_acquire);
+                                }
+    void                        unlock()
+                                {
+                                    if (m_nState.exchange(0, std::memory_order_release) == 2)
+                                        FutexWake(&m_nState, 1);
+                                }
+
+    friend                      class FutexCondition;
+
+private:
+    std::atomic<int>            m_nState;               // 0 free, 1 held, 2 held and somebody may be parked
+
+    static uint32_t             GetSpin()
+                                {
+                                    static const uint32_t u32Spin = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? FUTEX_MUTEX_SPIN : 0;
+                                    return u32Spin;
+                                }
+    void                        LockContended()
+                                {
+                                    for (uint32_t i = 0; i < GetSpin(); i++)
+                                    {
+                                        CPURelax();
+                                        if (m_nState.load(std::memory_order_relaxed) == 0 && try_lock())
+                                            return;
+                                    }
+                                    LockParked();
+                                }
+                                // from here on we may have slept, so whoever unlocks next has to look for a sleeper
+    void                        LockParked()
+                                {
+                                    while (m_nState.exchange(2, std::memory_order_acquire) != 0)
+                                        FutexWait(&m_nState, 2);
+                                }
+
+                                // disallow copy constructors
+                                FutexMutex(const FutexMutex &);
+    void                        operator=(const FutexMutex &);
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 // instantiate this as an auto variable with a pointer to a valid Lockable and when
 // this will create a scope-controlled critical section.  i.e. when the scope of
 // the auto variable (the Lock) is pop'd, the lock will automatically be released.
+// a FutexMutex is locked directly - no virtual call
 class Unlock;
 class Lock
 {
 friend class Unlock;
 public:
                                 Lock(Lockable & m) :
-                                    mm(m)
-                                { mm.lock(); }
+                                    mm(&m),
+                                    mf(NULL)
+                                { mm->lock(); }
                                 Lock(Lockable * pm) :
-                                    mm(*pm)
-                                { mm.lock(); }
+                                    mm(pm),
+                                    mf(NULL)
+                                { mm->lock(); }
+                                Lock(FutexMutex & m) :
+                                    mm(NULL),
+                                    mf(&m)
+                                { mf->lock(); }
+                                Lock(FutexMutex * pm) :
+                                    mm(NULL),
+                                    mf(pm)
+                                { mf->lock(); }
     virtual                     ~Lock()
-                                { mm.unlock(); }
+                                { release(); }
 
 private:
-    Lockable                  & mm;
+    Lockable                  * mm;
+    FutexMutex                * mf;
+
+    void                        acquire()
+                                { if (mf != NULL) mf->lock(); else mm->lock(); }
+    void                        release()
+                                { if (mf != NULL) mf->unlock(); else mm->unlock(); }
 
                                 // disallow default construction / copy constructors
                                 Lock();
@@ -108,9 +268,9 @@ class Unlock
 public:
                                 Unlock(Lock & l)    :
                                     m_Lock(l)
-                                { m_Lock.mm.unlock(); }
+                                { m_Lock.release(); }
     virtual                     ~Unlock()
-                                { m_Lock.mm.lock(); }
+                                { m_Lock.acquire(); }
 
 private:
     Lock                      & m_Lock;
@@ -167,6 +327,138 @@ private:
     void                        operator=(const Mutex &);
 };
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// many readers or one writer - lock()/unlock() (so Lock) take it exclusively, lock_shared()/unlock_shared() (so SharedLock)
+// for reading.  Writers are preferred: once one waits, new readers queue behind it, so a steady stream of readers cannot
+// starve it - which also means a thread must never take the shared lock twice, or it waits on a writer waiting on it
+class SharedMutex           :   public Lockable
+{
+public:
+                                SharedMutex()
+                                {
+                                    pthread_rwlockattr_t        attr;
+                                    int rc = pthread_rwlockattr_init(&attr);
+                                    if (rc != 0)
+                                    {
+                                        std::cerr << "pthread_rwlockattr_init: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                        abort();
+                                    }
+#ifdef __GLIBC__
+                                    rc = pthread_rwlockattr_setkind_np(&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+                                    if (rc != 0)
+                                    {
+                                        std::cerr << "pthread_rwlockattr_setkind_np: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                        abort();
+                                    }
+#endif
+                                    rc = pthread_rwlock_init(&m_RWLock, &attr);
+                                    pthread_rwlockattr_destroy(&attr);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_rwlock_init: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
+    virtual                     ~SharedMutex()
+                                {
+                                    int rc = pthread_rwlock_destroy(&m_RWLock);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_rwlock_destroy: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
+
+    virtual void                lock()
+                                {
+                                    int rc = pthread_rwlock_wrlock(&m_RWLock);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_rwlock_wrlock: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
+    virtual void                unlock()
+                                {
+                                    int rc = pthread_rwlock_unlock(&m_RWLock);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_rwlock_unlock: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
+    void                        lock_shared()
+                                {
+                                    int rc = pthread_rwlock_rdlock(&m_RWLock);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_rwlock_rdlock: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
+    void                        unlock_shared()
+                                { unlock(); }
+
+private:
+    pthread_rwlock_t            m_RWLock;
+
+                                // disallow copy constructors
+                                SharedMutex(const SharedMutex &);
+    void                        operator=(const SharedMutex &);
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// Lock for readers - a scope-controlled shared hold on a SharedMutex
+class SharedLock
+{
+public:
+                                SharedLock(SharedMutex & m) :
+                                    mm(m)
+                                { mm.lock_shared(); }
+                                SharedLock(SharedMutex * pm) :
+                                    mm(*pm)
+                                { mm.lock_shared(); }
+                                ~SharedLock()
+                                { mm.unlock_shared(); }
+
+private:
+    SharedMutex               & mm;
+
+                                // disallow default construction / copy constructors
+                                SharedLock();
+                                SharedLock(const SharedLock &);
+    void                        operator=(const SharedLock &);
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// a fixed set of locks for per-key state - keys that hash to different shards do not contend
+// Lock l(sharded.GetShardOf(key)) (or SharedLock with M = SharedMutex); each shard has its own cache line.  A key always maps
+// to the same shard, but so do others - take one shard at a time, or take them in index order
+template<typename M = FutexMutex, uint32_t N = 16> class ShardedMutex
+{
+    static_assert(N > 0 && (N & (N - 1)) == 0, "ShardedMutex: N must be a power of two");
+
+public:
+                                ShardedMutex()
+                                {}
+                                ~ShardedMutex()
+                                {}
+
+                                // std::hash of an integer is the integer - mix it so neighbouring keys spread out
+    static uint32_t             GetShardIndex(size_t uHash)
+                                { return (uint32_t) ((uHash * 0x9E3779B97F4A7C15ULL) >> 32) & (N - 1); }
+    M                         & GetShard(size_t uHash)
+                                { return m_aShards[GetShardIndex(uHash)].mutex; }
+    template<typename K>
+    M                         & GetShardOf(const K & key)
+                                { return GetShard(std::hash<K>()(key)); }
+    M                         & GetShardAt(uint32_t u32Index)
+                                { return m_aShards[u32Index & (N - 1)].mutex; }
+    static uint32_t             GetNumShards()
+                                { return N; }
+
+private:
+    struct alignas(64) Shard
+    {
+        M                       mutex;
+    };
+    Shard                       m_aShards[N];
+
+                                // disallow copy constructors
+                                ShardedMutex(const ShardedMutex &);
+    void                        operator=(const ShardedMutex &);
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 //
 class Condition
@@ -200,6 +492,13 @@ public:
                                     std::cerr << "pthread_cond_signal: rc: " << rc << " " << std::strerror(rc) << std::endl;
                                     abort();
                                 }
+    void                        broadcast()                                                     //< wake up all blocked threads
+                                {
+                                    int rc = pthread_cond_broadcast(&m_Cond);
+                                    if (rc == 0) return;
+                                    std::cerr << "pthread_cond_broadcast: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    abort();
+                                }
     void                        block(Mutex * pMutex)                                           //< indefinite
                                 {
                                     int rc = pthread_cond_wait(&m_Cond, &(pMutex->m_Mutex));
@@ -252,6 +551,318 @@ private:
     void                        operator=(const Condition &);
 };
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// Condition for a FutexMutex
+// waiters park on a sequence number that every signal() bumps, so a signal between the unlock and the park is never lost;
+// signal() and broadcast() make no system call when nobody is waiting.  Wakeups may be spurious - block in a loop, as with
+// Condition
+class FutexCondition
+{
+public:
+                                FutexCondition()    :
+                                    m_u32Sequence(0),
+                                    m_u32Waiters(0)
+                                {}
+                                ~FutexCondition()
+                                {}
+
+                                enum eBlockReturns
+                                {
+                                    eBlockSignalled =    0,
+                                    eBlockTimedOut  =    1
+                                };
+
+    void                        signal()                                                        //< wake up blocked thread
+                                {
+                                    m_u32Sequence.fetch_add(1);
+                                    if (m_u32Waiters.load() > 0)
+                                        FutexWake(&m_u32Sequence, 1);
+                                }
+    void                        broadcast()                                                     //< wake up all blocked threads
+                                {
+                                    m_u32Sequence.fetch_add(1);
+                                    if (m_u32Waiters.load() > 0)
+                                        FutexWake(&m_u32Sequence, INT_MAX);
+                                }
+    void                        block(FutexMutex * pMutex)                                      //< indefinite
+                                { Wait(pMutex, NULL, false); }
+    enum eBlockReturns          blockTimed(FutexMutex * pMutex, const struct timespec * pAbstime)   //< absolute time
+                                { return Wait(pMutex, pAbstime, true); }
+    enum eBlockReturns          blockTimed(FutexMutex * pMutex, uint32_t u32USec)               //< interval
+                                {
+                                    struct timespec             ts;
+                                    ts.tv_sec  = u32USec / 1000000;
+                                    ts.tv_nsec = (u32USec % 1000000) * 1000;
+                                    return Wait(pMutex, &ts, false);
+                                }
+                                                                                                // and again for references
+    void                        block(FutexMutex & mutex)                                       //< indefinite
+                                { block(&mutex); }
+    enum eBlockReturns          blockTimed(FutexMutex & mutex, const struct timespec * pAbstime)    //< absolute time
+                                { return blockTimed(&mutex, pAbstime); }
+    enum eBlockReturns          blockTimed(FutexMutex & mutex, uint32_t uSec)                   //< interval
+                                { return blockTimed(&mutex, uSec); }
+
+private:
+    std::atomic<uint32_t>       m_u32Sequence;
+    std::atomic<uint32_t>       m_u32Waiters;
+
+                                // the waiter count and the sequence are each written before the other is read (seq_cst), so
+                                // either signal() sees us waiting or we see its new sequence and do not park
+    enum eBlockReturns          Wait(FutexMutex * pMutex, const struct timespec * pts, bool bAbsolute)
+                                {
+                                    m_u32Waiters.fetch_add(1);
+                                    uint32_t u32Sequence = m_u32Sequence.load();
+                                    pMutex->unlock();
+                                    int rc = FutexWait(&m_u32Sequence, u32Sequence, pts, bAbsolute);
+                                    pMutex->LockParked();
+                                    m_u32Waiters.fetch_sub(1);
+                                    return rc == ETIMEDOUT ? eBlockTimedOut : eBlockSignalled;
+                                }
+
+                                // disallow copy constructors
+                                FutexCondition(const FutexCondition &);
+    void                        operator=(const FutexCondition &);
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// wait for a known number of events - CountDown() from whoever finishes, Wait() from whoever needs them all finished
+class CountdownLatch
+{
+public:
+                                CountdownLatch(size_t uCount)   :
+                                    m_uCount(uCount)
+                                {}
+                                ~CountdownLatch()
+                                {}
+
+    void                        CountDown()
+                                {
+                                    Lock l(m_mutex);
+                                    if (m_uCount == 0)
+                                        return;
+                                    if (--m_uCount == 0)
+                                        m_cond.broadcast();
+                                }
+    void                        Wait()
+                                {
+                                    Lock l(m_mutex);
+                                    while (m_uCount > 0)
+                                        m_cond.block(m_mutex);
+                                }
+                                // false if the count has not reached zero by then
+    bool                        WaitTimed(uint32_t u32USec)
+                                {
+                                    struct timeval              tv;
+                                    struct timespec             ts;
+                                    gettimeofday(&tv, NULL);
+                                    ts.tv_sec  = tv.tv_sec + u32USec / 1000000;
+                                    ts.tv_nsec = (tv.tv_usec + u32USec % 1000000) * 1000;
+                                    if (ts.tv_nsec >= 1000000000)
+                                    {
+                                        ts.tv_sec  += 1;
+                                        ts.tv_nsec -= 1000000000;
+                                    }
+                                    Lock l(m_mutex);
+                                    while (m_uCount > 0)
+                                        if (m_cond.blockTimed(m_mutex, &ts) == Condition::eBlockTimedOut)
+                                            return m_uCount == 0;
+                                    return true;
+                                }
+    size_t                      GetCount()
+                                { Lock l(m_mutex); return m_uCount; }
+
+private:
+    Mutex                       m_mutex;
+    Condition                   m_cond;
+    size_t                      m_uCount;
+
+                                // disallow default construction / copy constructors
+                                CountdownLatch();
+                                CountdownLatch(const CountdownLatch &);
+    void                        operator=(const CountdownLatch &);
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// size-classed free lists for ThreadMessage objects and their payloads
+// each thread keeps its own cache, so a producer new'ing messages and a consumer delete'ing them do not meet in malloc; a
+// cache that outgrows its limit hands half of a class to the shared depot, and an empty one takes a batch back from it
+// blocks above the largest class go straight to malloc
+class MessagePool
+{
+public:
+    static void               * Alloc(size_t uBytes);
+                                // uBytes as given to Alloc() - it picks the size class
+    static void                 Free(void * p, size_t uBytes);
+                                // release the calling thread's cache and the depot back to malloc
+    static void                 Trim();
+
+private:
+                                // disallow default construction / copy constructors
+                                MessagePool();
+                                MessagePool(const MessagePool &);
+    void                        operator=(const MessagePool &);
+};
+
+//---------------------------------------------------------------------------------------------------------------------------------
+// immutable, reference-counted bytes - copying a SharedBuffer copies a pointer, never the payload, so one buffer can sit in
+// any number of ThreadMessages on any number of queues; the storage goes when the last copy does
+// a buffer is writable only while it is the sole copy: Allocate() one, fill it (e.g. straight from a socket), SetLength(),
+// then hand it on
+// copies on different threads are safe; one SharedBuffer object used from two threads at once is not
+class SharedBuffer
+{
+public:
+                                SharedBuffer()  :
+                                    m_pRep(NULL),
+                                    m_pu8Data(NULL),
+                                    m_uLen(0)
+                                {}
+                                SharedBuffer(const SharedBuffer & buf)  :
+                                    m_pRep(buf.m_pRep),
+                                    m_pu8Data(buf.m_pu8Data),
+                                    m_uLen(buf.m_uLen)
+                                {
+                                    if (m_pRep)
+                                        m_pRep->u32Refs.fetch_add(1, std::memory_order_relaxed);
+                                }
+                                SharedBuffer(SharedBuffer && buf)   :
+                                    m_pRep(buf.m_pRep),
+                                    m_pu8Data(buf.m_pu8Data),
+                                    m_uLen(buf.m_uLen)
+                                {
+                                    buf.m_pRep    = NULL;
+                                    buf.m_pu8Data = NULL;
+                                    buf.m_uLen    = 0;
+                                }
+                                ~SharedBuffer()
+                                { clear(); }
+
+    SharedBuffer              & operator=(const SharedBuffer & buf)
+                                {
+                                    SharedBuffer tmp(buf);
+                                    swap(tmp);
+                                    return *this;
+                                }
+    SharedBuffer              & operator=(SharedBuffer && buf)
+                                {
+                                    SharedBuffer tmp(std::move(buf));
+                                    swap(tmp);
+                                    return *this;
+                                }
+
+                                // the only copy of the bytes that is ever made
+    static SharedBuffer         Copy(const uint8_t * p, size_t l)
+                                {
+                                    SharedBuffer buf = Allocate(l);
+                                    if (l > 0)
+                                        memcpy(buf.m_pRep->pu8Storage, p, l);
+                                    buf.m_uLen = l;
+                                    return buf;
+                                }
+                                // uninitialised and empty - GetWritable(), then SetLength()
+    static SharedBuffer         Allocate(size_t uCapacity)
+                                {
+                                    size_t uAlloc = sizeof(Rep) + uCapacity;
+                                    Rep * pRep = new (MessagePool::Alloc(uAlloc)) Rep;
+                                    pRep->u32Refs.store(1, std::memory_order_relaxed);
+                                    pRep->pu8Storage = (uint8_t *) (pRep + 1);
+                                    pRep->uCapacity  = uCapacity;
+                                    pRep->uAlloc     = uAlloc;
+                                    pRep->bAdopted   = false;
+                                    return SharedBuffer(pRep, pRep->pu8Storage, 0);
+                                }
+                                // takes ownership of p, which must come from new uint8_t[] - no copy
+    static SharedBuffer         Adopt(uint8_t * p, size_t l)
+                                {
+                                    Rep * pRep = new (MessagePool::Alloc(sizeof(Rep))) Rep;
+                                    pRep->u32Refs.store(1, std::memory_order_relaxed);
+                                    pRep->pu8Storage = p;
+                                    pRep->uCapacity  = l;
+                                    pRep->uAlloc     = sizeof(Rep);
+                                    pRep->bAdopted   = true;
+                                    return SharedBuffer(pRep, p, l);
+                                }
+
+    const uint8_t             * GetData() const
+                                { return m_pu8Data; }
+    size_t                      GetLength() const
+                                { return m_uLen; }
+    bool                        empty() const
+                                { return m_uLen == 0; }
+                                // more references to the same bytes - clamped to what this buffer covers
+    SharedBuffer                Slice(size_t uOffset, size_t uLen) const
+                                {
+                                    if (uOffset > m_uLen)
+                                        uOffset = m_uLen;
+                                    if (uLen > m_uLen - uOffset)
+                                        uLen = m_uLen - uOffset;
+                                    SharedBuffer buf(*this);
+                                    buf.m_pu8Data += uOffset;
+                                    buf.m_uLen     = uLen;
+                                    return buf;
+                                }
+
+                                // NULL once the buffer has been copied (or sliced) - the bytes are then frozen
+    uint8_t                   * GetWritable()
+                                {
+                                    if (m_pRep == NULL || m_pRep->u32Refs.load(std::memory_order_acquire) != 1)
+                                        return NULL;
+                                    return m_pRep->pu8Storage;
+                                }
+    size_t                      GetCapacity() const
+                                { return m_pRep ? m_pRep->uCapacity : 0; }
+                                // after filling GetWritable() - length from the start of storage, up to the capacity
+    void                        SetLength(size_t uLen)
+                                {
+                                    if (GetWritable() == NULL)
+                                        return;
+                                    m_pu8Data = m_pRep->pu8Storage;
+                                    m_uLen    = uLen < m_pRep->uCapacity ? uLen : m_pRep->uCapacity;
+                                }
+
+    void                        clear()
+                                {
+                                    if (m_pRep && m_pRep->u32Refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                                    {
+                                        if (m_pRep->bAdopted)
+                                            delete [] m_pRep->pu8Storage;
+                                        size_t uAlloc = m_pRep->uAlloc;
+                                        m_pRep->~Rep();
+                                        MessagePool::Free(m_pRep, uAlloc);
+                                    }
+                                    m_pRep    = NULL;
+                                    m_pu8Data = NULL;
+                                    m_uLen    = 0;
+                                }
+    void                        swap(SharedBuffer & buf)
+                                {
+                                    std::swap(m_pRep, buf.m_pRep);
+                                    std::swap(m_pu8Data, buf.m_pu8Data);
+                                    std::swap(m_uLen, buf.m_uLen);
+                                }
+
+private:
+    struct Rep
+    {
+        std::atomic<uint32_t>   u32Refs;
+        uint8_t               * pu8Storage;             // just past the Rep unless adopted
+        size_t                  uCapacity;
+        size_t                  uAlloc;                 // bytes from MessagePool
+        bool                    bAdopted;
+    };
+
+                                SharedBuffer(Rep * pRep, uint8_t * pu8Data, size_t uLen)   :
+                                    m_pRep(pRep),
+                                    m_pu8Data(pu8Data),
+                                    m_uLen(uLen)
+                                {}
+
+    Rep                       * m_pRep;
+    const uint8_t             * m_pu8Data;
+    size_t                      m_uLen;
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 //
 class ThreadQueue;
@@ -260,9 +871,11 @@ class ThreadMessage
 {
 public:
                                 ThreadMessage() :
-                                    m_q_respond(NULL)
+                                    m_q_respond(NULL),
+                                    m_bRespondOwns(false),
+                                    m_buf(NULL),
+                                    m_buf_len(0)
                                 {
-                                    m_buf    = NULL;
                                     clear();
                                 }
     virtual                     ~ThreadMessage()
@@ -274,6 +887,7 @@ public:
                                 {
                                     m_ID = 0;
                                     m_q_respond = NULL;
+                                    m_bRespondOwns = false;
                                     m_bool[0] = false;
                                     m_bool[1] = false;
                                     m_str[0].clear();
@@ -282,10 +896,8 @@ public:
                                     m_int[1] = 0;
                                     m_dbl[0] = 0.0;
                                     m_dbl[1] = 0.0;
-                                    if (m_buf)
-                                        delete [] m_buf;
-                                    m_buf = NULL;
-                                    m_buf_len = 0;
+                                    m_sbuf.clear();
+                                    ClearLegacyBuf();
                                 }
 
     virtual void                SetID(uint32_t ID)
@@ -315,27 +927,58 @@ public:
     virtual double              GetDbl(size_t idx)
                                 { return m_dbl[idx]; }
     virtual void                SetBuf(const uint8_t * p, size_t l)
-                                { m_buf = new uint8_t [l]; memcpy(m_buf, p, l); m_buf_len = l; }
+                                { ClearLegacyBuf(); m_sbuf = SharedBuffer::Copy(p, l); }
+                                // no copy - the message holds another reference to the same bytes
+    virtual void                SetBuf(const SharedBuffer & buf)
+                                { ClearLegacyBuf(); m_sbuf = buf; }
     virtual const uint8_t     * GetBuf()
-                                { return m_buf; }
+                                { return m_buf != NULL ? m_buf : m_sbuf.GetData(); }
     virtual size_t              GetBufLen()
-                                { return m_buf_len; }
+                                { return m_buf != NULL ? m_buf_len : m_sbuf.GetLength(); }
+                                // empty if a subclass set m_buf itself
+    virtual const SharedBuffer& GetSharedBuf()
+                                { return m_sbuf; }
     virtual void                SetQRespond(ThreadQueue * q)
                                 { m_q_respond = q; }
     virtual ThreadQueue       * GetQRespond()
                                 { return m_q_respond; }
+                                // the respond queue owns the message - a queue destroyed with it still pending hands it back
+                                // through ThreadQueue::Abandon() rather than deleting it
+    virtual void                SetRespondOwns(bool bRespondOwns)
+                                { m_bRespondOwns = bRespondOwns; }
+    virtual bool                GetRespondOwns()
+                                { return m_bRespondOwns; }
+
+                                // messages - and every subclass, the virtual destructor hands delete the real size - are
+                                // recycled through MessagePool rather than malloc
+    static void               * operator new(size_t uBytes)
+                                { return MessagePool::Alloc(uBytes); }
+    static void                 operator delete(void * p, size_t uBytes)
+                                { MessagePool::Free(p, uBytes); }
 
 protected:
     ThreadQueue               * m_q_respond;
+    bool                        m_bRespondOwns;
     uint32_t                    m_ID;
     bool                        m_bool[2];
     std::string                 m_str[2];
     size_t                      m_int[2];
     float                       m_flt[2];
     double                      m_dbl[2];
+    SharedBuffer                m_sbuf;
+                                // as before SharedBuffer - a subclass may still hand a new[] block to m_buf/m_buf_len
+                                // directly; it is delete[]d by clear() and SetBuf(), and GetBuf() prefers it to m_sbuf
     uint8_t                   * m_buf;
     size_t                      m_buf_len;
 
+    void                        ClearLegacyBuf()
+                                {
+                                    if (m_buf)
+                                        delete [] m_buf;
+                                    m_buf     = NULL;
+                                    m_buf_len = 0;
+                                }
+
 private:
 
                                 // disallow default construction / copy constructors
@@ -412,15 +1055,25 @@ private:
 class ThreadQueue
 {
 public:
-                                ThreadQueue()
+                                ThreadQueue()   :
+                                    m_uWaiters(0)
                                 {}
     virtual                     ~ThreadQueue()
                                 {
                                     while (m_q.size() > 0)
-                                    {
-                                        ThreadMessage * msg = get();
+                                        Discard(get());
+                                }
+
+                                // a message we were put but that will now never be answered - the default deletes it
+    virtual void                Abandon(ThreadMessage * msg)
+                                { delete msg; }
+                                // a pending message at destruction - deleted, or handed back to a respond queue that owns it
+    static void                 Discard(ThreadMessage * msg)
+                                {
+                                    if (msg->GetRespondOwns() && msg->GetQRespond() != NULL)
+                                        msg->GetQRespond()->Abandon(msg);
+                                    else
                                         delete msg;
-                                    }
                                 }
 
     virtual void                put(ThreadMessage * msg)
@@ -429,6 +1082,17 @@ public:
                                     m_q.push(msg);
                                     m_cond.signal();
                                 }
+                                // a burst of messages for one lock and one wakeup
+                                // the consumer woken passes the wakeup on if it leaves messages for others
+    virtual void                putBatch(ThreadMessage ** ppMsgs, size_t uCount)
+                                {
+                                    if (uCount < 1)
+                                        return;
+                                    Lock l(m_mutex);
+                                    for (size_t i = 0; i < uCount; i++)
+                                        m_q.push(ppMsgs[i]);
+                                    m_cond.signal();
+                                }
                                 // non-blocking message queue read
                                 // returns NULL if queue is empty
     virtual ThreadMessage     * getNonBlocking()
@@ -452,9 +1116,12 @@ public:
                                         {
                                             ThreadMessage * msg = m_q.front();
                                             m_q.pop();
+                                            LockedPassWakeup();
                                             return msg;
                                         }
+                                        m_uWaiters++;
                                         m_cond.block(m_mutex);
+                                        m_uWaiters--;
                                     }
                                 }
                                 // timed message queue read
@@ -468,6 +1135,7 @@ public:
                                         {
                                             ThreadMessage * msg = m_q.front();
                                             m_q.pop();
+                                            LockedPassWakeup();
                                             return msg;
                                         }
                                         // we have to wait
@@ -475,7 +1143,10 @@ public:
                                             return NULL;
                                         // timed block.
                                         // timeout means return NULL ThreadMessage
-                                        if (m_cond.blockTimed(m_mutex, u32USec) == Condition::eBlockTimedOut)
+                                        m_uWaiters++;
+                                        FutexCondition::eBlockReturns eRC = m_cond.blockTimed(m_mutex, u32USec);
+                                        m_uWaiters--;
+                                        if (eRC == FutexCondition::eBlockTimedOut)
                                             return NULL;
                                     }
                                 }
@@ -489,13 +1160,58 @@ public:
                                         {
                                             ThreadMessage * msg = m_q.front();
                                             m_q.pop();
+                                            LockedPassWakeup();
                                             return msg;
                                         }
                                         // timed block.
-                                        if (m_cond.blockTimed(m_mutex, pts) == Condition::eBlockTimedOut)
+                                        m_uWaiters++;
+                                        FutexCondition::eBlockReturns eRC = m_cond.blockTimed(m_mutex, pts);
+                                        m_uWaiters--;
+                                        if (eRC == FutexCondition::eBlockTimedOut)
                                             return NULL;
                                     }
                                 }
+                                // batch message queue read - up to uMax messages in one lock
+                                // waits (forever) only while the queue is empty; returns how many were stored in ppMsgs
+    virtual size_t              getBatch(ThreadMessage ** ppMsgs, size_t uMax)
+                                {
+                                    Lock l(m_mutex);
+                                    while (m_q.size() < 1 && uMax > 0)
+                                    {
+                                        m_uWaiters++;
+                                        m_cond.block(m_mutex);
+                                        m_uWaiters--;
+                                    }
+                                    return LockedTakeBatch(ppMsgs, uMax);
+                                }
+                                // timed batch message queue read
+                                // u32USec == 0 means DO-NOT-BLOCK; timeout returns 0
+    virtual size_t              getBatch(ThreadMessage ** ppMsgs, size_t uMax, uint32_t u32USec)
+                                {
+                                    Lock l(m_mutex);
+                                    if (m_q.size() < 1 && u32USec > 0 && uMax > 0)
+                                    {
+                                        struct timeval              tv;
+                                        struct timespec             ts;
+                                        gettimeofday(&tv, NULL);
+                                        ts.tv_sec  = tv.tv_sec + u32USec / 1000000;
+                                        ts.tv_nsec = (tv.tv_usec + u32USec % 1000000) * 1000;
+                                        if (ts.tv_nsec >= 1000000000)
+                                        {
+                                            ts.tv_sec  += 1;
+                                            ts.tv_nsec -= 1000000000;
+                                        }
+                                        while (m_q.size() < 1)
+                                        {
+                                            m_uWaiters++;
+                                            FutexCondition::eBlockReturns eRC = m_cond.blockTimed(m_mutex, &ts);
+                                            m_uWaiters--;
+                                            if (eRC == FutexCondition::eBlockTimedOut)
+                                                break;
+                                        }
+                                    }
+                                    return LockedTakeBatch(ppMsgs, uMax);
+                                }
                                 // obtain size of queue
     virtual size_t              size()
                                 {
@@ -504,9 +1220,29 @@ public:
                                 }
 
 private:
-    Mutex                       m_mutex;
-    Condition                   m_cond;
+    FutexMutex                  m_mutex;
+    FutexCondition              m_cond;
     std::queue<ThreadMessage *> m_q;
+    size_t                      m_uWaiters;             // consumers blocked on m_cond
+
+                                // a batch put signals once - whoever takes from it wakes the next waiter if there is
+                                // anything left for them
+    void                        LockedPassWakeup()
+                                {
+                                    if (m_uWaiters > 0 && m_q.size() > 0)
+                                        m_cond.signal();
+                                }
+    size_t                      LockedTakeBatch(ThreadMessage ** ppMsgs, size_t uMax)
+                                {
+                                    size_t uCount = 0;
+                                    while (uCount < uMax && m_q.size() > 0)
+                                    {
+                                        ppMsgs[uCount++] = m_q.front();
+                                        m_q.pop();
+                                    }
+                                    LockedPassWakeup();
+                                    return uCount;
+                                }
 
                                 // disallow default construction / copy constructors
                                 //ThreadQueue();
@@ -514,19 +1250,65 @@ private:
     void                        operator=(const ThreadQueue &);
 };
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// where a Thread runs - hand one to Thread::SetPlacement() before go()
+// the thread applies it to itself before Run(); what the system refuses (a CPU that is not there, a real-time class without
+// the privilege) is logged and the thread runs anyway
+struct ThreadPlacement
+{
+    std::vector<int>            vecCPUs;                // empty - the NUMA node's CPUs if there is one, else anywhere
+    int                         nNUMANode;              // -1 none; otherwise memory comes from this node
+    bool                        bNUMAStrict;            // true MPOL_BIND (fail rather than go remote), false MPOL_PREFERRED
+    int                         nSchedPolicy;           // -1 inherit; SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO, SCHED_RR
+    int                         nSchedPriority;         // 1-99 for SCHED_FIFO/SCHED_RR, else 0
+
+                                ThreadPlacement()   :
+                                    nNUMANode(-1),
+                                    bNUMAStrict(true),
+                                    nSchedPolicy(-1),
+                                    nSchedPriority(0)
+                                {}
+
+    ThreadPlacement           & AddCPU(int nCPU)
+                                { vecCPUs.push_back(nCPU); return *this; }
+    ThreadPlacement           & SetNUMANode(int nNode, bool bStrict = true)
+                                { nNUMANode = nNode; bNUMAStrict = bStrict; return *this; }
+    ThreadPlacement           & SetScheduler(int nPolicy, int nPriority = 0)
+                                { nSchedPolicy = nPolicy; nSchedPriority = nPriority; return *this; }
+    bool                        empty() const
+                                { return vecCPUs.empty() && nNUMANode < 0 && nSchedPolicy < 0; }
+
+                                // from sysfs - -1 / empty when unknown (or not a NUMA machine)
+    static int                  GetNUMANodeOfNetDevice(const std::string & strInterface);
+    static std::vector<int>     GetCPUsOfNUMANode(int nNode);
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 // subclass this
 class Thread
 {
 public:
-                                Thread(uint32_t u32StackSize = THREAD_DEFAULT_STACK)    :
+                                // u32StackSize THREAD_SYSTEM_STACK (0) keeps the system default; anything else is rounded
+                                // up to whole pages and to PTHREAD_STACK_MIN
+                                Thread(uint32_t u32StackSize = THREAD_SYSTEM_STACK)     :
                                     mu32StackSize(u32StackSize)
                                 {
                                     Reset();
-                                    // XXX - jbates - NOTE: stack size is not placed in mAttr!!!
                                     int rc = pthread_attr_init(&mAttr);
+                                    if (rc != 0)
+                                    {
+                                        std::cerr << "pthread_attr_init: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                        abort();
+                                    }
+                                    if (u32StackSize == THREAD_SYSTEM_STACK)
+                                        return;
+                                    size_t uPage  = (size_t) sysconf(_SC_PAGESIZE);
+                                    size_t uStack = ((size_t) u32StackSize + uPage - 1) / uPage * uPage;
+                                    if (uStack < (size_t) PTHREAD_STACK_MIN)
+                                        uStack = PTHREAD_STACK_MIN;
+                                    rc = pthread_attr_setstacksize(&mAttr, uStack);
                                     if (rc == 0) return;
-                                    std::cerr << "pthread_attr_init: rc: " << rc << " " << std::strerror(rc) << std::endl;
+                                    std::cerr << "pthread_attr_setstacksize: rc: " << rc << " " << std::strerror(rc) << std::endl;
                                     abort();
                                 }
     virtual                     ~Thread()
@@ -587,6 +1369,12 @@ public:
                                     abort();
                                 }
 
+                                // before go()
+    void                        SetPlacement(const ThreadPlacement & placement)
+                                { Lock l(mCSLocal); assert(mbStarted == false); mPlacement = placement; }
+    uint32_t                    GetStackSize()
+                                { Lock l(mCSLocal); return mu32StackSize; }
+
     pthread_t                   GetID()
                                 { Lock l(mCSLocal); return mID; }
     bool                        GetStarted()
@@ -601,6 +1389,14 @@ public:
     void                        Queue(ThreadMessage * m)
                                 { mQ.put(m); }
 
+                                // whose work the calling thread is doing - the Thread itself inside Run(), the poster inside
+                                // a ThreadPool task, or whatever a ThreadActingFor scope says; NULL on other threads
+    static Thread *             GetActingFor();
+                                // returns the one it replaces
+    static Thread *             SetActingFor(Thread * pThread);
+    void                        QueueBatch(ThreadMessage ** ppMsgs, size_t uCount)
+                                { mQ.putBatch(ppMsgs, uCount); }
+
 protected:
 
     ThreadQueue                 mQ;
@@ -613,6 +1409,8 @@ protected:
                                 { return mQ.getTimed(u32USec); }
     ThreadMessage             * DeQueueTimed(struct timespec * pts)
                                 { return mQ.getTimed(pts); }
+    size_t                      DeQueueBatch(ThreadMessage ** ppMsgs, size_t uMax, uint32_t u32USec)
+                                { return mQ.getBatch(ppMsgs, uMax, u32USec); }
 
                                 // implement this
     virtual void                Run() = 0;
@@ -628,7 +1426,10 @@ private:
     volatile bool               mbJoined;
 
     static void               * ProcWrapThread(void * pvArg);
+                                // on the new thread, before Run()
+    void                        ApplyPlacement();
     pthread_attr_t              mAttr;
+    ThreadPlacement             mPlacement;
 
                                 // disallow default construction / copy constructors
                                 //Thread();
@@ -636,6 +1437,27 @@ private:
     void                        operator=(const Thread &);
 };
 
+//---------------------------------------------------------------------------------------------------------------------------------
+// answer a child's message from some other thread as the child - its acknowledgement of a concurrent SendAllChildren() then
+// counts as the child's
+class ThreadActingFor
+{
+public:
+                                ThreadActingFor(Thread * pThread)   :
+                                    m_pPrevious(Thread::SetActingFor(pThread))
+                                {}
+                                ~ThreadActingFor()
+                                { Thread::SetActingFor(m_pPrevious); }
+
+private:
+    Thread                    * m_pPrevious;
+
+                                // disallow default construction / copy constructors
+                                ThreadActingFor();
+                                ThreadActingFor(const ThreadActingFor &);
+    void                        operator=(const ThreadActingFor &);
+};
+
 //---------------------------------------------------------------------------------------------------------------------------------
 //
 class ThreadMother
@@ -656,6 +1478,18 @@ public:
     virtual void                Infanticide();
     virtual void                ReapChildren();
     virtual void                SendAllChildren(ThreadMessage * m);
+                                // concurrent - m is queued to every child at once (children must only read it) and the
+                                // acknowledgements, m put back on GetQRespond() as usual, are counted down on a latch
+                                // i64Timeout (uS) < 1 waits for them all; otherwise false on timeout, with the children
+                                // that had not answered in pvecMissing (valid until they are reaped); a child reaped with
+                                // m still queued counts as not answering.  An answer is the child's if it comes from the
+                                // child's thread, from a ThreadPool task it posted, or under a ThreadActingFor for it
+                                // true - m is the caller's again; false - m is consumed: deleted here if no child still
+                                // holds it, else once the last of them answers or is reaped
+    virtual bool                SendAllChildren(ThreadMessage * m, int64_t i64Timeout, std::vector<Thread *> * pvecMissing = NULL);
+                                // fire-and-forget fan-out - each child is queued its own message (u32ID and one more
+                                // reference to buf, no copy) and the call returns without waiting for any of them
+    virtual void                PostAllChildren(uint32_t u32ID, const SharedBuffer & buf);
 
 protected:
     virtual Thread *            LockedChildBirth(Thread * t)
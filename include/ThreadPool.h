@@ -0,0 +1,202 @@
+//============================================================================================================================= 132
+//
+//  ThreadPool.h
+//
+//      Work-stealing executor - short tasks without a pthread_create()/join each.
+//
+//      A fixed set of worker threads each own a deque of tasks.  A worker takes its own newest task first (it is the one
+//      most likely still in cache) and, when it has none, steals the oldest task from another worker, so a burst submitted
+//      to one place spreads over every core.  Tasks submitted from outside the pool are dealt round-robin; tasks submitted
+//      from inside a task go to the submitting worker's own deque.  Idle workers sleep and are woken only when there is
+//      something for them.
+//
+//      Submit() takes any callable and hands back a std::future for its result (or its exception).  Dispatch() is the
+//      ThreadMessage flavour: the handler runs on a worker and the message is then put on its GetQRespond() queue, or
+//      deleted if it has none.
+//
+//      Stop() (and the destructor) let the workers finish everything already queued.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <atomic>
+#include <deque>
+#include <future>
+#include <utility>
+#include <vector>
+
+#include "Exception.h"
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+DECLARE_LIBTHROCKET_EXCEPTION_CLASS(libthrocket,ThreadPool)
+DECLARE_LIBTHROCKET_EXCEPTION_SUBCLASS(libthrocket,ThreadPool,Stopped)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// defaults - worker threads (0 is one per online CPU), and how often (uS) a sleeping worker looks round for work it may
+// have missed and for a stop request
+#define THREAD_POOL_WORKERS     0
+#define THREAD_POOL_POLL        (100 * 1000)
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - or use Submit() with a lambda
+class ThreadPoolTask
+{
+    public:
+                                ThreadPoolTask()    :
+                                    m_pActingFor(NULL)
+                                {}
+        virtual                 ~ThreadPoolTask()
+                                {}
+
+                                // runs once on some worker, acting for the Thread that posted it; the pool deletes the
+                                // task afterwards
+        virtual void            Run()   =   0;
+
+    private:
+        friend class ThreadPool;
+
+        Thread                * m_pActingFor;
+
+                                // disallow copy constructors
+                                ThreadPoolTask(const ThreadPoolTask &);
+        void                    operator=(const ThreadPoolTask &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// implement this - called concurrently from every worker
+class ThreadPoolMessageHandler
+{
+    public:
+                                ThreadPoolMessageHandler()
+                                {}
+        virtual                 ~ThreadPoolMessageHandler()
+                                {}
+
+        virtual void            OnMessage(ThreadMessage * msg)  =   0;
+
+    private:
+                                // disallow copy constructors
+                                ThreadPoolMessageHandler(const ThreadPoolMessageHandler &);
+        void                    operator=(const ThreadPoolMessageHandler &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a callable and the promise behind Submit()'s future
+template<typename R> class ThreadPoolTaskFuture : public ThreadPoolTask
+{
+    public:
+                                ThreadPoolTaskFuture(std::packaged_task<R()> && task)   :
+                                    m_task(std::move(task))
+                                {}
+
+        virtual void            Run()
+                                { m_task(); }
+
+    private:
+        std::packaged_task<R()> m_task;
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class ThreadPool            :   public ThreadMother
+{
+    friend class ThreadPoolWorker;
+
+    public:
+                                ThreadPool(uint32_t u32Workers = THREAD_POOL_WORKERS, uint32_t u32StackSize = THREAD_SYSTEM_STACK);
+        virtual                 ~ThreadPool();
+
+                                // the future carries the result, or whatever the callable threw
+        template<typename F>
+        std::future<decltype(std::declval<F &>()())> Submit(F && f)
+                                {
+                                    typedef decltype(std::declval<F &>()()) R;
+                                    std::packaged_task<R()> task(std::forward<F>(f));
+                                    std::future<R> future = task.get_future();
+                                    Post(new ThreadPoolTaskFuture<R>(std::move(task)));
+                                    return future;
+                                }
+                                // the pool owns pTask from here on; throws ThreadPoolStoppedException after Stop()
+        virtual void            Post(ThreadPoolTask * pTask);
+                                // pHandler->OnMessage(msg) on a worker, then msg to msg->GetQRespond() (or deleted)
+        virtual void            Dispatch(ThreadMessage * msg, ThreadPoolMessageHandler * pHandler);
+
+                                // finishes every queued task, then joins the workers
+        virtual void            Stop();
+
+        virtual uint32_t        GetNumWorkers() const
+                                { return m_u32Workers; }
+        virtual size_t          GetNumQueued() const
+                                { return m_uQueued.load(std::memory_order_relaxed); }
+        virtual uint64_t        GetNumSteals() const
+                                { return m_u64Steals.load(std::memory_order_relaxed); }
+
+    protected:
+
+        struct WorkerDeque
+        {
+            Mutex               mutex;
+            std::deque<ThreadPoolTask *> deq;
+        };
+
+                                // worker threads - own deque from the back, anybody else's from the front
+        ThreadPoolTask *        Take(uint32_t u32Worker);
+        void                    Work(uint32_t u32Worker);
+        void                    Sleep();
+        void                    Push(uint32_t u32Worker, ThreadPoolTask * pTask);
+
+    private:
+
+        uint32_t                m_u32Workers;
+        std::vector<WorkerDeque *> m_vecDeques;
+        std::atomic<uint32_t>   m_u32NextWorker;
+        std::atomic<size_t>     m_uQueued;
+        std::atomic<uint32_t>   m_u32Sleeping;
+        std::atomic<uint64_t>   m_u64Steals;
+        std::atomic<bool>       m_bStopped;
+
+        Mutex                   m_mutexIdle;
+        Condition               m_condIdle;
+
+                                // disallow copy constructors
+                                ThreadPool(const ThreadPool &);
+        void                    operator=(const ThreadPool &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
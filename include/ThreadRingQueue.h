@@ -0,0 +1,147 @@
+//============================================================================================================================= 132
+//
+//  ThreadRingQueue.h
+//
+//      Bounded lock-free ThreadQueue for high-rate thread pipelines.
+//
+//      A ThreadQueue takes a mutex and signals a condition on every put(), so each message costs a lock and, often, a
+//      futex wake.  ThreadRingQueue keeps the messages in a fixed power-of-two ring of slots instead: producers claim a slot
+//      with one atomic (none at all with a single producer), and the consumer takes it with plain loads and stores.  The
+//      mutex and condition are only touched when the consumer has run dry and actually gone to sleep - a producer that
+//      finds it awake never makes a system call.
+//
+//      There is exactly ONE consumer: get(), getTimed() and getNonBlocking() must not be called from two threads at once.
+//      eSingleProducer additionally promises that only one thread ever calls put().  A put() into a full ring waits for
+//      room; tryPut() reports it instead.
+//
+//      It is a ThreadQueue, so it can stand in wherever one is passed (e.g. ThreadMessage::SetQRespond()).
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <atomic>
+
+#include "ThreadMinimal.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// defaults - ring slots (rounded up to a power of two), how many times an empty consumer polls before it sleeps, how many
+// times a put() into a full ring yields the CPU before backing off, and how long (uS) it then backs off between retries
+#define THREAD_RING_DEFAULT_CAPACITY    4096
+#define THREAD_RING_SPIN                128
+#define THREAD_RING_FULL_YIELDS         128
+#define THREAD_RING_FULL_WAIT           50
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class ThreadRingQueue       :   public ThreadQueue
+{
+    public:
+                                enum eProducers
+                                {
+                                    eSingleProducer =   0,
+                                    eMultiProducer  =   1
+                                };
+
+                                ThreadRingQueue(eProducers eMode = eMultiProducer, uint32_t u32Capacity = THREAD_RING_DEFAULT_CAPACITY);
+        virtual                 ~ThreadRingQueue();
+
+                                // waits for room if the ring is full
+        virtual void            put(ThreadMessage * msg);
+                                // false if the ring is full - the message still belongs to the caller
+        virtual bool            tryPut(ThreadMessage * msg);
+                                // one wakeup check for the lot, waiting for room as put() does
+        virtual void            putBatch(ThreadMessage ** ppMsgs, size_t uCount);
+
+                                // consumer thread only
+        virtual ThreadMessage * getNonBlocking()
+                                { return Take(); }
+        virtual ThreadMessage * get()
+                                { return Park(NULL); }
+                                // u32USec == 0 means DO-NOT-BLOCK
+        virtual ThreadMessage * getTimed(uint32_t u32USec = 0);
+        virtual ThreadMessage * getTimed(struct timespec * pts)
+                                { return Park(pts); }
+                                // waits as get()/getTimed() for the first message, then takes whatever else is there
+        virtual size_t          getBatch(ThreadMessage ** ppMsgs, size_t uMax);
+        virtual size_t          getBatch(ThreadMessage ** ppMsgs, size_t uMax, uint32_t u32USec);
+
+                                // a snapshot - producers and the consumer may be moving it as it is read
+        virtual size_t          size();
+        virtual uint32_t        GetCapacity() const
+                                { return m_u32Capacity; }
+
+    protected:
+
+        struct Slot
+        {
+                                // == position + 1 once a message is in; == position + capacity once it is taken
+            std::atomic<uint64_t> u64Sequence;
+            ThreadMessage     * pMessage;
+        };
+
+                                // into the ring without waking anyone, false if full
+        bool                    Publish(ThreadMessage * msg);
+                                // one attempt from the consumer, NULL if empty
+        ThreadMessage *         Take();
+        size_t                  TakeBatch(ThreadMessage ** ppMsgs, size_t uMax);
+                                // spin, then sleep until a message or pts (absolute, NULL is forever) passes
+        ThreadMessage *         Park(struct timespec * pts);
+                                // after a message is published - signal only a consumer that is really asleep
+        void                    Wake();
+
+    private:
+
+        eProducers              m_eMode;
+        uint32_t                m_u32Capacity;
+        uint32_t                m_u32Spin;              // 0 on one CPU - nobody can publish while we spin
+        uint64_t                m_u64Mask;
+        Slot                  * m_pSlots;
+
+                                // producers, the consumer and the sleep flag each get their own cache line
+        alignas(64) std::atomic<uint64_t> m_u64Tail;
+        alignas(64) std::atomic<uint64_t> m_u64Head;
+        alignas(64) std::atomic<bool> m_bSleeping;
+
+        Mutex                   m_mutex;
+        Condition               m_cond;
+
+                                // disallow copy constructors
+                                ThreadRingQueue(const ThreadRingQueue &);
+        void                    operator=(const ThreadRingQueue &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
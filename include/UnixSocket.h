@@ -0,0 +1,304 @@
+//============================================================================================================================= 132
+//
+//  UnixSocket.h
+//
+//      AF_UNIX stream and datagram sockets for same-host IPC - no TCP/IP stack, no checksums, no loopback routing.
+//
+//      They share the Socket base with the TCP classes: the same timeouts, Select()/Wait(), optimistic I/O and Locked*
+//      layering.  A path starting with '@' is in the Linux abstract namespace - no file, gone with the last socket.
+//      Descriptors can be handed across with SCM_RIGHTS (SendFDs()/RecvFDs()).
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include <string>
+
+#include "Exception.h"
+#include "Socket.h"
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// most descriptors one SendFDs()/RecvFDs() carries - the kernel's own limit (SCM_MAX_FD) is 253
+#define UNIX_SOCKET_MAX_FDS     64
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class UnixSocket            :   public Socket
+{
+    public:
+                                UnixSocket
+                                (
+                                    int                 nSocket,
+                                    int                 nSocketType,
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    Socket(nSocket, nSocketType, i64RecvTimeout, i64SendTimeout)
+                                {}
+
+                                UnixSocket
+                                (
+                                    int                 nSocketType,
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    Socket(nSocketType, i64RecvTimeout, i64SendTimeout)
+                                {}
+                                // removes the socket file Bind() made
+        virtual                 ~UnixSocket();
+
+        virtual void            Open()
+                                { libthrocket::Lock l(&m_CSLocal); LockedOpen(); }
+                                // a socket file nobody is listening on is taken as left over from a crash and replaced;
+                                // Close() removes the file again
+        virtual void            Bind(const std::string& strPath, int nListenLen = 0)
+                                { libthrocket::Lock l(&m_CSLocal); LockedBind(strPath, nListenLen); }
+
+        virtual const std::string GetLocalPath()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedGetLocalPath(); }
+                                // "" when the peer never bound (the usual case for a client)
+        virtual const std::string GetPeerPath()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedGetPeerPath(); }
+                                // SO_PEERCRED - who is on the other end, as of connect(); stream and connected datagram sockets
+        virtual void            GetPeerCredentials(pid_t& pid, uid_t& uid, gid_t& gid)
+                                { libthrocket::Lock l(&m_CSLocal); LockedGetPeerCredentials(pid, uid, gid); }
+
+                                // strPath <-> sockaddr_un, '@' for the abstract namespace
+        static void             EncodePath(const std::string& strPath, struct sockaddr_un& sun, socklen_t& slen);
+        static const std::string DecodePath(const struct sockaddr_un& sun, socklen_t slen);
+
+    protected:
+
+        virtual void            LockedOpen();
+        virtual void            LockedBind(const std::string& strPath, int nListenLen);
+        virtual void            LockedClose();
+
+        virtual const std::string LockedGetLocalPath();
+        virtual const std::string LockedGetPeerPath();
+        virtual const std::string LockedGetPeerAddrString()
+                                { return LockedGetPeerPath(); }
+        virtual void            LockedGetPeerCredentials(pid_t& pid, uid_t& uid, gid_t& gid);
+
+                                // one sendmsg()/recvmsg() loop with TCPSocket::Send()/Recv() timeout and partial-transfer
+                                // semantics.  msg_control goes with the first call only (a resend would duplicate the
+                                // descriptors); on return msg_controllen is what that call brought back
+        uint32_t                LockedTransferMsg(bool bDirection, struct msghdr* pmsg, bool bShort);
+                                // pack pnFDs into pu8Control (CMSG_SPACE(UNIX_SOCKET_MAX_FDS * sizeof(int)) bytes)
+        static void             PackFDs(struct msghdr* pmsg, uint8_t* pu8Control, const int* pnFDs, uint32_t u32FDs);
+                                // copy out up to u32FDs received descriptors, closing any that do not fit
+        static void             UnpackFDs(struct msghdr* pmsg, int* pnFDs, uint32_t& u32FDs);
+
+    private:
+
+        std::string             m_strBoundPath;         // socket file to remove on close
+
+                                // disallow default construction / copy constructors
+                                UnixSocket();
+                                UnixSocket(const UnixSocket &);
+        void                    operator=(const UnixSocket &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class UnixStreamSocket      :   public UnixSocket
+{
+    public:
+                                UnixStreamSocket
+                                (
+                                    int                 nSocket,
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    UnixSocket(nSocket, SOCK_STREAM, i64RecvTimeout, i64SendTimeout),
+                                    m_bConnected(nSocket != INVALID_SOCKET)
+                                {}
+
+                                UnixStreamSocket
+                                (
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    UnixSocket(SOCK_STREAM, i64RecvTimeout, i64SendTimeout),
+                                    m_bConnected(false)
+                                {}
+        virtual                 ~UnixStreamSocket()
+                                {}
+
+                                // SocketWouldBlockException while the listener's backlog is full - back off and try again
+        virtual void            Connect(const std::string& strPath)
+                                { libthrocket::Lock l(&m_CSLocal); LockedConnect(strPath); }
+        virtual void            Disconnect()
+                                { libthrocket::Lock l(&m_CSLocal); LockedDisconnect(); }
+
+        virtual uint32_t        Send(const uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransfer(SOCKET_TRANSFER_SEND, (uint8_t*) pu8Bytes, u32Bytes, false/*bShort*/); }
+        virtual uint32_t        Recv(uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort = false)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedTransfer(SOCKET_TRANSFER_RECV, pu8Bytes, u32Bytes, bShort); }
+        virtual uint32_t        RecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecvAll(pu8Bytes, u32Bytes); }
+
+                                // SCM_RIGHTS - the descriptors ride with the first byte, so u32Bytes must be at least 1;
+                                // the sender's copies stay open
+        virtual uint32_t        SendFDs(const uint8_t* pu8Bytes, uint32_t u32Bytes, const int* pnFDs, uint32_t u32FDs)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSendFDs(pu8Bytes, u32Bytes, pnFDs, u32FDs); }
+                                // returns after one read, like Recv(bShort), so descriptors are never split from their bytes;
+                                // u32FDs is room in, received out - they are close-on-exec and the caller's to close
+        virtual uint32_t        RecvFDs(uint8_t* pu8Bytes, uint32_t u32Bytes, int* pnFDs, uint32_t& u32FDs)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecvFDs(pu8Bytes, u32Bytes, pnFDs, u32FDs); }
+
+        virtual bool            IsConnected() const
+                                { return m_nSocket != -1 && m_bConnected; }
+
+    protected:
+
+        virtual void            LockedConnect(const std::string& strPath);
+        virtual void            LockedDisconnect()
+                                { m_bConnected = false; LockedClose(); }
+
+        virtual uint32_t        LockedTransfer(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort);
+        virtual uint32_t        LockedRecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes);
+        virtual uint32_t        LockedSendFDs(const uint8_t* pu8Bytes, uint32_t u32Bytes, const int* pnFDs, uint32_t u32FDs);
+        virtual uint32_t        LockedRecvFDs(uint8_t* pu8Bytes, uint32_t u32Bytes, int* pnFDs, uint32_t& u32FDs);
+
+    private:
+
+        bool                    m_bConnected;
+
+                                // disallow default construction / copy constructors
+                                UnixStreamSocket();
+                                UnixStreamSocket(const UnixStreamSocket &);
+        void                    operator=(const UnixStreamSocket &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class UnixAcceptSocket      :   public UnixSocket
+{
+    public:
+                                UnixAcceptSocket
+                                (
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    UnixSocket(SOCK_STREAM, i64RecvTimeout, i64SendTimeout)
+                                {}
+        virtual                 ~UnixAcceptSocket()
+                                {}
+
+                                // accepted sockets inherit our timeouts
+        virtual UnixStreamSocket * Accept(int64_t i64AcceptTimeout)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedAccept(i64AcceptTimeout); }
+                                // never waits - returns NULL once the backlog is drained; the socket is non-blocking
+        virtual UnixStreamSocket * AcceptNonBlocking()
+                                { libthrocket::Lock l(&m_CSLocal); return LockedAcceptNonBlocking(); }
+
+    protected:
+
+        virtual void            LockedBind(const std::string& strPath, int nListenLen);
+        virtual UnixStreamSocket * LockedAccept(int64_t i64AcceptTimeout);
+        virtual UnixStreamSocket * LockedAcceptNonBlocking();
+                                // INVALID_SOCKET when there is nothing left to accept
+        virtual int             LockedAcceptFD(int nFlags);
+
+    private:
+                                // disallow default construction / copy constructors
+                                UnixAcceptSocket();
+                                UnixAcceptSocket(const UnixAcceptSocket &);
+        void                    operator=(const UnixAcceptSocket &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// datagrams keep their boundaries and, unlike UDP, are never dropped - a full receiver makes the sender wait
+class UnixDatagramSocket    :   public UnixSocket
+{
+    public:
+                                UnixDatagramSocket
+                                (
+                                    int                 nSocket,
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    UnixSocket(nSocket, SOCK_DGRAM, i64RecvTimeout, i64SendTimeout)
+                                {}
+
+                                UnixDatagramSocket
+                                (
+                                    int64_t             i64RecvTimeout,
+                                    int64_t             i64SendTimeout
+                                )   :
+                                    UnixSocket(SOCK_DGRAM, i64RecvTimeout, i64SendTimeout)
+                                {}
+        virtual                 ~UnixDatagramSocket()
+                                {}
+
+                                // fixes the destination for the path-less Send()/SendFDs()
+        virtual void            Connect(const std::string& strPath)
+                                { libthrocket::Lock l(&m_CSLocal); LockedConnect(strPath); }
+
+                                // strPath "" sends to the Connect()ed peer; received strPath is "" from an unbound sender
+        virtual uint32_t        Send(const std::string& strPath, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSend(strPath, pu8Bytes, u32Bytes, NULL, 0); }
+        virtual uint32_t        Recv(std::string& strPath, uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecv(strPath, pu8Bytes, u32Bytes, NULL, NULL); }
+        virtual uint32_t        Send(const uint8_t* pu8Bytes, uint32_t u32Bytes)
+                                { return Send(std::string(), pu8Bytes, u32Bytes); }
+
+                                // SCM_RIGHTS, as UnixStreamSocket - the descriptors arrive with this datagram
+        virtual uint32_t        SendFDs(const std::string& strPath, const uint8_t* pu8Bytes, uint32_t u32Bytes, const int* pnFDs,
+                                        uint32_t u32FDs)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedSend(strPath, pu8Bytes, u32Bytes, pnFDs, u32FDs); }
+        virtual uint32_t        RecvFDs(std::string& strPath, uint8_t* pu8Bytes, uint32_t u32Bytes, int* pnFDs, uint32_t& u32FDs)
+                                { libthrocket::Lock l(&m_CSLocal); return LockedRecv(strPath, pu8Bytes, u32Bytes, pnFDs, &u32FDs); }
+
+    protected:
+
+        virtual void            LockedConnect(const std::string& strPath);
+        virtual uint32_t        LockedSend(const std::string& strPath, const uint8_t* pu8Bytes, uint32_t u32Bytes, const int* pnFDs,
+                                           uint32_t u32FDs);
+                                // pu32FDs NULL takes no descriptors
+        virtual uint32_t        LockedRecv(std::string& strPath, uint8_t* pu8Bytes, uint32_t u32Bytes, int* pnFDs, uint32_t* pu32FDs);
+
+    private:
+                                // disallow default construction / copy constructors
+                                UnixDatagramSocket();
+                                UnixDatagramSocket(const UnixDatagramSocket &);
+        void                    operator=(const UnixDatagramSocket &);
+};
+
+};  // namespace libthrocket
+
+//============================================================================================================================= 132
@@ -0,0 +1,227 @@
+//============================================================================================================================= 132
+//
+//  HTTPClientPool.cc
+//
+//      Warm keep-alive HTTPClient connections, keyed by "ip:port".
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <functional>
+
+#include "AlarmDebugLog.h"
+#include "HTTPClientPool.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPClientPool::HTTPClientPool
+(
+    int64_t                     i64RecvTimeout,
+    int64_t                     i64SendTimeout,
+    uint32_t                    u32MaxIdlePerHost,
+    int64_t                     i64IdleTimeout
+)   :
+    m_i64RecvTimeout(i64RecvTimeout),
+    m_i64SendTimeout(i64SendTimeout),
+    m_u32MaxIdlePerHost(u32MaxIdlePerHost),
+    m_i64IdleTimeout(i64IdleTimeout)
+{
+    if (i64IdleTimeout < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "i64IdleTimeout " + std::to_string(i64IdleTimeout));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPClientPool::~HTTPClientPool()
+{
+    for (size_t i = 0; i < HTTP_POOL_SHARDS; i++)
+    {
+        libthrocket::Lock       l(&m_aShards[i].m_CSLocal);
+
+        std::map<std::string, std::vector<Idle> >::iterator it;
+        for (it = m_aShards[i].mapIdle.begin(); it != m_aShards[i].mapIdle.end(); ++it)
+            for (size_t j = 0; j < it->second.size(); j++)
+                delete it->second[j].pClient;
+        m_aShards[i].mapIdle.clear();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPClientPool::Shard &
+libthrocket::HTTPClientPool::GetShard(const string& strKey)
+{
+    return m_aShards[std::hash<std::string>()(strKey) % HTTP_POOL_SHARDS];
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// most recently released first - it is the least likely to have been timed out by the server
+libthrocket::HTTPClient *
+libthrocket::HTTPClientPool::Acquire(const string& strIPAddr, uint16_t u16Port)
+{
+    string                      strKey                  =   Key(strIPAddr, u16Port);
+    Shard                     & shard                   =   GetShard(strKey);
+
+    while (1)
+    {
+        Idle                    idle;
+        {
+            libthrocket::Lock   l(&shard.m_CSLocal);
+
+            std::map<std::string, std::vector<Idle> >::iterator it = shard.mapIdle.find(strKey);
+            if (it == shard.mapIdle.end() || it->second.size() < 1)
+                break;
+            idle = it->second.back();
+            it->second.pop_back();
+        }
+
+        // probe without the shard lock - it is a syscall
+        if (TimeuS64() - idle.i64Since < m_i64IdleTimeout && idle.pClient->IsStale() == false)
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "HTP> pool: %s reuse %d", strKey.c_str(), idle.pClient->GetFD());
+            return idle.pClient;
+        }
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTP> pool: %s drop stale %d", strKey.c_str(), idle.pClient->GetFD());
+        delete idle.pClient;
+    }
+
+    HTTPClient                * pClient                 =   new HTTPClient(strIPAddr, u16Port, m_i64RecvTimeout, m_i64SendTimeout);
+    try
+    {
+        pClient->Connect();
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        delete pClient;
+        throw;
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "HTP> pool: %s new %d", strKey.c_str(), pClient->GetFD());
+
+    return pClient;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPClientPool::Release(HTTPClient * pClient, bool bReusable)
+{
+    if (pClient == NULL)
+        return;
+
+    if (bReusable == false || pClient->IsConnected() == false || m_u32MaxIdlePerHost < 1)
+    {
+        delete pClient;
+        return;
+    }
+
+    string                      strKey                  =   Key(pClient->GetIPAddr(), pClient->GetPort());
+    Shard                     & shard                   =   GetShard(strKey);
+    HTTPClient                * pEvicted                =   NULL;
+    Idle                        idle;
+
+    idle.pClient    = pClient;
+    idle.i64Since   = TimeuS64();
+
+    {
+        libthrocket::Lock       l(&shard.m_CSLocal);
+
+        std::vector<Idle>     & vecIdle                 =   shard.mapIdle[strKey];
+        if (vecIdle.size() >= m_u32MaxIdlePerHost)
+        {
+            pEvicted = vecIdle.front().pClient;
+            vecIdle.erase(vecIdle.begin());
+        }
+        vecIdle.push_back(idle);
+    }
+
+    delete pEvicted;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::HTTPClientPool::Prune()
+{
+    std::vector<HTTPClient *>   vecExpired;
+    int64_t                     i64Cutoff               =   TimeuS64() - m_i64IdleTimeout;
+
+    for (size_t i = 0; i < HTTP_POOL_SHARDS; i++)
+    {
+        libthrocket::Lock       l(&m_aShards[i].m_CSLocal);
+
+        std::map<std::string, std::vector<Idle> >::iterator it = m_aShards[i].mapIdle.begin();
+        while (it != m_aShards[i].mapIdle.end())
+        {
+            std::vector<Idle> & vecIdle                 =   it->second;
+            size_t              uExpired                =   0;
+            while (uExpired < vecIdle.size() && vecIdle[uExpired].i64Since <= i64Cutoff)
+                vecExpired.push_back(vecIdle[uExpired++].pClient);
+            vecIdle.erase(vecIdle.begin(), vecIdle.begin() + uExpired);
+
+            if (vecIdle.size() < 1)
+                m_aShards[i].mapIdle.erase(it++);
+            else
+                ++it;
+        }
+    }
+
+    for (size_t i = 0; i < vecExpired.size(); i++)
+        delete vecExpired[i];
+
+    return vecExpired.size();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::HTTPClientPool::GetNumIdle()
+{
+    size_t                      uIdle                   =   0;
+
+    for (size_t i = 0; i < HTTP_POOL_SHARDS; i++)
+    {
+        libthrocket::Lock       l(&m_aShards[i].m_CSLocal);
+
+        std::map<std::string, std::vector<Idle> >::iterator it;
+        for (it = m_aShards[i].mapIdle.begin(); it != m_aShards[i].mapIdle.end(); ++it)
+            uIdle += it->second.size();
+    }
+
+    return uIdle;
+}
+
+//============================================================================================================================= 132
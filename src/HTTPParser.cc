@@ -0,0 +1,534 @@
+//============================================================================================================================= 132
+//
+//  HTTPParser.cc
+//
+//      Incremental, allocation-free HTTP/1.1 message parsing.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <string.h>
+#include <strings.h>
+
+#include "AlarmDebugLog.h"
+#include "HTTPParser.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// stand in when the caller only wants framing
+static libthrocket::HTTPResponseHandler s_handlerResponseNone;
+static libthrocket::HTTPRequestHandler  s_handlerRequestNone;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+static inline bool IsHTTPSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// case-insensitive token match inside a comma separated header value, e.g. "keep-alive, Upgrade"
+static bool HTTPHasToken(const char* pcValue, size_t uValueLen, const char* pcToken)
+{
+    size_t                      uTokenLen               =   strlen(pcToken);
+    size_t                      i                       =   0;
+
+    while (i < uValueLen)
+    {
+        while (i < uValueLen && (IsHTTPSpace(pcValue[i]) || pcValue[i] == ','))
+            i++;
+        size_t                  uStart                  =   i;
+        while (i < uValueLen && pcValue[i] != ',')
+            i++;
+        size_t                  uEnd                    =   i;
+        while (uEnd > uStart && IsHTTPSpace(pcValue[uEnd - 1]))
+            uEnd--;
+        if (uEnd - uStart == uTokenLen && strncasecmp(pcValue + uStart, pcToken, uTokenLen) == 0)
+            return true;
+    }
+    return false;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// case-insensitive match of the last token of a comma separated header value, e.g. "gzip, chunked"
+static bool HTTPLastTokenIs(const char* pcValue, size_t uValueLen, const char* pcToken)
+{
+    size_t                      uTokenLen               =   strlen(pcToken);
+    size_t                      uEnd                    =   uValueLen;
+
+    while (uEnd > 0 && (IsHTTPSpace(pcValue[uEnd - 1]) || pcValue[uEnd - 1] == ','))
+        uEnd--;
+    size_t                      uStart                  =   uEnd;
+    while (uStart > 0 && pcValue[uStart - 1] != ',')
+        uStart--;
+    while (uStart < uEnd && IsHTTPSpace(pcValue[uStart]))
+        uStart++;
+
+    return uEnd - uStart == uTokenLen && strncasecmp(pcValue + uStart, pcToken, uTokenLen) == 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPMessageParser::ResetMessage(bool bNoBody)
+{
+    m_eState            = eStartLine;
+    m_bStarted          = false;
+    m_bNoBody           = bNoBody;
+    m_bKeepAlive        = false;
+    m_bHTTP11           = false;
+    ResetFraming();
+    m_u64Remaining      = 0;
+    m_u64BodyBytes      = 0;
+    m_uLineLen          = 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// accumulates up to and including '\n'; the line is left NUL terminated without its CRLF
+bool
+libthrocket::HTTPMessageParser::TakeLine(const uint8_t* & pu8Bytes, const uint8_t* pu8End)
+{
+    const uint8_t             * pu8NL                   =   (const uint8_t*) memchr(pu8Bytes, '\n', pu8End - pu8Bytes);
+    size_t                      uTake                   =   (pu8NL != NULL ? pu8NL : pu8End) - pu8Bytes;
+
+    if (m_uLineLen + uTake >= HTTP_PARSER_LINE_MAX)
+        throw libthrocket::HTTPParserOverflowException(LIBTHROCKET_THROWN_BY, "line longer than " +
+                                                    std::to_string(HTTP_PARSER_LINE_MAX));
+
+    memcpy(m_acLine + m_uLineLen, pu8Bytes, uTake);
+    m_uLineLen += uTake;
+    pu8Bytes += uTake;
+
+    if (pu8NL == NULL)
+        return false;
+
+    pu8Bytes++;
+    if (m_uLineLen > 0 && m_acLine[m_uLineLen - 1] == '\r')
+        m_uLineLen--;
+    m_acLine[m_uLineLen] = '\0';
+
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// HTTP/1.1 is persistent unless told otherwise, HTTP/1.0 the reverse
+bool
+libthrocket::HTTPMessageParser::ParseVersion(const char* pcVersion)
+{
+    if (strncmp(pcVersion, "HTTP/1.", 7) != 0 || pcVersion[7] < '0' || pcVersion[7] > '9')
+        return false;
+
+    m_bHTTP11       = pcVersion[7] != '0';
+    m_bKeepAlive    = m_bHTTP11;
+    m_bStarted      = true;
+
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// what the headers of the message now starting have said about its body
+void
+libthrocket::HTTPMessageParser::ResetFraming()
+{
+    m_eBody             = eBodyNone;
+    m_bHaveLength       = false;
+    m_bHaveTE           = false;
+    m_bTEChunked        = false;
+    m_u64ContentLength  = 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// RFC 7230 3.2.4 - whitespace before the colon and obs-fold continuation lines are refused outright; each lets two
+// parsers disagree about which headers a message carries
+void
+libthrocket::HTTPMessageParser::ParseHeaderLine(bool bTrailer)
+{
+    if (IsHTTPSpace(m_acLine[0]))
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("obs-fold \"") + m_acLine + "\"");
+
+    char                      * pcColon                 =   (char*) memchr(m_acLine, ':', m_uLineLen);
+    if (pcColon == NULL || pcColon == m_acLine)
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("header \"") + m_acLine + "\"");
+    if (IsHTTPSpace(pcColon[-1]))
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("space before colon \"") + m_acLine + "\"");
+
+    const char                * pcName                  =   m_acLine;
+    size_t                      uNameLen                =   pcColon - m_acLine;
+    const char                * pcValue                 =   pcColon + 1;
+    const char                * pcValueEnd              =   m_acLine + m_uLineLen;
+
+    while (pcValue < pcValueEnd && IsHTTPSpace(*pcValue))
+        pcValue++;
+    while (pcValueEnd > pcValue && IsHTTPSpace(pcValueEnd[-1]))
+        pcValueEnd--;
+    size_t                      uValueLen               =   pcValueEnd - pcValue;
+
+    if (bTrailer == false)
+    {
+        if (uNameLen == 14 && strncasecmp(pcName, "Content-Length", 14) == 0)
+        {
+            uint64_t            u64Length               =   0;
+            if (uValueLen < 1 || uValueLen > 18)
+                throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("Content-Length \"") + m_acLine + "\"");
+            for (size_t i = 0; i < uValueLen; i++)
+            {
+                if (pcValue[i] < '0' || pcValue[i] > '9')
+                    throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("Content-Length \"") + m_acLine + "\"");
+                u64Length = u64Length * 10 + (pcValue[i] - '0');
+            }
+            // conflicting lengths are a request smuggling vector - refuse them
+            if (m_bHaveLength && u64Length != m_u64ContentLength)
+                throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, "conflicting Content-Length");
+            m_u64ContentLength = u64Length;
+            m_bHaveLength      = true;
+
+        } else if (uNameLen == 17 && strncasecmp(pcName, "Transfer-Encoding", 17) == 0)
+        {
+            // only the final coding frames the body, and a later header adds codings after an earlier one's
+            m_bHaveTE    = true;
+            m_bTEChunked = HTTPLastTokenIs(pcValue, uValueLen, "chunked");
+
+        } else if (uNameLen == 10 && strncasecmp(pcName, "Connection", 10) == 0)
+        {
+            if (HTTPHasToken(pcValue, uValueLen, "close"))
+                m_bKeepAlive = false;
+            else if (HTTPHasToken(pcValue, uValueLen, "keep-alive"))
+                m_bKeepAlive = true;
+        }
+    }
+
+    EmitHeader(pcName, uNameLen, pcValue, uValueLen);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// hex size, optionally followed by ;extensions
+void
+libthrocket::HTTPMessageParser::ParseChunkSize()
+{
+    uint64_t                    u64Size                 =   0;
+    size_t                      i                       =   0;
+
+    for (; i < m_uLineLen; i++)
+    {
+        char                    c                       =   m_acLine[i];
+        int                     nDigit;
+        if (c >= '0' && c <= '9')
+            nDigit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            nDigit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            nDigit = c - 'A' + 10;
+        else
+            break;
+        if (i >= 15)
+            throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("chunk size \"") + m_acLine + "\"");
+        u64Size = (u64Size << 4) | nDigit;
+    }
+
+    if (i == 0 || (i < m_uLineLen && m_acLine[i] != ';' && IsHTTPSpace(m_acLine[i]) == false))
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("chunk size \"") + m_acLine + "\"");
+
+    m_u64Remaining = u64Size;
+    m_eState = u64Size > 0 ? eChunkData : eTrailerLine;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// RFC 7230 3.3.3 - Transfer-Encoding beats Content-Length, and a message carrying both closes the connection after it;
+// a request whose final coding is not chunked cannot be framed at all
+void
+libthrocket::HTTPMessageParser::ResolveFraming(bool bUntilClose)
+{
+    if (m_bHaveTE)
+    {
+        if (m_bTEChunked)
+            m_eBody = eBodyChunked;
+        else if (bUntilClose == false)
+            throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, "Transfer-Encoding does not end in chunked");
+        if (m_bHaveLength)
+            m_bKeepAlive = false;
+
+    } else if (m_bHaveLength)
+    {
+        m_eBody = eBodyLength;
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPMessageParser::FrameBody(bool bUntilClose)
+{
+    if (m_bNoBody)
+    {
+        m_eBody = eBodyNone;
+        Complete();
+
+    } else if (m_eBody == eBodyChunked)
+    {
+        m_eState = eChunkSize;
+
+    } else if (m_eBody == eBodyLength)
+    {
+        m_u64Remaining = m_u64ContentLength;
+        if (m_u64Remaining > 0)
+            m_eState = eBodyFixed;
+        else
+            Complete();
+
+    } else if (bUntilClose)
+    {
+        m_eBody = eBodyUntilClose;
+        m_eState = eBodyClose;
+
+    } else
+    {
+        Complete();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPMessageParser::Complete()
+{
+    m_eState = eDone;
+    EmitComplete();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::HTTPMessageParser::Parse(const uint8_t* pu8Bytes, size_t uBytes)
+{
+    const uint8_t             * pu8                     =   pu8Bytes;
+    const uint8_t             * pu8End                  =   pu8Bytes + uBytes;
+
+    while (pu8 < pu8End && m_eState != eDone)
+    {
+        switch (m_eState)
+        {
+            case eStartLine:
+                if (TakeLine(pu8, pu8End) == false)
+                    break;
+                // tolerate the stray CRLF some peers leave after a body
+                if (m_uLineLen > 0)
+                {
+                    ParseStartLine();
+                    m_eState = eHeaderLine;
+                }
+                m_uLineLen = 0;
+                break;
+
+            case eHeaderLine:
+            case eTrailerLine:
+                if (TakeLine(pu8, pu8End) == false)
+                    break;
+                if (m_uLineLen > 0)
+                    ParseHeaderLine(m_eState == eTrailerLine);
+                else if (m_eState == eHeaderLine)
+                    HeadersComplete();
+                else
+                    Complete();
+                m_uLineLen = 0;
+                break;
+
+            case eChunkSize:
+                if (TakeLine(pu8, pu8End) == false)
+                    break;
+                ParseChunkSize();
+                m_uLineLen = 0;
+                break;
+
+            case eChunkEnd:
+                if (TakeLine(pu8, pu8End) == false)
+                    break;
+                if (m_uLineLen > 0)
+                    throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, "no CRLF after chunk");
+                m_uLineLen = 0;
+                m_eState = eChunkSize;
+                break;
+
+            case eBodyFixed:
+            case eChunkData:
+            {
+                size_t          uTake                   =   pu8End - pu8;
+                if (uTake > m_u64Remaining)
+                    uTake = (size_t) m_u64Remaining;
+                EmitBody(pu8, uTake);
+                pu8             +=  uTake;
+                m_u64Remaining  -=  uTake;
+                m_u64BodyBytes  +=  uTake;
+                if (m_u64Remaining == 0)
+                {
+                    if (m_eState == eChunkData)
+                        m_eState = eChunkEnd;
+                    else
+                        Complete();
+                }
+                break;
+            }
+
+            case eBodyClose:
+                EmitBody(pu8, pu8End - pu8);
+                m_u64BodyBytes += pu8End - pu8;
+                pu8 = pu8End;
+                break;
+
+            case eDone:
+                break;
+        }
+    }
+
+    return pu8 - pu8Bytes;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPMessageParser::ParseEOF()
+{
+    if (m_eState == eDone)
+        return;
+
+    if (m_eState == eBodyClose)
+    {
+        Complete();
+        return;
+    }
+
+    throw libthrocket::HTTPParserTruncatedException(LIBTHROCKET_THROWN_BY, "connection closed mid-message, state " +
+                                                 std::to_string(m_eState) + " body " + std::to_string(m_u64BodyBytes));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPResponseParser::Reset(HTTPResponseHandler * pHandler, bool bNoBody)
+{
+    ResetMessage(bNoBody);
+    m_pHandler  = pHandler != NULL ? pHandler : &s_handlerResponseNone;
+    m_u32Status = 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// HTTP/1.x SSS reason - the reason (and the space before it) may be missing
+void
+libthrocket::HTTPResponseParser::ParseStartLine()
+{
+    if (m_uLineLen < 12 || ParseVersion(m_acLine) == false || m_acLine[8] != ' ' ||
+        m_acLine[9] < '1' || m_acLine[9] > '5' ||
+        m_acLine[10] < '0' || m_acLine[10] > '9' || m_acLine[11] < '0' || m_acLine[11] > '9' ||
+        // exactly three digits - "2000" and "200X" are not 200
+        (m_uLineLen > 12 && m_acLine[12] != ' '))
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("status line \"") + m_acLine + "\"");
+
+    ResetFraming();
+    m_u32Status     = (m_acLine[9] - '0') * 100 + (m_acLine[10] - '0') * 10 + (m_acLine[11] - '0');
+
+    const char                * pcReason                =   m_acLine + 12;
+    while (IsHTTPSpace(*pcReason))
+        pcReason++;
+
+    m_pHandler->OnStatus(m_u32Status, pcReason, m_acLine + m_uLineLen - pcReason);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPResponseParser::HeadersComplete()
+{
+    // 100 Continue and friends - the real response follows
+    if (m_u32Status >= 100 && m_u32Status < 200 && m_u32Status != 101)
+    {
+        m_eState = eStartLine;
+        return;
+    }
+
+    ResolveFraming(true);
+    m_pHandler->OnHeadersComplete();
+
+    if (m_u32Status == 101)
+    {
+        // the connection now speaks something else
+        m_bKeepAlive = false;
+        m_eBody = eBodyNone;
+        Complete();
+        return;
+    }
+
+    if (m_u32Status == 204 || m_u32Status == 304)
+        m_bNoBody = true;
+
+    FrameBody(true);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPRequestParser::Reset(HTTPRequestHandler * pHandler)
+{
+    ResetMessage(false);
+    m_pHandler  = pHandler != NULL ? pHandler : &s_handlerRequestNone;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// METHOD SP request-target SP HTTP/1.x
+void
+libthrocket::HTTPRequestParser::ParseStartLine()
+{
+    char                      * pcTarget                =   (char*) memchr(m_acLine, ' ', m_uLineLen);
+    char                      * pcVersion               =   (char*) memrchr(m_acLine, ' ', m_uLineLen);
+
+    if (pcTarget == NULL || pcTarget == m_acLine || pcVersion == pcTarget ||
+        pcVersion + 9 != m_acLine + m_uLineLen || ParseVersion(pcVersion + 1) == false)
+        throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("request line \"") + m_acLine + "\"");
+
+    for (const char* pc = m_acLine; pc < pcTarget; pc++)
+        if (*pc < 'A' || *pc > 'Z')
+            throw libthrocket::HTTPParserSyntaxException(LIBTHROCKET_THROWN_BY, string("request method \"") + m_acLine + "\"");
+
+    ResetFraming();
+
+    m_pHandler->OnRequestLine(m_acLine, pcTarget - m_acLine, pcTarget + 1, pcVersion - pcTarget - 1);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPRequestParser::HeadersComplete()
+{
+    ResolveFraming(false);
+    m_pHandler->OnHeadersComplete();
+
+    FrameBody(false);
+}
+
+//============================================================================================================================= 132
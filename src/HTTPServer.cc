@@ -0,0 +1,1012 @@
+//============================================================================================================================= 132
+//
+//  HTTPServer.cc
+//
+//      Small embedded HTTP/1.1 server on a Reactor and a worker pool.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <cerrno>
+#include <strings.h>
+#include <sys/socket.h>
+
+#include "AlarmDebugLog.h"
+#include "HTTPServer.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+static const char               g_acContinue[]          =   "HTTP/1.1 100 Continue\r\n\r\n";
+#define HTTP_CONTINUE_LEN       ((uint32_t) (sizeof(g_acContinue) - 1))
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+static const char * HTTPReasonPhrase(uint32_t u32Status)
+{
+    switch (u32Status)
+    {
+        case 100:   return "Continue";
+        case 200:   return "OK";
+        case 201:   return "Created";
+        case 202:   return "Accepted";
+        case 204:   return "No Content";
+        case 301:   return "Moved Permanently";
+        case 302:   return "Found";
+        case 304:   return "Not Modified";
+        case 400:   return "Bad Request";
+        case 401:   return "Unauthorized";
+        case 403:   return "Forbidden";
+        case 404:   return "Not Found";
+        case 405:   return "Method Not Allowed";
+        case 408:   return "Request Timeout";
+        case 413:   return "Payload Too Large";
+        case 500:   return "Internal Server Error";
+        case 501:   return "Not Implemented";
+        case 503:   return "Service Unavailable";
+    }
+    return "Unknown";
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const std::string *
+libthrocket::HTTPServerRequest::GetHeader(const char* pcName) const
+{
+    for (size_t i = 0; i < vecHeaders.size(); i++)
+        if (strcasecmp(vecHeaders[i].first.c_str(), pcName) == 0)
+            return &vecHeaders[i].second;
+    return NULL;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServerRequest::clear()
+{
+    strMethod.clear();
+    strTarget.clear();
+    strPath.clear();
+    strQuery.clear();
+    vecHeaders.clear();
+    strBody.clear();
+    bKeepAlive = false;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// owned by the reactor thread while bBusy is false, by one worker while it is true
+struct libthrocket::HTTPServer::Connection : public HTTPRequestHandler
+{
+                                Connection(TCPSocket * pSocketIn, uint32_t u32MaxBodyIn)    :
+                                    pSocket(pSocketIn),
+                                    u32MaxBody(u32MaxBodyIn),
+                                    bBusy(false),
+                                    bExpectContinue(false),
+                                    bHeadersComplete(false),
+                                    uOutOff(0),
+                                    bCloseAfterOut(false),
+                                    i64LastActive(TimeuS64()),
+                                    i64RequestStart(0),
+                                    u32BufOff(0),
+                                    u32BufLen(0)
+                                {
+                                    req.clear();
+                                    req.strPeer = pSocket->GetPeerAddrString();
+                                    parser.Reset(this);
+                                }
+    virtual                     ~Connection()
+                                { delete pSocket; }
+
+                                // ready for the next request on the connection
+    void                        Reset()
+                                {
+                                    req.clear();
+                                    bExpectContinue  = false;
+                                    bHeadersComplete = false;
+                                    i64RequestStart  = 0;
+                                    parser.Reset(this);
+                                }
+
+    virtual void                OnRequestLine(const char* pcMethod, size_t uMethodLen, const char* pcTarget, size_t uTargetLen)
+                                {
+                                    req.strMethod.assign(pcMethod, uMethodLen);
+                                    req.strTarget.assign(pcTarget, uTargetLen);
+                                    size_t uQuery = req.strTarget.find('?');
+                                    req.strPath = req.strTarget.substr(0, uQuery);
+                                    if (uQuery != string::npos)
+                                        req.strQuery = req.strTarget.substr(uQuery + 1);
+                                }
+    virtual void                OnHeader(const char* pcName, size_t uNameLen, const char* pcValue, size_t uValueLen)
+                                {
+                                    req.vecHeaders.push_back(std::make_pair(string(pcName, uNameLen), string(pcValue, uValueLen)));
+                                    if (uNameLen == 6 && strncasecmp(pcName, "Expect", 6) == 0 &&
+                                        uValueLen == 12 && strncasecmp(pcValue, "100-continue", 12) == 0)
+                                        bExpectContinue = true;
+                                }
+                                // a declared body over the limit is refused before any of it is read - and before a 100
+                                // Continue invites the client to send it
+    virtual void                OnHeadersComplete()
+                                {
+                                    if (parser.GetContentLength() > u32MaxBody)
+                                        throw libthrocket::HTTPServerTooLargeException(LIBTHROCKET_THROWN_BY, "Content-Length " +
+                                                                        std::to_string(parser.GetContentLength()) + " over " +
+                                                                        std::to_string(u32MaxBody));
+                                    bHeadersComplete = true;
+                                }
+    virtual void                OnBody(const uint8_t* pu8Bytes, size_t uBytes)
+                                {
+                                    if (req.strBody.size() + uBytes > u32MaxBody)
+                                        throw libthrocket::HTTPServerTooLargeException(LIBTHROCKET_THROWN_BY, "body over " +
+                                                                        std::to_string(u32MaxBody));
+                                    req.strBody.append((const char*) pu8Bytes, uBytes);
+                                }
+
+    TCPSocket                 * pSocket;
+    HTTPRequestParser           parser;
+    HTTPServerRequest           req;
+    uint32_t                    u32MaxBody;
+    bool                        bBusy;
+    bool                        bExpectContinue;
+    bool                        bHeadersComplete;
+    string                      strOut;                 // written without waiting - a 100 Continue, or an error response
+    size_t                      uOutOff;                // of strOut, already written
+    bool                        bCloseAfterOut;         // strOut is the last thing the connection says
+    int64_t                     i64LastActive;
+    int64_t                     i64RequestStart;        // first byte of the request being received, 0 between requests
+    uint32_t                    u32BufOff;
+    uint32_t                    u32BufLen;              // received but not yet parsed - only ever a pipelined request
+    uint8_t                     au8Buf[HTTP_SERVER_RECV_BUF];
+};
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// runs the Reactor - accepts, reads and parses
+class HTTPServerReactorThread :   public Thread
+{
+    public:
+                                HTTPServerReactorThread(HTTPServer * pServer)   :
+                                    m_pServer(pServer)
+                                {}
+        virtual                 ~HTTPServerReactorThread()
+                                {}
+
+    protected:
+
+        virtual void            Run();
+
+    private:
+
+        HTTPServer            * m_pServer;
+
+                                // disallow default construction / copy constructors
+                                HTTPServerReactorThread();
+                                HTTPServerReactorThread(const HTTPServerReactorThread &);
+        void                    operator=(const HTTPServerReactorThread &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// runs route handlers and writes responses
+class HTTPServerWorkerThread :   public Thread
+{
+    public:
+                                HTTPServerWorkerThread(HTTPServer * pServer)    :
+                                    m_pServer(pServer)
+                                {}
+        virtual                 ~HTTPServerWorkerThread()
+                                {}
+
+    protected:
+
+        virtual void            Run();
+
+    private:
+
+        HTTPServer            * m_pServer;
+
+                                // disallow default construction / copy constructors
+                                HTTPServerWorkerThread();
+                                HTTPServerWorkerThread(const HTTPServerWorkerThread &);
+        void                    operator=(const HTTPServerWorkerThread &);
+};
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServerReactorThread::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    while (GetStopRequested() == false)
+    {
+        try
+        {
+            m_pServer->Service();
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServerWorkerThread::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    while (GetStopRequested() == false)
+    {
+        try
+        {
+            m_pServer->Work(HTTP_SERVER_POLL);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPServer::HTTPServer
+(
+    uint32_t                    u32Workers,
+    uint32_t                    u32MaxQueue,
+    int64_t                     i64SendTimeout,
+    int64_t                     i64IdleTimeout,
+    uint32_t                    u32MaxBody,
+    int64_t                     i64RequestTimeout
+)   :
+    m_u32Workers(u32Workers),
+    m_u32MaxQueue(u32MaxQueue),
+    m_i64SendTimeout(i64SendTimeout),
+    m_i64IdleTimeout(i64IdleTimeout),
+    m_u32MaxBody(u32MaxBody),
+    m_i64RequestTimeout(i64RequestTimeout),
+    m_i64LastSweep(0),
+    m_bAcceptStalled(false),
+    m_pListener(NULL)
+{
+    if (u32Workers < 1)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "u32Workers " + std::to_string(u32Workers));
+    if (u32MaxQueue < 1)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "u32MaxQueue " + std::to_string(u32MaxQueue));
+    if (i64SendTimeout < 1)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "i64SendTimeout " + std::to_string(i64SendTimeout));
+    if (i64IdleTimeout < 1)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "i64IdleTimeout " + std::to_string(i64IdleTimeout));
+    if (i64RequestTimeout < 1)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "i64RequestTimeout " + std::to_string(i64RequestTimeout));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPServer::~HTTPServer()
+{
+    Stop();
+
+    delete m_pListener;
+    m_pListener = NULL;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::Route(const string& strMethod, const string& strPath, HTTPRouteHandler * pHandler)
+{
+    if (pHandler == NULL)
+        throw libthrocket::HTTPServerParamException(LIBTHROCKET_THROWN_BY, "NULL handler");
+    if (GetNumChildren() > 0)
+        throw libthrocket::HTTPServerInitException(LIBTHROCKET_THROWN_BY, "already started");
+
+    RouteEntry                  route;
+    route.strMethod = strMethod;
+    route.strPath   = strPath;
+    route.bPrefix   = strPath.size() > 0 && strPath[strPath.size() - 1] == '*';
+    route.pHandler  = pHandler;
+    if (route.bPrefix)
+        route.strPath.resize(strPath.size() - 1);
+
+    m_vecRoutes.push_back(route);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// accepted connections inherit the timeouts - no receive timeout, the Reactor tells us when there is something to read
+void
+libthrocket::HTTPServer::Bind(const string& strIPAddr, uint16_t u16Port, int nListenLen)
+{
+    if (m_pListener != NULL)
+        throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "already bound");
+
+    TCPAcceptSocket           * pListener               =   new TCPAcceptSocket(0, m_i64SendTimeout);
+    try
+    {
+        pListener->Bind(strIPAddr, u16Port, nListenLen);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        delete pListener;
+        throw;
+    }
+    m_pListener = pListener;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "HTS> bind: %s", InetSocket::AddrString(strIPAddr, GetDecodedLocalPort()).c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::Start()
+{
+    if (m_pListener == NULL)
+        throw libthrocket::HTTPServerInitException(LIBTHROCKET_THROWN_BY, "not bound");
+    if (GetNumChildren() > 0)
+        throw libthrocket::HTTPServerInitException(LIBTHROCKET_THROWN_BY, "already started");
+
+    m_reactor.Register(m_pListener, this, true, false);
+    m_i64LastSweep = TimeuS64();
+
+    ChildBirth(new HTTPServerReactorThread(this))->go();
+    for (uint32_t i = 0; i < m_u32Workers; i++)
+        ChildBirth(new HTTPServerWorkerThread(this))->go();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the server threads notice within one poll interval; requests still queued are dropped with their connections
+void
+libthrocket::HTTPServer::Stop()
+{
+    Infanticide();
+
+    ThreadMessage             * pMsg;
+    while ((pMsg = m_qWork.getNonBlocking()) != NULL)
+    {
+        ThreadMessagePtr<Connection> * pJob             =   static_cast<ThreadMessagePtr<Connection> *>(pMsg);
+        Connection            * pConn                   =   pJob->GetPtr();
+        pJob->SetPtr(NULL);
+        delete pMsg;
+        CloseConnection(pConn);
+    }
+
+    std::vector<Connection *>   vecConns;
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        std::map<Socket *, Connection *>::iterator it;
+        for (it = m_mapConnections.begin(); it != m_mapConnections.end(); ++it)
+            vecConns.push_back(it->second);
+    }
+    for (size_t i = 0; i < vecConns.size(); i++)
+        CloseConnection(vecConns[i]);
+
+    if (m_pListener != NULL)
+    {
+        try
+        {
+            m_reactor.Unregister(m_pListener);
+        }
+        catch (const libthrocket::ReactorParamException & e)
+        {
+            // never started
+        }
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint16_t
+libthrocket::HTTPServer::GetDecodedLocalPort()
+{
+    if (m_pListener == NULL)
+        return 0;
+    return m_pListener->GetDecodedLocalPort();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::Service()
+{
+    m_reactor.Poll(HTTP_SERVER_POLL);
+
+    int64_t                     i64Now                  =   TimeuS64();
+    if (i64Now - m_i64LastSweep >= HTTP_SERVER_POLL)
+    {
+        m_i64LastSweep = i64Now;
+        SweepConnections();
+        // the sweep may just have freed the descriptors a stalled accept was short of
+        if (m_bAcceptStalled)
+            AcceptConnections();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::Work(int64_t i64Timeout)
+{
+    ThreadMessage             * pMsg                    =   m_qWork.getTimed((uint32_t) i64Timeout);
+    if (pMsg == NULL)
+        return;
+
+    ThreadMessagePtr<Connection> * pJob                 =   static_cast<ThreadMessagePtr<Connection> *>(pMsg);
+    Connection                * pConn                   =   pJob->GetPtr();
+    pJob->SetPtr(NULL);
+    delete pMsg;
+
+    ServeConnection(pConn);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::OnReadable(Socket * pSocket)
+{
+    if (pSocket == m_pListener)
+    {
+        AcceptConnections();
+        return;
+    }
+
+    Connection                * pConn                   =   NULL;
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        std::map<Socket *, Connection *>::iterator it   =   m_mapConnections.find(pSocket);
+        // a hangup while a worker has it - the worker finds out, or the re-armed read does
+        if (it == m_mapConnections.end() || it->second->bBusy)
+            return;
+        pConn = it->second;
+    }
+
+    ReadConnection(pConn);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// only ever armed while pending output is part written
+void
+libthrocket::HTTPServer::OnWritable(Socket * pSocket)
+{
+    Connection                * pConn                   =   NULL;
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        std::map<Socket *, Connection *>::iterator it   =   m_mapConnections.find(pSocket);
+        if (it == m_mapConnections.end() || it->second->bBusy)
+            return;
+        pConn = it->second;
+    }
+
+    if (WritePending(pConn) == false)
+        return;
+    if (pConn->bCloseAfterOut)
+    {
+        CloseConnection(pConn);
+        return;
+    }
+    try
+    {
+        m_reactor.Modify(pSocket, true, false);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        // left for the idle sweep
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// as much of strOut as the socket takes without waiting - true once it is all gone (or the connection is dead, which the
+// read side finds out about); the rest goes when the Reactor says the socket is writable
+bool
+libthrocket::HTTPServer::WritePending(Connection * pConn)
+{
+    while (pConn->uOutOff < pConn->strOut.size())
+    {
+        ssize_t                 nRC                     =   send(pConn->pSocket->GetFD(), pConn->strOut.data() + pConn->uOutOff,
+                                                                 pConn->strOut.size() - pConn->uOutOff, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (nRC > 0)
+        {
+            pConn->uOutOff += nRC;
+            continue;
+        }
+        if (nRC < 0 && errno == EINTR)
+            continue;
+        if (nRC < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return false;
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTS> pend: %d (%s) send %d", pConn->pSocket->GetFD(), pConn->req.strPeer.c_str(), errno);
+        break;
+    }
+
+    pConn->strOut.clear();
+    pConn->uOutOff = 0;
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// worker, before a response - all that is ever pending here is a 100 Continue; not yet started it is simply dropped (it is
+// optional), one part written is finished
+void
+libthrocket::HTTPServer::FinishPending(Connection * pConn)
+{
+    if (pConn->uOutOff > 0 && pConn->uOutOff < pConn->strOut.size())
+        pConn->pSocket->Send((const uint8_t*) pConn->strOut.data() + pConn->uOutOff, pConn->strOut.size() - pConn->uOutOff);
+    pConn->strOut.clear();
+    pConn->uOutOff = 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::AcceptConnections()
+{
+    while (1)
+    {
+        TCPSocket             * pSocket;
+        try
+        {
+            pSocket = m_pListener->AcceptNonBlocking();
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            // e.g. EMFILE - the backlog is still there but edge-triggered epoll will not say so again, so Service() retries
+            // every sweep until it drains; logged once per stall
+            if (m_bAcceptStalled == false)
+                e.LogError(LIBTHROCKET_CAUGHT_BY);
+            m_bAcceptStalled = true;
+            return;
+        }
+        if (pSocket == NULL)
+        {
+            m_bAcceptStalled = false;
+            return;
+        }
+
+        Connection            * pConn                   =   new Connection(pSocket, m_u32MaxBody);
+        {
+            libthrocket::Lock   l(&m_CSLocal);
+            m_mapConnections[pSocket] = pConn;
+        }
+
+        try
+        {
+            m_reactor.Register(pSocket, this, true, false);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+            {
+                libthrocket::Lock l(&m_CSLocal);
+                m_mapConnections.erase(pSocket);
+            }
+            delete pConn;
+            continue;
+        }
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTS> conn: %d (%s)", pSocket->GetFD(), pConn->req.strPeer.c_str());
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// edge-triggered - read until the socket is drained or a request is complete; the parser always consumes everything
+// short of a complete request, so the buffer is free whenever the reactor thread owns the connection.  Every drain ends in
+// EAGAIN, so that is a return code here, as in WritePending(), not a SocketWouldBlockException
+void
+libthrocket::HTTPServer::ReadConnection(Connection * pConn)
+{
+    while (1)
+    {
+        ssize_t                 nRC                     =   recv(pConn->pSocket->GetFD(), pConn->au8Buf, sizeof(pConn->au8Buf),
+                                                                 MSG_DONTWAIT);
+        if (nRC < 0 && errno == EINTR)
+            continue;
+        if (nRC < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+        if (nRC <= 0)
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "HTS> read: %d (%s) recv %d", pConn->pSocket->GetFD(), pConn->req.strPeer.c_str(), nRC < 0 ? errno : 0);
+            CloseConnection(pConn);
+            return;
+        }
+
+        pConn->u32BufOff     = 0;
+        pConn->u32BufLen     = (uint32_t) nRC;
+        pConn->i64LastActive = TimeuS64();
+
+        bool                    bComplete;
+        try
+        {
+            bComplete = ParseConnection(pConn);
+        }
+        catch (const libthrocket::HTTPServerTooLargeException & e)
+        {
+            SendError(pConn, 413);
+            return;
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            SendError(pConn, 400);
+            return;
+        }
+
+        if (bComplete)
+        {
+            DispatchConnection(pConn);
+            return;
+        }
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::HTTPServer::ParseConnection(Connection * pConn)
+{
+    // the request deadline runs from here, not from the latest read
+    if (pConn->i64RequestStart == 0)
+        pConn->i64RequestStart = TimeuS64();
+
+    size_t                      uUsed                   =   pConn->parser.Parse(pConn->au8Buf + pConn->u32BufOff, pConn->u32BufLen);
+
+    pConn->u32BufOff += uUsed;
+    pConn->u32BufLen -= uUsed;
+    if (pConn->u32BufLen == 0)
+        pConn->u32BufOff = 0;
+
+    if (pConn->parser.IsComplete() == false)
+    {
+        // the client is holding the body back until we say so - never blocking the thread on it
+        if (pConn->bExpectContinue && pConn->bHeadersComplete)
+        {
+            pConn->bExpectContinue = false;
+            pConn->strOut.assign(g_acContinue, HTTP_CONTINUE_LEN);
+
+            // a worker re-arms the connection itself when it hands it back
+            if (WritePending(pConn) == false && pConn->bBusy == false)
+            {
+                try
+                {
+                    m_reactor.Modify(pConn->pSocket, true, true);
+                }
+                catch (const libthrocket::Exception & e)
+                {
+                    // left for the idle sweep
+                    e.LogError(LIBTHROCKET_CAUGHT_BY);
+                }
+            }
+        }
+        return false;
+    }
+
+    pConn->req.bKeepAlive = pConn->parser.IsKeepAlive();
+
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// stop watching the connection and hand it to a worker
+void
+libthrocket::HTTPServer::DispatchConnection(Connection * pConn)
+{
+    try
+    {
+        m_reactor.Modify(pConn->pSocket, false, false);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+        CloseConnection(pConn);
+        return;
+    }
+
+    // only this thread queues, so the check cannot race another producer
+    if (m_qWork.size() >= m_u32MaxQueue)
+    {
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTS> busy: %d (%s) %s %s", pConn->pSocket->GetFD(), pConn->req.strPeer.c_str(),
+            pConn->req.strMethod.c_str(), pConn->req.strTarget.c_str());
+        SendError(pConn, 503);
+        return;
+    }
+
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        pConn->bBusy = true;
+    }
+
+    m_qWork.put(new ThreadMessagePtr<Connection>(pConn));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// worker - answer the request, then any pipelined ones already buffered, then give the connection back to the Reactor
+void
+libthrocket::HTTPServer::ServeConnection(Connection * pConn)
+{
+    HTTPServerResponse          rsp;
+
+    while (1)
+    {
+        HTTPRouteHandler      * pRoute                  =   FindRoute(pConn->req);
+
+        rsp.clear();
+        if (pRoute == NULL)
+        {
+            rsp.u32Status = 404;
+
+        } else
+        {
+            try
+            {
+                pRoute->OnRequest(pConn->req, rsp);
+            }
+            catch (const libthrocket::Exception & e)
+            {
+                e.LogError(LIBTHROCKET_CAUGHT_BY);
+                rsp.clear();
+                rsp.u32Status = 500;
+            }
+        }
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTS> rqst: %d (%s) %s %s %u", pConn->pSocket->GetFD(), pConn->req.strPeer.c_str(),
+            pConn->req.strMethod.c_str(), pConn->req.strTarget.c_str(), rsp.u32Status);
+
+        bool                    bKeepAlive              =   pConn->req.bKeepAlive;
+        try
+        {
+            SendResponse(pConn, rsp, bKeepAlive);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            CloseConnection(pConn);
+            return;
+        }
+
+        if (bKeepAlive == false)
+        {
+            CloseConnection(pConn);
+            return;
+        }
+
+        pConn->Reset();
+
+        bool                    bComplete               =   false;
+        if (pConn->u32BufLen > 0)
+        {
+            try
+            {
+                bComplete = ParseConnection(pConn);
+            }
+            catch (const libthrocket::HTTPServerTooLargeException & e)
+            {
+                SendError(pConn, 413);
+                return;
+            }
+            catch (const libthrocket::Exception & e)
+            {
+                SendError(pConn, 400);
+                return;
+            }
+        }
+        if (bComplete == false)
+            break;
+    }
+
+    // not busy and re-armed in one critical section: an edge that fires in between waits in OnReadable() for the lock rather
+    // than being ignored, and a hangup cannot close (and free) pConn while we still use it - which we must not once unlocked
+    libthrocket::Lock           l(&m_CSLocal);
+    pConn->bBusy         = false;
+    pConn->i64LastActive = TimeuS64();
+    try
+    {
+        m_reactor.Modify(pConn->pSocket, true, pConn->strOut.size() > 0);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        // left for the idle sweep
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// reactor thread - connections idle past the idle timeout, or still receiving a request past the request timeout
+void
+libthrocket::HTTPServer::SweepConnections()
+{
+    std::vector<Connection *>   vecIdle;
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Cutoff               =   i64Now - m_i64IdleTimeout;
+    int64_t                     i64RequestCutoff        =   i64Now - m_i64RequestTimeout;
+
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        std::map<Socket *, Connection *>::iterator it;
+        for (it = m_mapConnections.begin(); it != m_mapConnections.end(); ++it)
+        {
+            Connection        * pConn                   =   it->second;
+            if (pConn->bBusy)
+                continue;
+            // a byte per idle interval keeps i64LastActive fresh forever - the request deadline does not move
+            if (pConn->i64LastActive < i64Cutoff || (pConn->i64RequestStart != 0 && pConn->i64RequestStart < i64RequestCutoff))
+                vecIdle.push_back(pConn);
+        }
+    }
+
+    for (size_t i = 0; i < vecIdle.size(); i++)
+    {
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTS> idle: %d (%s)", vecIdle[i]->pSocket->GetFD(), vecIdle[i]->req.strPeer.c_str());
+        CloseConnection(vecIdle[i]);
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPServer::CloseConnection(Connection * pConn)
+{
+    try
+    {
+        m_reactor.Unregister(pConn->pSocket);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        m_mapConnections.erase(pConn->pSocket);
+    }
+
+    delete pConn;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::HTTPRouteHandler *
+libthrocket::HTTPServer::FindRoute(const HTTPServerRequest & req)
+{
+    for (size_t i = 0; i < m_vecRoutes.size(); i++)
+    {
+        const RouteEntry      & route                   =   m_vecRoutes[i];
+        if (route.strMethod.size() > 0 && route.strMethod != req.strMethod)
+            continue;
+        if (route.bPrefix ? req.strPath.compare(0, route.strPath.size(), route.strPath) == 0 : req.strPath == route.strPath)
+            return route.pHandler;
+    }
+    return NULL;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// status line and headers; bBody comes back false when nothing may follow them
+static const string HTTPResponseHead(const libthrocket::HTTPServerResponse & rsp, const string & strMethod, bool bKeepAlive,
+                                     bool & bBody)
+{
+    string                      strHead;
+
+    bBody = rsp.u32Status != 204 && rsp.u32Status != 304;
+
+    strHead.reserve(256);
+    strHead += "HTTP/1.1 " + std::to_string(rsp.u32Status) + " " + HTTPReasonPhrase(rsp.u32Status) + "\r\n";
+    for (size_t i = 0; i < rsp.vecHeaders.size(); i++)
+        strHead += rsp.vecHeaders[i].first + ": " + rsp.vecHeaders[i].second + "\r\n";
+    if (bBody)
+        strHead += "Content-Length: " + std::to_string(rsp.strBody.size()) + "\r\n";
+    strHead += bKeepAlive ? "Connection: keep-alive\r\n\r\n" : "Connection: close\r\n\r\n";
+
+    // HEAD gets the headers GET would have
+    if (strMethod == "HEAD")
+        bBody = false;
+
+    return strHead;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// worker
+void
+libthrocket::HTTPServer::SendResponse(Connection * pConn, const HTTPServerResponse & rsp, bool bKeepAlive)
+{
+    bool                        bBody;
+    string                      strHead                 =   HTTPResponseHead(rsp, pConn->req.strMethod, bKeepAlive, bBody);
+
+    FinishPending(pConn);
+
+    struct iovec                aiov[2];
+    int                         nIOV                    =   1;
+    aiov[0].iov_base = (void*) strHead.data();
+    aiov[0].iov_len  = strHead.size();
+    if (bBody && rsp.strBody.size() > 0)
+    {
+        aiov[1].iov_base = (void*) rsp.strBody.data();
+        aiov[1].iov_len  = rsp.strBody.size();
+        nIOV++;
+    }
+
+    pConn->pSocket->SendV(aiov, nIOV);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// never waits on the peer - the 400/413/503 paths run on the reactor thread, and the 503 exactly when the server is
+// overloaded; what the socket does not take goes out from OnWritable(), which then closes the connection
+void
+libthrocket::HTTPServer::SendError(Connection * pConn, uint32_t u32Status)
+{
+    HTTPServerResponse          rsp;
+    bool                        bBody;
+
+    rsp.clear();
+    rsp.u32Status = u32Status;
+    rsp.strBody   = string(HTTPReasonPhrase(u32Status)) + "\n";
+    rsp.AddHeader("Content-Type", "text/plain");
+
+    // after whatever of a 100 Continue is still to go
+    pConn->strOut.append(HTTPResponseHead(rsp, pConn->req.strMethod, false, bBody));
+    if (bBody)
+        pConn->strOut.append(rsp.strBody);
+    pConn->bCloseAfterOut = true;
+
+    if (WritePending(pConn))
+    {
+        CloseConnection(pConn);
+        return;
+    }
+
+    // a worker gives the connection back to the Reactor for the rest; nothing more is read from it.  Re-armed under the lock
+    // that clears bBusy, as in ServeConnection() - the Reactor may close pConn as soon as it is released
+    libthrocket::Lock           l(&m_CSLocal);
+    pConn->bBusy         = false;
+    pConn->i64LastActive = TimeuS64();
+    try
+    {
+        m_reactor.Modify(pConn->pSocket, false, true);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        // left for the idle sweep
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+}
+
+//============================================================================================================================= 132
@@ -0,0 +1,742 @@
+//============================================================================================================================= 132
+//
+//  IOUring.cc
+//
+//      io_uring I/O engine on the raw syscalls.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+#include "AlarmDebugLog.h"
+#include "IOUring.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// 5.19 - older uapi headers do not have it
+#ifndef IORING_RECVSEND_POLL_FIRST
+#define IORING_RECVSEND_POLL_FIRST  (1U << 0)
+#endif
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+static inline int IOUringSetup(uint32_t u32Entries, struct io_uring_params* pParams)
+{
+    return (int) syscall(__NR_io_uring_setup, u32Entries, pParams);
+}
+
+static inline int IOUringEnter(int nRing, uint32_t u32Submit, uint32_t u32MinComplete, uint32_t u32Flags)
+{
+    return (int) syscall(__NR_io_uring_enter, nRing, u32Submit, u32MinComplete, u32Flags, NULL, 0);
+}
+
+static inline int IOUringRegister(int nRing, uint32_t u32Opcode, void* pvArg, uint32_t u32Args)
+{
+    return (int) syscall(__NR_io_uring_register, nRing, u32Opcode, pvArg, u32Args);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::IOUringEngine::IOUringEngine(uint32_t u32Entries, uint32_t u32Files)    :
+    m_nRing(-1),
+    m_bReaping(false),
+    m_bPollFirst(false),
+    m_pvSQRing(MAP_FAILED),
+    m_uSQRingSize(0),
+    m_pvCQRing(MAP_FAILED),
+    m_uCQRingSize(0),
+    m_psqes((struct io_uring_sqe*) MAP_FAILED),
+    m_uSQEsSize(0)
+{
+    if (u32Entries < 2)
+        throw libthrocket::IOUringParamException(LIBTHROCKET_THROWN_BY, "u32Entries " + std::to_string(u32Entries));
+
+    memset(m_abSupported, 0, sizeof(m_abSupported));
+
+    struct io_uring_params      params;
+    memset(&params, 0, sizeof(params));
+
+    m_nRing = IOUringSetup(u32Entries, &params);
+    if (m_nRing < 0)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "io_uring_setup " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+
+    try
+    {
+        m_uSQRingSize = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        m_uCQRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+        {
+            if (m_uCQRingSize > m_uSQRingSize)
+                m_uSQRingSize = m_uCQRingSize;
+            m_uCQRingSize = m_uSQRingSize;
+        }
+
+        m_pvSQRing = mmap(NULL, m_uSQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nRing, IORING_OFF_SQ_RING);
+        if (m_pvSQRing == MAP_FAILED)
+        {
+            int                 nSaveErrno              =   errno;
+            throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "mmap SQ " + std::to_string(nSaveErrno) +
+                                                      " (" + strerror(nSaveErrno) + ")");
+        }
+
+        if ((params.features & IORING_FEAT_SINGLE_MMAP) != 0)
+        {
+            m_pvCQRing = m_pvSQRing;
+        } else
+        {
+            m_pvCQRing = mmap(NULL, m_uCQRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_nRing, IORING_OFF_CQ_RING);
+            if (m_pvCQRing == MAP_FAILED)
+            {
+                int             nSaveErrno              =   errno;
+                throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "mmap CQ " + std::to_string(nSaveErrno) +
+                                                          " (" + strerror(nSaveErrno) + ")");
+            }
+        }
+
+        m_uSQEsSize = params.sq_entries * sizeof(struct io_uring_sqe);
+        m_psqes = (struct io_uring_sqe*) mmap(NULL, m_uSQEsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                              m_nRing, IORING_OFF_SQES);
+        if (m_psqes == MAP_FAILED)
+        {
+            int                 nSaveErrno              =   errno;
+            throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "mmap SQEs " + std::to_string(nSaveErrno) +
+                                                      " (" + strerror(nSaveErrno) + ")");
+        }
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        if (m_psqes != MAP_FAILED)
+            munmap(m_psqes, m_uSQEsSize);
+        if (m_pvCQRing != MAP_FAILED && m_pvCQRing != m_pvSQRing)
+            munmap(m_pvCQRing, m_uCQRingSize);
+        if (m_pvSQRing != MAP_FAILED)
+            munmap(m_pvSQRing, m_uSQRingSize);
+        close(m_nRing);
+        throw;
+    }
+
+    uint8_t                   * pu8SQ                   =   (uint8_t*) m_pvSQRing;
+    uint8_t                   * pu8CQ                   =   (uint8_t*) m_pvCQRing;
+
+    m_pu32SQHead    = (uint32_t*) (pu8SQ + params.sq_off.head);
+    m_pu32SQTail    = (uint32_t*) (pu8SQ + params.sq_off.tail);
+    m_u32SQMask     = *(uint32_t*) (pu8SQ + params.sq_off.ring_mask);
+    m_u32SQEntries  = *(uint32_t*) (pu8SQ + params.sq_off.ring_entries);
+    m_pu32SQArray   = (uint32_t*) (pu8SQ + params.sq_off.array);
+    m_pu32CQHead    = (uint32_t*) (pu8CQ + params.cq_off.head);
+    m_pu32CQTail    = (uint32_t*) (pu8CQ + params.cq_off.tail);
+    m_u32CQMask     = *(uint32_t*) (pu8CQ + params.cq_off.ring_mask);
+    m_pcqes         = (struct io_uring_cqe*) (pu8CQ + params.cq_off.cqes);
+
+    // which opcodes this kernel has - anything missing sends the Socket down its poll() path
+    std::vector<uint8_t>        vecProbe(sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op), 0);
+    struct io_uring_probe     * pProbe                  =   (struct io_uring_probe*) &vecProbe[0];
+    if (IOUringRegister(m_nRing, IORING_REGISTER_PROBE, pProbe, IORING_OP_LAST) == 0)
+    {
+        for (uint32_t i = 0; i < pProbe->ops_len && i < IORING_OP_LAST; i++)
+            m_abSupported[pProbe->ops[i].op] = (pProbe->ops[i].flags & IO_URING_OP_SUPPORTED) != 0;
+    }
+    // IORING_RECVSEND_POLL_FIRST came with IORING_OP_SOCKET; before that an unknown ioprio bit is EINVAL
+    m_bPollFirst = Supports(IORING_OP_SOCKET);
+
+    // sparse fixed-file table; without one every socket just uses its fd
+    if (u32Files > 0)
+    {
+        std::vector<int>        vecFiles(u32Files, -1);
+        if (IOUringRegister(m_nRing, IORING_REGISTER_FILES, &vecFiles[0], u32Files) == 0)
+        {
+            m_vecFreeFiles.reserve(u32Files);
+            for (uint32_t i = u32Files; i > 0; i--)
+                m_vecFreeFiles.push_back(i - 1);
+        } else
+        {
+            int                 nSaveErrno              =   errno;
+            LOGWARNING("URG> no fixed files %d (%s)", nSaveErrno, strerror(nSaveErrno));
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "URG> init: %d %u SQ %u CQ entries %zu files",
+        m_nRing, params.sq_entries, params.cq_entries, m_vecFreeFiles.size());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// every Socket using this engine must be closed (or detached) first
+libthrocket::IOUringEngine::~IOUringEngine()
+{
+    // free what was abandoned and has since completed
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        LockedReap();
+    }
+    munmap(m_psqes, m_uSQEsSize);
+    if (m_pvCQRing != m_pvSQRing)
+        munmap(m_pvCQRing, m_uCQRingSize);
+    munmap(m_pvSQRing, m_uSQRingSize);
+    close(m_nRing);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// static: seccomp/container policies often return ENOSYS or EPERM
+bool
+libthrocket::IOUringEngine::Available()
+{
+    struct io_uring_params      params;
+    memset(&params, 0, sizeof(params));
+
+    int                         nRing                   =   IOUringSetup(2, &params);
+    if (nRing < 0)
+        return false;
+    close(nRing);
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::LockedRegister(uint32_t u32Opcode, void* pvArg, uint32_t u32Args, const char* pcWhat)
+{
+    if (IOUringRegister(m_nRing, u32Opcode, pvArg, u32Args) < 0)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, string("io_uring_register ") + pcWhat + " " +
+                                                  std::to_string(nSaveErrno) + " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int
+libthrocket::IOUringEngine::RegisterFile(int nFD)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    if (m_vecFreeFiles.size() < 1)
+        return -1;
+
+    int                         nSlot                   =   m_vecFreeFiles.back();
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset   = nSlot;
+    update.fds      = (uint64_t) (uintptr_t) &nFD;
+
+    LockedRegister(IORING_REGISTER_FILES_UPDATE, &update, 1, "files update");
+    m_vecFreeFiles.pop_back();
+
+    return nSlot;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the ring holds a reference to a registered file - unregister before close() or the socket stays open
+void
+libthrocket::IOUringEngine::UnregisterFile(int nFixedSlot)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    if (nFixedSlot < 0)
+        throw libthrocket::IOUringParamException(LIBTHROCKET_THROWN_BY, "nFixedSlot " + std::to_string(nFixedSlot));
+
+    int                         nFD                     =   -1;
+    struct io_uring_files_update update;
+    memset(&update, 0, sizeof(update));
+    update.offset   = nFixedSlot;
+    update.fds      = (uint64_t) (uintptr_t) &nFD;
+
+    LockedRegister(IORING_REGISTER_FILES_UPDATE, &update, 1, "files update");
+    m_vecFreeFiles.push_back(nFixedSlot);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::RegisterBuffers(const struct iovec* piov, uint32_t u32Count)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    if (piov == NULL || u32Count < 1)
+        throw libthrocket::IOUringParamException(LIBTHROCKET_THROWN_BY, "no buffers");
+
+    // EINVAL here just means there were none registered
+    IOUringRegister(m_nRing, IORING_UNREGISTER_BUFFERS, NULL, 0);
+    LockedRegister(IORING_REGISTER_BUFFERS, (void*) piov, u32Count, "buffers");
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::UnregisterBuffers()
+{
+    libthrocket::Lock           l(&m_CSLocal);
+    LockedRegister(IORING_UNREGISTER_BUFFERS, NULL, 0, "unregister buffers");
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::PrepSQE(struct io_uring_sqe & sqe, uint8_t u8Op, int nFD, int nFixedSlot)
+{
+    memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = u8Op;
+    if (nFixedSlot >= 0)
+    {
+        sqe.fd      = nFixedSlot;
+        sqe.flags   = IOSQE_FIXED_FILE;
+    } else
+    {
+        sqe.fd      = nFD;
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+struct io_uring_sqe *
+libthrocket::IOUringEngine::LockedGetSQE()
+{
+    uint32_t                    u32Tail                 =   *m_pu32SQTail;
+    uint32_t                    u32Head                 =   __atomic_load_n(m_pu32SQHead, __ATOMIC_ACQUIRE);
+
+    if (u32Tail - u32Head >= m_u32SQEntries)
+        return NULL;
+
+    uint32_t                    u32Index                =   u32Tail & m_u32SQMask;
+    m_pu32SQArray[u32Index] = u32Index;
+    __atomic_store_n(m_pu32SQTail, u32Tail + 1, __ATOMIC_RELEASE);
+
+    return &m_psqes[u32Index];
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::LockedEnter(uint32_t u32Submit, uint32_t u32MinComplete, uint32_t u32Flags)
+{
+    while (1)
+    {
+        int                     nRC                     =   IOUringEnter(m_nRing, u32Submit, u32MinComplete, u32Flags);
+        if (nRC >= 0)
+        {
+            if ((uint32_t) nRC >= u32Submit)
+                return;
+            // a short submit leaves the rest queued
+            u32Submit -= nRC;
+            continue;
+        }
+
+        int                     nSaveErrno              =   errno;
+        if (nSaveErrno == EINTR)
+            continue;
+        if (nSaveErrno == EBUSY || nSaveErrno == EAGAIN)
+        {
+            // completion queue backed up - make room and go again
+            LockedReap();
+            continue;
+        }
+        throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "io_uring_enter " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// hand each completion to the thread waiting on it; user_data 0 is a linked timeout's own completion
+void
+libthrocket::IOUringEngine::LockedReap()
+{
+    uint32_t                    u32Head                 =   *m_pu32CQHead;
+    uint32_t                    u32Tail                 =   __atomic_load_n(m_pu32CQTail, __ATOMIC_ACQUIRE);
+    bool                        bAny                    =   false;
+
+    while (u32Head != u32Tail)
+    {
+        struct io_uring_cqe   * pcqe                    =   &m_pcqes[u32Head & m_u32CQMask];
+        Completion            * pCompletion             =   (Completion*) (uintptr_t) pcqe->user_data;
+        if (pCompletion != NULL && pCompletion->bAbandoned)
+        {
+            delete pCompletion;
+        } else if (pCompletion != NULL)
+        {
+            pCompletion->i32Result  = pcqe->res;
+            pCompletion->bDone      = true;
+            bAny = true;
+        }
+        u32Head++;
+    }
+    __atomic_store_n(m_pu32CQHead, u32Head, __ATOMIC_RELEASE);
+
+    if (bAny)
+        m_condReaped.broadcast();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// one thread at a time sleeps in the kernel for completions; the rest sleep on m_condReaped
+// once the SQE is queued the kernel owns the completion - if we throw, it is cancelled and reaped before we unwind
+int32_t
+libthrocket::IOUringEngine::SubmitAndWait(const struct io_uring_sqe & sqe, int64_t i64Timeout)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    // every submitter drains the SQ before letting go of the lock, so there is always room for a pair
+    uint32_t                    u32Submit               =   i64Timeout > 0 ? 2 : 1;
+    struct io_uring_sqe       * psqe                    =   LockedGetSQE();
+    if (psqe == NULL)
+        throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "submission queue full");
+    Completion                * pCompletion             =   new Completion;
+    pCompletion->i32Result  = 0;
+    pCompletion->bDone      = false;
+    pCompletion->bAbandoned = false;
+    *psqe = sqe;
+    psqe->user_data = (uint64_t) (uintptr_t) pCompletion;
+
+    if (i64Timeout > 0)
+    {
+        psqe->flags |= IOSQE_IO_LINK;
+
+        pCompletion->ts.tv_sec  = i64Timeout / 1000000;
+        pCompletion->ts.tv_nsec = (i64Timeout % 1000000) * 1000;
+
+        struct io_uring_sqe   * psqeTimeout             =   LockedGetSQE();
+        memset(psqeTimeout, 0, sizeof(*psqeTimeout));
+        psqeTimeout->opcode     = IORING_OP_LINK_TIMEOUT;
+        psqeTimeout->fd         = -1;
+        psqeTimeout->addr       = (uint64_t) (uintptr_t) &pCompletion->ts;
+        psqeTimeout->len        = 1;
+        psqeTimeout->user_data  = 0;
+    }
+
+    try
+    {
+        LockedWaitCompletion(pCompletion, u32Submit);
+    }
+    catch (...)
+    {
+        // the kernel may still be writing into the caller's buffer - cancel the operation and see it complete first
+        try
+        {
+            LockedCancel(pCompletion);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+        }
+        // only if even that failed is it left to whoever reaps next
+        if (pCompletion->bDone)
+            delete pCompletion;
+        else
+            pCompletion->bAbandoned = true;
+        throw;
+    }
+
+    int32_t                     i32Result               =   pCompletion->i32Result;
+    delete pCompletion;
+
+    // the linked timeout cancels the operation when it fires
+    if (i32Result == -ECANCELED)
+        return -ETIMEDOUT;
+    return i32Result;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// IORING_OP_ASYNC_CANCEL keyed on the operation's user_data, then wait for the operation itself - it completes either way,
+// with -ECANCELED or with whatever it had already done; the cancel's own completion (user_data 0) is dropped by the reaper
+void
+libthrocket::IOUringEngine::LockedCancel(Completion * pCompletion)
+{
+    LockedReap();
+    if (pCompletion->bDone)
+        return;
+
+    struct io_uring_sqe       * psqe                    =   LockedGetSQE();
+    if (psqe == NULL)
+        throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "submission queue full, cannot cancel");
+    memset(psqe, 0, sizeof(*psqe));
+    psqe->opcode    = IORING_OP_ASYNC_CANCEL;
+    psqe->fd        = -1;
+    psqe->addr      = (uint64_t) (uintptr_t) pCompletion;
+    psqe->user_data = 0;
+
+    // whatever a failed io_uring_enter() left queued goes ahead of the cancel
+    LockedWaitCompletion(pCompletion, *m_pu32SQTail - __atomic_load_n(m_pu32SQHead, __ATOMIC_ACQUIRE));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// every operation on nFD, fixed file or not - returns how many were cancelled, -EINVAL before 5.19
+int32_t
+libthrocket::IOUringEngine::CancelFD(int nFD)
+{
+    if (Supports(IORING_OP_ASYNC_CANCEL) == false)
+        return -EINVAL;
+
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_ASYNC_CANCEL, nFD, -1);
+    sqe.cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+
+    return SubmitAndWait(sqe, 0);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::IOUringEngine::LockedWaitCompletion(Completion * pCompletion, uint32_t u32Submit)
+{
+    LockedEnter(u32Submit, 0, 0);
+
+    while (pCompletion->bDone == false)
+    {
+        LockedReap();
+        if (pCompletion->bDone)
+            break;
+
+        if (m_bReaping)
+        {
+            m_condReaped.block(&m_CSLocal);
+            continue;
+        }
+
+        m_bReaping = true;
+        m_CSLocal.unlock();
+        int                     nRC                     =   IOUringEnter(m_nRing, 0, 1, IORING_ENTER_GETEVENTS);
+        int                     nSaveErrno              =   errno;
+        m_CSLocal.lock();
+        m_bReaping = false;
+        // wake someone else to take over the kernel wait if ours is what completed
+        m_condReaped.broadcast();
+
+        if (nRC < 0 && nSaveErrno != EINTR && nSaveErrno != EAGAIN && nSaveErrno != EBUSY)
+            throw libthrocket::IOUringSysException(LIBTHROCKET_THROWN_BY, "io_uring_enter wait " + std::to_string(nSaveErrno) +
+                                                      " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// older kernels honor O_NONBLOCK, so sockets driven elsewhere (Reactor, accept pool) answer EAGAIN - wait on the ring instead;
+// receives ask for IORING_RECVSEND_POLL_FIRST where the kernel has it, so the ring waits for data and never says EAGAIN
+int32_t
+libthrocket::IOUringEngine::Execute(struct io_uring_sqe & sqe, short sEvents, int64_t i64Timeout)
+{
+    int64_t                     i64Expire               =   TimeuS64() + i64Timeout;
+
+    while (1)
+    {
+        int32_t                 i32Result               =   SubmitAndWait(sqe, i64Timeout);
+        if (i32Result != -EAGAIN || sEvents == 0)
+            return i32Result;
+
+        int64_t                 i64Remain               =   i64Expire - TimeuS64();
+        if (i64Timeout > 0 && i64Remain < 1)
+            return -ETIMEDOUT;
+
+        struct io_uring_sqe     sqePoll;
+        memset(&sqePoll, 0, sizeof(sqePoll));
+        sqePoll.opcode          = IORING_OP_POLL_ADD;
+        sqePoll.fd              = sqe.fd;
+        sqePoll.flags           = sqe.flags & IOSQE_FIXED_FILE;
+        sqePoll.poll32_events   = (uint16_t) sEvents;
+
+        i32Result = SubmitAndWait(sqePoll, i64Timeout > 0 ? i64Remain : 0);
+        if (i32Result < 0)
+            return i32Result;
+
+        if (i64Timeout > 0)
+        {
+            i64Timeout = i64Expire - TimeuS64();
+            if (i64Timeout < 1)
+                return -ETIMEDOUT;
+        }
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::Accept(int nFD, int nFixedSlot, int nFlags, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_ACCEPT, nFD, nFixedSlot);
+    sqe.accept_flags = nFlags;
+
+    return Execute(sqe, POLLIN, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a non-blocking connect answers EINPROGRESS; the outcome is then in SO_ERROR once writable
+int32_t
+libthrocket::IOUringEngine::Connect(int nFD, int nFixedSlot, const struct sockaddr* psa, socklen_t slen, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_CONNECT, nFD, nFixedSlot);
+    sqe.addr    = (uint64_t) (uintptr_t) psa;
+    sqe.off     = slen;
+
+    int64_t                     i64Expire               =   TimeuS64() + i64Timeout;
+    int32_t                     i32Result               =   Execute(sqe, 0, i64Timeout);
+    if (i32Result != -EINPROGRESS)
+        return i32Result;
+
+    if (i64Timeout > 0)
+    {
+        i64Timeout = i64Expire - TimeuS64();
+        if (i64Timeout < 1)
+            return -ETIMEDOUT;
+    }
+
+    i32Result = Poll(nFD, nFixedSlot, POLLOUT, i64Timeout);
+    if (i32Result < 0)
+        return i32Result;
+
+    int                         nSockErr                =   0;
+    socklen_t                   nLen                    =   sizeof(nSockErr);
+    if (getsockopt(nFD, SOL_SOCKET, SO_ERROR, &nSockErr, &nLen) != 0)
+        return -errno;
+    return -nSockErr;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::Send(int nFD, int nFixedSlot, const void* pvBytes, uint32_t u32Bytes, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_SEND, nFD, nFixedSlot);
+    sqe.addr    = (uint64_t) (uintptr_t) pvBytes;
+    sqe.len     = u32Bytes;
+
+    return Execute(sqe, POLLOUT, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::Recv(int nFD, int nFixedSlot, void* pvBytes, uint32_t u32Bytes, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_RECV, nFD, nFixedSlot);
+    sqe.addr    = (uint64_t) (uintptr_t) pvBytes;
+    sqe.len     = u32Bytes;
+    if (m_bPollFirst)
+        sqe.ioprio = IORING_RECVSEND_POLL_FIRST;
+
+    return Execute(sqe, POLLIN, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::SendMsg(int nFD, int nFixedSlot, const struct msghdr* pmsg, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_SENDMSG, nFD, nFixedSlot);
+    sqe.addr    = (uint64_t) (uintptr_t) pmsg;
+    sqe.len     = 1;
+
+    return Execute(sqe, POLLOUT, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::RecvMsg(int nFD, int nFixedSlot, struct msghdr* pmsg, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_RECVMSG, nFD, nFixedSlot);
+    sqe.addr    = (uint64_t) (uintptr_t) pmsg;
+    sqe.len     = 1;
+    if (m_bPollFirst)
+        sqe.ioprio = IORING_RECVSEND_POLL_FIRST;
+
+    return Execute(sqe, POLLIN, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::WriteFixed
+(
+    int                         nFD,
+    int                         nFixedSlot,
+    const void                * pvBytes,
+    uint32_t                    u32Bytes,
+    uint16_t                    u16BufIndex,
+    int64_t                     i64Timeout
+)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_WRITE_FIXED, nFD, nFixedSlot);
+    sqe.addr        = (uint64_t) (uintptr_t) pvBytes;
+    sqe.len         = u32Bytes;
+    sqe.buf_index   = u16BufIndex;
+
+    return Execute(sqe, POLLOUT, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::ReadFixed
+(
+    int                         nFD,
+    int                         nFixedSlot,
+    void                      * pvBytes,
+    uint32_t                    u32Bytes,
+    uint16_t                    u16BufIndex,
+    int64_t                     i64Timeout
+)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_READ_FIXED, nFD, nFixedSlot);
+    sqe.addr        = (uint64_t) (uintptr_t) pvBytes;
+    sqe.len         = u32Bytes;
+    sqe.buf_index   = u16BufIndex;
+
+    return Execute(sqe, POLLIN, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int32_t
+libthrocket::IOUringEngine::Poll(int nFD, int nFixedSlot, short sEvents, int64_t i64Timeout)
+{
+    struct io_uring_sqe         sqe;
+    PrepSQE(sqe, IORING_OP_POLL_ADD, nFD, nFixedSlot);
+    sqe.poll32_events = (uint16_t) sEvents;
+
+    return SubmitAndWait(sqe, i64Timeout);
+}
+
+//============================================================================================================================= 132
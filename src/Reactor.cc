@@ -0,0 +1,364 @@
+//============================================================================================================================= 132
+//
+//  Reactor.cc
+//
+//      Edge-triggered epoll readiness dispatch for many Socket instances from one thread.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+#include "AlarmDebugLog.h"
+#include "Reactor.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the wake eventfd is registered under this (impossible) socket number
+#define REACTOR_WAKE_FD         (-1)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// epoll_event.data.u64 carries the fd and a registration generation so that stale events for a
+// since-recycled fd number are discarded rather than dispatched to the wrong handler
+static inline uint64_t
+ReactorEncode(int nFD, uint32_t u32Generation)
+{
+    return ((uint64_t) u32Generation << 32) | (uint32_t) nFD;
+}
+
+static inline int
+ReactorDecodeFD(uint64_t u64Data)
+{
+    return (int) (uint32_t) (u64Data & 0xFFFFFFFF);
+}
+
+static inline uint32_t
+ReactorDecodeGeneration(uint64_t u64Data)
+{
+    return (uint32_t) (u64Data >> 32);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::Reactor::Reactor(uint32_t u32MaxEvents)   :
+    m_nEpoll(-1),
+    m_nWakeFD(-1),
+    m_u32Generation(0),
+    m_bStopRequested(false),
+    m_nDispatchFD(-1),
+    m_u32DispatchGeneration(0),
+    m_tidDispatch(pthread_self()),
+    m_u32DispatchWaiters(0)
+{
+    if (u32MaxEvents < 1)
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "u32MaxEvents " + std::to_string(u32MaxEvents));
+
+    m_vecEvents.resize(u32MaxEvents);
+
+    m_nEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (m_nEpoll == -1)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "epoll_create1 " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+
+    m_nWakeFD = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_nWakeFD == -1)
+    {
+        int                     nSaveErrno              =   errno;
+        close(m_nEpoll);
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "eventfd " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+
+    struct epoll_event          ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events   = EPOLLIN;
+    ev.data.u64 = ReactorEncode(REACTOR_WAKE_FD, 0);
+    if (epoll_ctl(m_nEpoll, EPOLL_CTL_ADD, m_nWakeFD, &ev) != 0)
+    {
+        int                     nSaveErrno              =   errno;
+        close(m_nWakeFD);
+        close(m_nEpoll);
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "epoll_ctl wake " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::Reactor::~Reactor()
+{
+    if (m_nWakeFD != -1)
+        close(m_nWakeFD);
+    if (m_nEpoll != -1)
+        close(m_nEpoll);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::LockedControl(int nOp, int nFD, uint32_t u32Generation, bool bWantRead, bool bWantWrite)
+{
+    struct epoll_event          ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLET | EPOLLRDHUP;
+    if (bWantRead)
+        ev.events |= EPOLLIN;
+    if (bWantWrite)
+        ev.events |= EPOLLOUT;
+    ev.data.u64 = ReactorEncode(nFD, u32Generation);
+
+    if (epoll_ctl(m_nEpoll, nOp, nFD, &ev) != 0)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "epoll_ctl " + std::to_string(nOp) + " FD " +
+                                                  std::to_string(nFD) + " " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::LockedRegister(Socket * pSocket, ReactorHandler * pHandler, bool bWantRead, bool bWantWrite)
+{
+    if (pSocket == NULL || pHandler == NULL)
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "NULL socket or handler");
+
+    int                         nFD                     =   pSocket->GetFD();
+    if (nFD == INVALID_SOCKET)
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "socket is not open");
+    if (m_mapRegistrations.find(nFD) != m_mapRegistrations.end())
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "FD " + std::to_string(nFD) + " already registered");
+
+    // edge-triggered readiness requires that transfers never block
+    pSocket->SetNonBlocking();
+
+    Registration                reg;
+    reg.pSocket       = pSocket;
+    reg.pHandler      = pHandler;
+    reg.u32Generation = ++m_u32Generation;
+
+    LockedControl(EPOLL_CTL_ADD, nFD, reg.u32Generation, bWantRead, bWantWrite);
+    m_mapRegistrations[nFD] = reg;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "RCT> regi: %d%s%s",
+        nFD, bWantRead != false ? " read" : "", bWantWrite != false ? " write" : "");
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::LockedModify(Socket * pSocket, bool bWantRead, bool bWantWrite)
+{
+    int                         nFD                     =   pSocket->GetFD();
+    std::map<int, Registration>::iterator iter          =   m_mapRegistrations.find(nFD);
+    if (iter == m_mapRegistrations.end() || iter->second.pSocket != pSocket)
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "FD " + std::to_string(nFD) + " not registered");
+
+    LockedControl(EPOLL_CTL_MOD, nFD, iter->second.u32Generation, bWantRead, bWantWrite);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::LockedUnregister(Socket * pSocket)
+{
+    int                         nFD                     =   pSocket->GetFD();
+    std::map<int, Registration>::iterator iter          =   m_mapRegistrations.find(nFD);
+    if (iter == m_mapRegistrations.end() || iter->second.pSocket != pSocket)
+        throw libthrocket::ReactorParamException(LIBTHROCKET_THROWN_BY, "FD " + std::to_string(nFD) + " not registered");
+
+    uint32_t                    u32Generation           =   iter->second.u32Generation;
+    m_mapRegistrations.erase(iter);
+
+    // a closed fd has already left the epoll set
+    if (epoll_ctl(m_nEpoll, EPOLL_CTL_DEL, nFD, NULL) != 0 && errno != EBADF && errno != ENOENT)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "epoll_ctl del FD " + std::to_string(nFD) + " " +
+                                                  std::to_string(nSaveErrno) + " (" + strerror(nSaveErrno) + ")");
+    }
+
+    // no new callback can start now; one already running may still be using the handler - unless it is us
+    if (pthread_equal(m_tidDispatch, pthread_self()) == 0)
+    {
+        m_u32DispatchWaiters++;
+        while (m_nDispatchFD == nFD && m_u32DispatchGeneration == u32Generation)
+            m_condDispatch.block(&m_CSLocal);
+        m_u32DispatchWaiters--;
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "RCT> unrg: %d",
+        nFD);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::Reactor::Poll(int64_t i64Timeout)
+{
+    int                         nTimeoutMS              =   -1;
+    // clamped - a timeout too long for an int would otherwise wrap, perhaps to a negative "forever"
+    if (i64Timeout >= 0)
+        nTimeoutMS = i64Timeout >= (int64_t) INT_MAX * 1000 ? INT_MAX : (int) ((i64Timeout + 999) / 1000);
+
+    int                         nRC;
+    nRC = epoll_wait(m_nEpoll, &m_vecEvents[0], (int) m_vecEvents.size(), nTimeoutMS);
+    if (nRC == -1)
+    {
+        int                     nSaveErrno              =   errno;
+        if (nSaveErrno == EINTR)
+            return 0;
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "epoll_wait " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+
+    size_t                      uDispatched             =   0;
+    for (int i = 0; i < nRC; i++)
+    {
+        uint32_t                u32Events               =   m_vecEvents[i].events;
+        int                     nFD                     =   ReactorDecodeFD(m_vecEvents[i].data.u64);
+        uint32_t                u32Generation           =   ReactorDecodeGeneration(m_vecEvents[i].data.u64);
+
+        if (nFD == REACTOR_WAKE_FD)
+        {
+            uint64_t            u64Count;
+            while (read(m_nWakeFD, &u64Count, sizeof(u64Count)) == sizeof(u64Count))
+                ;
+            continue;
+        }
+
+        Registration            reg;
+        {
+            libthrocket::Lock   l(&m_CSLocal);
+            std::map<int, Registration>::iterator iter  =   m_mapRegistrations.find(nFD);
+            // unregistered (possibly by an earlier callback in this batch) or fd reused since
+            if (iter == m_mapRegistrations.end() || iter->second.u32Generation != u32Generation)
+                continue;
+            reg = iter->second;
+
+            // from here until DispatchDone() Unregister() on another thread waits for us
+            m_nDispatchFD           = nFD;
+            m_u32DispatchGeneration = u32Generation;
+            m_tidDispatch           = pthread_self();
+        }
+
+        try
+        {
+            if ((u32Events & (EPOLLERR | EPOLLHUP)) != 0)
+            {
+                reg.pHandler->OnHangup(reg.pSocket);
+                uDispatched++;
+
+            } else
+            {
+                bool            bWritable               =   (u32Events & EPOLLOUT) != 0;
+                if ((u32Events & (EPOLLIN | EPOLLRDHUP)) != 0)
+                {
+                    reg.pHandler->OnReadable(reg.pSocket);
+                    uDispatched++;
+
+                    // the read callback may have unregistered (and closed) the socket
+                    libthrocket::Lock l(&m_CSLocal);
+                    std::map<int, Registration>::iterator iter  =   m_mapRegistrations.find(nFD);
+                    if (iter == m_mapRegistrations.end() || iter->second.u32Generation != u32Generation)
+                        bWritable = false;
+                }
+                if (bWritable)
+                {
+                    reg.pHandler->OnWritable(reg.pSocket);
+                    uDispatched++;
+                }
+            }
+        }
+        catch (...)
+        {
+            DispatchDone();
+            throw;
+        }
+
+        DispatchDone();
+    }
+
+    return uDispatched;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the callback has returned - release any Unregister() waiting for it
+void
+libthrocket::Reactor::DispatchDone()
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    m_nDispatchFD = -1;
+    if (m_u32DispatchWaiters > 0)
+        m_condDispatch.broadcast();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    while (m_bStopRequested == false)
+        Poll(-1);
+    m_bStopRequested = false;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Reactor::Stop()
+{
+    m_bStopRequested = true;
+
+    uint64_t                    u64One                  =   1;
+    if (write(m_nWakeFD, &u64One, sizeof(u64One)) != sizeof(u64One) && errno != EAGAIN)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ReactorSysException(LIBTHROCKET_THROWN_BY, "write wake " + std::to_string(nSaveErrno) +
+                                                  " (" + strerror(nSaveErrno) + ")");
+    }
+}
+
+//============================================================================================================================= 132
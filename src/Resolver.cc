@@ -0,0 +1,473 @@
+//============================================================================================================================= 132
+//
+//  Resolver.cc
+//
+//      Thread-safe, caching host name resolution.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <ctype.h>
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#include "AlarmDebugLog.h"
+#include "Resolver.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// DNS names are case-insensitive
+static string ResolverKey(const string& strHostname)
+{
+    string                      strKey                  =   strHostname;
+    for (size_t i = 0; i < strKey.size(); i++)
+        strKey[i] = (char) tolower((unsigned char) strKey[i]);
+    return strKey;
+}
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class ResolverThread        :   public Thread
+{
+    public:
+                                ResolverThread(Resolver * pResolver)    :
+                                    m_pResolver(pResolver)
+                                {}
+        virtual                 ~ResolverThread()
+                                {}
+
+    protected:
+
+        virtual void            Run();
+
+    private:
+
+        Resolver              * m_pResolver;
+
+                                // disallow default construction / copy constructors
+                                ResolverThread();
+                                ResolverThread(const ResolverThread &);
+        void                    operator=(const ResolverThread &);
+};
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ResolverThread::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    while (GetStopRequested() == false)
+    {
+        try
+        {
+            m_pResolver->Work(RESOLVER_POLL);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::ResolverGetAddrInfo::Lookup(const string& strHostname, vector<string>& vecIPAddrs, int64_t& i64TTL)
+{
+    struct addrinfo             hints;
+    struct addrinfo           * pai                     =   NULL;
+
+    (void) i64TTL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family     = m_nFamily;
+    hints.ai_socktype   = SOCK_STREAM;
+
+    int                         nRC                     =   getaddrinfo(strHostname.c_str(), NULL, &hints, &pai);
+    if (nRC == EAI_NONAME || nRC == EAI_NODATA || nRC == EAI_FAMILY)
+        return false;
+    if (nRC != 0)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ResolvLookupException(LIBTHROCKET_THROWN_BY, "getaddrinfo " + strHostname + " " +
+                                    std::to_string(nRC) + " (" + gai_strerror(nRC) + ")" +
+                                    (nRC == EAI_SYSTEM ? string(" ") + strerror(nSaveErrno) : string("")));
+    }
+
+    for (struct addrinfo * p = pai; p != NULL; p = p->ai_next)
+    {
+        if (p->ai_family != AF_INET && p->ai_family != AF_INET6)
+            continue;
+        string                  strIPAddr               =   SocketAddress(p->ai_addr, p->ai_addrlen).IPString();
+        bool                    bDup                    =   false;
+        for (size_t i = 0; i < vecIPAddrs.size() && bDup == false; i++)
+            bDup = vecIPAddrs[i] == strIPAddr;
+        if (bDup == false)
+            vecIPAddrs.push_back(strIPAddr);
+    }
+    freeaddrinfo(pai);
+
+    return vecIPAddrs.size() > 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ResolverHosts::Load(const string& strPath)
+{
+    FILE                      * pf                      =   fopen(strPath.c_str(), "r");
+    if (pf == NULL)
+    {
+        int                     nSaveErrno              =   errno;
+        throw libthrocket::ResolvParamException(LIBTHROCKET_THROWN_BY, "fopen " + strPath + " " +
+                                    std::to_string(nSaveErrno) + " (" + strerror(nSaveErrno) + ")");
+    }
+
+    char                        acLine[1024];
+    while (fgets(acLine, sizeof(acLine), pf) != NULL)
+    {
+        char                  * pcHash                  =   strchr(acLine, '#');
+        if (pcHash != NULL)
+            *pcHash = '\0';
+
+        char                  * pcSave                  =   NULL;
+        char                  * pcAddr                  =   strtok_r(acLine, " \t\r\n", &pcSave);
+        if (pcAddr == NULL)
+            continue;
+
+        if (InetSocket::ValidIPAddr(pcAddr) == false)
+            continue;
+
+        char                  * pcName;
+        while ((pcName = strtok_r(NULL, " \t\r\n", &pcSave)) != NULL)
+            Add(pcName, pcAddr);
+    }
+
+    fclose(pf);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a name listed more than once collects every address, in order
+void
+libthrocket::ResolverHosts::Add(const string& strHostname, const string& strIPAddr, int64_t i64TTL)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    Host                      & host                    =   m_mapHosts[ResolverKey(strHostname)];
+    host.vecIPAddrs.push_back(strIPAddr);
+    host.i64TTL = i64TTL;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ResolverHosts::Clear()
+{
+    libthrocket::Lock           l(&m_CSLocal);
+    m_mapHosts.clear();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::ResolverHosts::Lookup(const string& strHostname, vector<string>& vecIPAddrs, int64_t& i64TTL)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    std::map<std::string, Host>::iterator it            =   m_mapHosts.find(ResolverKey(strHostname));
+    if (it == m_mapHosts.end())
+        return false;
+
+    vecIPAddrs = it->second.vecIPAddrs;
+    if (it->second.i64TTL > 0)
+        i64TTL = it->second.i64TTL;
+
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::Resolver::Resolver
+(
+    ResolverSource            * pSource,
+    uint32_t                    u32Workers,
+    int64_t                     i64TTL,
+    int64_t                     i64NegativeTTL,
+    uint32_t                    u32MaxEntries
+)   :
+    m_pSource(pSource),
+    m_bOwnSource(false),
+    m_i64TTL(i64TTL),
+    m_i64NegativeTTL(i64NegativeTTL),
+    m_u32MaxEntries(u32MaxEntries),
+    m_u64Generation(0)
+{
+    if (u32Workers < 1)
+        throw libthrocket::ResolvParamException(LIBTHROCKET_THROWN_BY, "u32Workers " + std::to_string(u32Workers));
+    if (i64TTL < 0 || i64NegativeTTL < 0)
+        throw libthrocket::ResolvParamException(LIBTHROCKET_THROWN_BY, "TTL " + std::to_string(i64TTL) + " negative TTL " +
+                                    std::to_string(i64NegativeTTL));
+
+    if (m_pSource == NULL)
+    {
+        m_pSource = new ResolverGetAddrInfo();
+        m_bOwnSource = true;
+    }
+
+    for (uint32_t i = 0; i < u32Workers; i++)
+        ChildBirth(new ResolverThread(this))->go();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// lookups still queued are abandoned - their futures report std::future_error (broken_promise)
+libthrocket::Resolver::~Resolver()
+{
+    Infanticide();
+
+    ThreadMessage             * pMsg;
+    while ((pMsg = m_qLookups.getNonBlocking()) != NULL)
+        delete pMsg;
+
+    if (m_bOwnSource)
+        delete m_pSource;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+std::shared_future<std::vector<std::string> >
+libthrocket::Resolver::ResolveAsync(const string& strHostname)
+{
+    if (strHostname.size() < 1)
+        throw libthrocket::ResolvParamException(LIBTHROCKET_THROWN_BY, "empty hostname");
+
+    // an address already - nothing to look up or cache
+    if (InetSocket::ValidIPAddr(strHostname))
+    {
+        std::promise<std::vector<std::string> > promise;
+        promise.set_value(std::vector<std::string>(1, strHostname));
+        return promise.get_future().share();
+    }
+
+    string                      strKey                  =   ResolverKey(strHostname);
+    int64_t                     i64Now                  =   TimeuS64();
+    std::promise<std::vector<std::string> > * pPromise  =   NULL;
+    uint64_t                    u64Generation;
+    std::shared_future<std::vector<std::string> > future;
+
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+
+        std::map<std::string, Entry>::iterator it       =   m_mapCache.find(strKey);
+        if (it != m_mapCache.end() && i64Now < it->second.i64Expire)
+            return it->second.future;
+
+        if (it == m_mapCache.end() && m_mapCache.size() >= m_u32MaxEntries)
+            LockedPrune(i64Now);
+
+        pPromise        = new std::promise<std::vector<std::string> >();
+        u64Generation   = ++m_u64Generation;
+        future          = pPromise->get_future().share();
+
+        Entry         & entry                           =   m_mapCache[strKey];
+        entry.future        = future;
+        entry.i64Expire     = INT64_MAX;
+        entry.u64Generation = u64Generation;
+    }
+
+    ThreadMessagePtr<std::promise<std::vector<std::string> > > * pMsg =
+                                                            new ThreadMessagePtr<std::promise<std::vector<std::string> > >(pPromise);
+    pMsg->SetStr(0, strKey);
+    pMsg->SetInt(0, (size_t) u64Generation);
+    m_qLookups.put(pMsg);
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "RSV> miss: %s", strKey.c_str());
+
+    return future;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Resolver::Flush()
+{
+    libthrocket::Lock           l(&m_CSLocal);
+    m_mapCache.clear();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::Resolver::Work(int64_t i64Timeout)
+{
+    ThreadMessage             * pMsg                    =   m_qLookups.getTimed((uint32_t) i64Timeout);
+    if (pMsg == NULL)
+        return;
+
+    ThreadMessagePtr<std::promise<std::vector<std::string> > > * pLookup =
+                                                            static_cast<ThreadMessagePtr<std::promise<std::vector<std::string> > > *>(pMsg);
+    std::promise<std::vector<std::string> > * pPromise  =   pLookup->GetPtr();
+    string                      strKey                  =   pMsg->GetStr(0);
+    uint64_t                    u64Generation           =   pMsg->GetInt(0);
+    std::vector<std::string>    vecIPAddrs;
+    int64_t                     i64TTL                  =   m_i64TTL;
+    int64_t                     i64Start                =   TimeuS64();
+
+    try
+    {
+        if (m_pSource->Lookup(strKey, vecIPAddrs, i64TTL) && vecIPAddrs.size() > 0)
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "RSV> look: %s %s (+%zu) %ld uS", strKey.c_str(), vecIPAddrs[0].c_str(), vecIPAddrs.size() - 1,
+                TimeuS64() - i64Start);
+            Expire(strKey, u64Generation, i64TTL);
+            pPromise->set_value(vecIPAddrs);
+
+        } else
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "RSV> look: %s not found %ld uS", strKey.c_str(), TimeuS64() - i64Start);
+            Expire(strKey, u64Generation, m_i64NegativeTTL);
+            pPromise->set_exception(std::make_exception_ptr(
+                libthrocket::ResolvLookupException(LIBTHROCKET_THROWN_BY, "no such host " + strKey)));
+        }
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        // transient - the next caller asks again
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+        Expire(strKey, u64Generation, 0);
+        pPromise->set_exception(std::current_exception());
+    }
+    catch (const std::exception & e)
+    {
+        // a source not our own - the waiters still get an answer, and the entry must not stay in progress forever
+        LOGWARNING("RSV> look: %s source threw std::exception: %s", strKey.c_str(), e.what());
+        Expire(strKey, u64Generation, 0);
+        pPromise->set_exception(std::current_exception());
+    }
+    catch (...)
+    {
+        LOGWARNING("RSV> look: %s source threw an unknown exception", strKey.c_str());
+        Expire(strKey, u64Generation, 0);
+        pPromise->set_exception(std::current_exception());
+    }
+
+    delete pMsg;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the lookup has finished - start its entry's clock, unless Flush() or a later lookup has replaced the entry
+void
+libthrocket::Resolver::Expire(const string& strKey, uint64_t u64Generation, int64_t i64TTL)
+{
+    libthrocket::Lock           l(&m_CSLocal);
+
+    std::map<std::string, Entry>::iterator it           =   m_mapCache.find(strKey);
+    if (it == m_mapCache.end() || it->second.u64Generation != u64Generation)
+        return;
+
+    if (i64TTL < 1)
+        m_mapCache.erase(it);
+    else
+        it->second.i64Expire = TimeuS64() + i64TTL;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// drop what has expired; if that is not enough, the answers closest to expiry (never lookups in progress)
+void
+libthrocket::Resolver::LockedPrune(int64_t i64Now)
+{
+    std::map<std::string, Entry>::iterator it           =   m_mapCache.begin();
+    while (it != m_mapCache.end())
+    {
+        if (it->second.i64Expire <= i64Now)
+            m_mapCache.erase(it++);
+        else
+            ++it;
+    }
+
+    while (m_mapCache.size() >= m_u32MaxEntries)
+    {
+        std::map<std::string, Entry>::iterator itOldest =   m_mapCache.end();
+        for (it = m_mapCache.begin(); it != m_mapCache.end(); ++it)
+            if (it->second.i64Expire != INT64_MAX && (itOldest == m_mapCache.end() || it->second.i64Expire < itOldest->second.i64Expire))
+                itOldest = it;
+        if (itOldest == m_mapCache.end())
+            break;
+        m_mapCache.erase(itOldest);
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the source for Resolv()'s Resolver - read once, when the first Resolv() constructs it
+static libthrocket::Mutex               g_CSResolvSource;
+static libthrocket::ResolverSource    * g_pResolvSource     =   NULL;
+static bool                             g_bResolvStarted    =   false;
+
+void
+libthrocket::SetResolvSource(ResolverSource * pSource)
+{
+    libthrocket::Lock           l(&g_CSResolvSource);
+    if (g_bResolvStarted)
+        throw libthrocket::ResolvParamException(LIBTHROCKET_THROWN_BY, "source set after the first Resolv()");
+    g_pResolvSource = pSource;
+}
+
+static libthrocket::ResolverSource * TakeResolvSource()
+{
+    libthrocket::Lock           l(&g_CSResolvSource);
+    g_bResolvStarted = true;
+    return g_pResolvSource;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the original interface, now backed by a shared caching Resolver
+const string
+libthrocket::Resolv(const string& strHostname)
+{
+    static libthrocket::Resolver resolver(TakeResolvSource());
+
+    return resolver.Resolve(strHostname);
+}
+
+//============================================================================================================================= 132
@@ -35,32 +35,18 @@ SOFTWARE.
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 #include "AlarmDebugLog.h"
+#include "IOUring.h"
 #include "Socket.h"
+#include "SocketInternal.h"
 
 using namespace std;
 
-//------------------------------=-----------------------=---------------------------------------------------------------------- 132
-inline int64_t TimeuS64(struct timeval* ptv = NULL)
-{
-    struct timeval tvNow;
-    int64_t        t64MicroTime;
-
-    if (ptv == NULL)
-    {
-        ptv = &tvNow;
-        ::gettimeofday(ptv, NULL);
-    }
-    t64MicroTime = ptv->tv_sec;
-    t64MicroTime *= 1000000L;
-    t64MicroTime += ptv->tv_usec;
-
-    return t64MicroTime;
-}
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 #ifdef WIN32
 
 #define EINPROGRESS     WSAEWOULDBLOCK
+#define MSG_DONTWAIT    0
 
 typedef int socklen_t;
 
@@ -74,17 +60,22 @@ libthrocket::Mutex                     Socket::m_csWSAStartup;
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <deque>
+#include <map>
+#include <memory>
 #include <netdb.h>
+#include <net/if.h>
 #include <unistd.h>
 #include <arpa/inet.h>
+#include <linux/errqueue.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
 #include <sys/ioctl.h>
 #include <sys/poll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
-#define GetLastError() errno
 #define closesocket(s) close(s)
 #define SOCKET_ERROR (-1)
 #define INVALID_SOCKET (-1)
@@ -93,73 +84,6 @@ typedef int (*tTransferProc)(int, void*, int, int);
 
 #endif  // WIN32
 
-//------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
-#ifdef WIN32
-
-static const string
-libthrocket::SocketErrorString(int nErr)
-{
-    char                        acMsg[128];
-    FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                    NULL, nErr, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                    (LPTSTR) acMsg, sizeof(acMsg), NULL );
-    return acMsg;
-}
-
-#else   // WIN32
-
-static const string
-SocketErrorString(int nErr)
-{
-    return strerror(nErr);
-}
-
-#endif  // WIN32
-
-//------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
-const string
-Resolv(const string& strHostname)
-{
-    // if an IP address cannot be parsed, assume we already have a hostname
-    string                      strIPAddr               =   strHostname;
-    static libthrocket::Mutex          csResolv;
-    uint32_t                    u32IPAddr;
-    struct hostent*             phent;
-
-    libthrocket::Lock                  l(&csResolv);
-
-    u32IPAddr = inet_addr(strHostname.c_str());
-    if (u32IPAddr == (uint32_t) -1)
-    {
-        phent = gethostbyname(strHostname.c_str());
-        if (phent != NULL)
-        {
-            if (phent->h_length == sizeof(u32IPAddr))
-            {
-                memcpy(&u32IPAddr, phent->h_addr, sizeof(u32IPAddr));
-                strIPAddr = libthrocket::InetSocket::AddrString(u32IPAddr, 0);
-            } else
-            {
-                int             nSaveErrno              =   GetLastError();
-                throw libthrocket::ResolvFamilyException(LIBTHROCKET_THROWN_BY, "gethostbyname " + strHostname + " " +
-                                            std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
-            }
-        } else
-        {
-            int                 nSaveErrno              =   GetLastError();
-            throw libthrocket::ResolvLookupException(LIBTHROCKET_THROWN_BY, "gethostbyname " + strHostname + " " +
-                                        std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
-        }
-    } else
-    {
-        // NADA
-    }
-
-   return strIPAddr;
-}
-
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 void
@@ -285,6 +209,7 @@ libthrocket::Socket::SetSendTimeout(int64_t i64Timeout)
     if (i64Timeout < 0)
         throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, string("i64Timeout ") + std::to_string(i64Timeout));
 
+    libthrocket::Lock                  lMeta(&m_SMMeta);
     m_i64SendTimeout = i64Timeout;
 }
 
@@ -298,6 +223,7 @@ libthrocket::Socket::SetRecvTimeout(int64_t i64Timeout)
     if (i64Timeout < 0)
         throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, string("i64Timeout ") + std::to_string(i64Timeout));
 
+    libthrocket::Lock                  lMeta(&m_SMMeta);
     m_i64RecvTimeout = i64Timeout;
 }
 
@@ -379,8 +305,15 @@ libthrocket::Socket::Select(bool bWantRead, bool bWantWrite, int64_t i64Timeout)
     }
 
     if (bCheckErr != false && (pfd[0].revents & POLLERR) != 0)
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "select: (" + LockedGetPeerAddrString() + ") " +
-                                        std::to_string(i64Latency) + "/" + std::to_string(i64Timeout) + " uS socket error");
+    {
+        // a non-empty error queue (e.g. MSG_ZEROCOPY completions) also raises POLLERR - only SO_ERROR is fatal
+        int                     nSockErr                =   0;
+        socklen_t               nLen                    =   sizeof(nSockErr);
+        if (getsockopt(m_nSocket, SOL_SOCKET, SO_ERROR, (char*) &nSockErr, &nLen) != 0 || nSockErr != 0)
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "select: (" + LockedGetPeerAddrString() + ") " +
+                                        std::to_string(i64Latency) + "/" + std::to_string(i64Timeout) + " uS socket error " +
+                                        std::to_string(nSockErr) + " (" + SocketErrorString(nSockErr) + ")");
+    }
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
@@ -391,7 +324,7 @@ libthrocket::Socket::SetFD(int nSocket)
     if (m_nSocket != INVALID_SOCKET)
         throw libthrocket::SocketInitException(LIBTHROCKET_THROWN_BY, "m_nSocket != INVALID_SOCKET");
 
-    m_nSocket = nSocket;
+    LockedSetFD(nSocket);
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
@@ -406,6 +339,11 @@ libthrocket::Socket::LockedClose()
             "SCK> clos: %d", 
             m_nSocket);
 
+        // nothing on the ring may still be using the number or the fixed slot once they are given up
+        LockedQuiesceRingIO();
+        // a getter holding m_SMMeta never sees the number after it is closed (and perhaps reused)
+        libthrocket::Lock              lMeta(&m_SMMeta);
+        LockedReleaseIOFixedFile();
         closesocket(m_nSocket);
         m_nSocket = INVALID_SOCKET;
     }
@@ -537,406 +475,643 @@ libthrocket::Socket::LockedSetBlocking(bool bBlocking)
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 void
-libthrocket::InetSocket::LockedOpen()
+libthrocket::Socket::LockedSetIOEngine(IOUringEngine * pEngine, bool bFixedFile)
 {
-    if (m_nSocket == INVALID_SOCKET)
-    {
-        m_nSocket = socket(PF_INET, m_nSocketType, 0);
-        if (m_nSocket == INVALID_SOCKET)
-        {
-            int                 nSaveErrno              =   GetLastError();
-            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "socket " + std::to_string(nSaveErrno) +
-                                                      " (" + SocketErrorString(nSaveErrno) + ")");
-        }
-    }
+#ifdef WIN32
+
+    if (pEngine != NULL)
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "LockedSetIOEngine not implemented on WIN32");
+
+#else
+    LockedQuiesceRingIO();
+    libthrocket::Lock                  lMeta(&m_SMMeta);
+    LockedReleaseIOFixedFile();
+    m_pIOEngine     = pEngine;
+    m_bIOFixedFile  = pEngine != NULL && bFixedFile;
+#endif  // WIN32
 
     LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "SCK> open: %d (%21s) got fd",
-        LockedGetFD(), LockedGetPeerAddrString().c_str());
+        "SCK>       %d (%21s) I/O engine %s%s",
+        LockedGetFD(), LockedGetPeerAddrString().c_str(),
+        pEngine != NULL ? "io_uring" : "poll", m_bIOFixedFile ? " fixed file" : "");
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
-void
-libthrocket::InetSocket::LockedBind(const string& strIPAddr, uint16_t u16Port, int nListenLen)
+// a zero timeout is a single non-blocking syscall either way, so only waiting operations go to the ring
+bool
+libthrocket::Socket::LockedUseIOEngine(uint8_t u8Op, int64_t i64Timeout)
 {
-    LockedOpen();
+    if (m_pIOEngine == NULL || i64Timeout < 1 || m_nSocket == INVALID_SOCKET || m_pIOEngine->Supports(u8Op) == false)
+        return false;
 
-    if (m_strIPAddr == "")
+    if (m_bIOFixedFile && m_nIOFixedSlot < 0)
     {
-        LockedReuseAddr();
+        libthrocket::Lock              lMeta(&m_SMMeta);
+        m_nIOFixedSlot = m_pIOEngine->RegisterFile(m_nSocket);
+        // table full - carry on with the plain descriptor
+        if (m_nIOFixedSlot < 0)
+            m_bIOFixedFile = false;
+    }
 
-        struct sockaddr_in      sin;
-        sin.sin_family      =   PF_INET;
-        sin.sin_port        =   htons(u16Port);
-        sin.sin_addr.s_addr =   inet_addr(strIPAddr.c_str());
-        if (bind(m_nSocket, (struct sockaddr*) &sin, sizeof(sin)) != 0)
-        {
-            int                 nSaveErrno              =   GetLastError();
-            closesocket(m_nSocket);
-            throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "bind " + AddrString(strIPAddr, u16Port) + " " +
-                                      std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
-        }
+    return true;
+}
 
-        struct sockaddr         sin_bound;
-        socklen_t               slen                    =   sizeof(sin_bound);
-        if (getsockname(m_nSocket, &sin_bound, &slen) != 0)
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// another thread's Recv() may be waiting on the ring with m_CSLocal let go - cancel it rather than wait out its timeout
+void
+libthrocket::Socket::LockedQuiesceRingIO()
+{
+    // again until they are all back - one may not have reached the ring when the first cancel went in
+    m_bRingQuiescing = m_u32RingIOs > 0;
+    while (m_u32RingIOs > 0)
+    {
+        try
         {
-            int                 nSaveErrno              =   GetLastError();
-            closesocket(m_nSocket);
-            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "getsockname " + AddrString(strIPAddr, u16Port) + " " +
-                                     std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+            m_pIOEngine->CancelFD(m_nSocket);
         }
-
-        if (m_nSocketType == SOCK_STREAM && listen(m_nSocket, nListenLen) != 0)
+        catch (const libthrocket::Exception & e)
         {
-            int                 nSaveErrno              =   GetLastError();
-            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY,    "listen " + AddrString(strIPAddr, u16Port) + " " +
-                                                   std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ')');
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
         }
-
-        m_strIPAddr =   strIPAddr;
-        //m_u16Port =   u16Port;
-        m_u16Port = ntohs(((struct sockaddr_in*) &sin_bound)->sin_port);
+        m_condRingIOs.blockTimed(&m_CSLocal, (uint32_t) 10000);
     }
-
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "SCK> bind: %d (%21s) bound",
-        LockedGetFD(), LockedGetLocalAddrString().c_str());
+    m_bRingQuiescing = false;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
-// use on listen socket to immediately release port binding upon close
+//
 void
-libthrocket::InetSocket::LockedReuseAddr()
+libthrocket::Socket::LockedCheckRingClosed(int nFD, const char* pcFunc)
 {
-    #ifdef WIN32
-
-        // WIN32 doesn't seem to need this
-
-    #else   // WIN32
-        int                         nEnabled                =   1;
+    if (m_bRingQuiescing || m_nSocket != nFD)
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(nFD) +
+                                                  " closed while waiting");
+}
 
-        if (setsockopt(m_nSocket, SOL_SOCKET, SO_REUSEADDR, &nEnabled, sizeof(nEnabled)) != 0)
-        {
-            int                     nSaveErrno              =   GetLastError();
-            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_REUSEADDR " +
-                                    std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
-        }
-    #endif  // WIN32
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the ring holds its own reference to a fixed file, so this must come before close() - under m_SMMeta, with the number
+void
+libthrocket::Socket::LockedReleaseIOFixedFile()
+{
+    if (m_nIOFixedSlot < 0)
+        return;
 
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "SCK>       %d (%21s) reuse addr",
-        LockedGetFD(), LockedGetPeerAddrString().c_str());
+    try
+    {
+        m_pIOEngine->UnregisterFile(m_nIOFixedSlot);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+    m_nIOFixedSlot = -1;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::IPAddrString(uint32_t u32IPAddr)
+void
+libthrocket::SocketAddress::clear()
 {
-    uint32_t                    hl;
-    string                      strAddr;
+    memset(&m_ss, 0, sizeof(m_ss));
+    m_ss.ss_family = AF_UNSPEC;
+    m_slen = 0;
+}
 
-    hl = htonl(u32IPAddr);
-    strAddr  = std::to_string((hl & 0xFF000000) >> 24);
-    strAddr += '.';
-    strAddr += std::to_string((hl & 0x00FF0000) >> 16);
-    strAddr += '.';
-    strAddr += std::to_string((hl & 0x0000FF00) >>  8);
-    strAddr += '.';
-    strAddr += std::to_string((hl & 0x000000FF));
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// inet_pton() rather than inet_addr() - "255.255.255.255" is an address, not an error, and nothing here ever goes to DNS
+bool
+libthrocket::SocketAddress::Parse(const string& strIPAddr, uint16_t u16Port)
+{
+    clear();
 
-    return strAddr;
+    struct sockaddr_in        * psin                    =   (struct sockaddr_in*) &m_ss;
+    if (inet_pton(AF_INET, strIPAddr.c_str(), &psin->sin_addr) == 1)
+    {
+        psin->sin_family = AF_INET;
+        psin->sin_port   = htons(u16Port);
+        m_slen = sizeof(struct sockaddr_in);
+        return true;
+    }
+
+    // a link-local address needs its interface - "fe80::1%eth0"
+    string                      strAddr                 =   strIPAddr;
+    uint32_t                    u32ScopeID              =   0;
+    size_t                      uPercent                =   strAddr.find('%');
+    if (uPercent != string::npos)
+    {
+        string                  strScope                =   strAddr.substr(uPercent + 1);
+        strAddr.resize(uPercent);
+        u32ScopeID = if_nametoindex(strScope.c_str());
+        if (u32ScopeID == 0)
+            u32ScopeID = (uint32_t) strtoul(strScope.c_str(), NULL, 10);
+        if (u32ScopeID == 0)
+            return false;
+    }
+
+    struct sockaddr_in6       * psin6                   =   (struct sockaddr_in6*) &m_ss;
+    if (inet_pton(AF_INET6, strAddr.c_str(), &psin6->sin6_addr) == 1)
+    {
+        psin6->sin6_family   = AF_INET6;
+        psin6->sin6_port     = htons(u16Port);
+        psin6->sin6_scope_id = u32ScopeID;
+        m_slen = sizeof(struct sockaddr_in6);
+        return true;
+    }
+
+    clear();
+    return false;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::AddrString(uint32_t u32IPAddr, uint16_t u16Port)
+bool
+libthrocket::SocketAddress::ParseAddrString(const string& strAddr)
 {
-    string                      strAddr;
-    strAddr = IPAddrString(u32IPAddr);
-    if (u16Port != 0)
+    string                      strIPAddr;
+    string                      strPort;
+
+    if (strAddr.size() > 0 && strAddr[0] == '[')
     {
-        strAddr += ':';
-        strAddr += std::to_string(u16Port);
+        size_t                  uClose                  =   strAddr.find(']');
+        if (uClose == string::npos || uClose + 1 >= strAddr.size() || strAddr[uClose + 1] != ':')
+        {
+            clear();
+            return false;
+        }
+        strIPAddr = strAddr.substr(1, uClose - 1);
+        strPort   = strAddr.substr(uClose + 2);
+    } else
+    {
+        // a bare IPv6 address has colons of its own, so it must be bracketed to carry a port
+        size_t                  uColon                  =   strAddr.find(':');
+        if (uColon == string::npos || strAddr.find(':', uColon + 1) != string::npos)
+        {
+            clear();
+            return false;
+        }
+        strIPAddr = strAddr.substr(0, uColon);
+        strPort   = strAddr.substr(uColon + 1);
     }
-    return strAddr;
+
+    char                      * pcEnd                   =   NULL;
+    unsigned long               ulPort                  =   strtoul(strPort.c_str(), &pcEnd, 10);
+    if (strPort.size() < 1 || *pcEnd != '\0' || ulPort > 0xFFFF)
+    {
+        clear();
+        return false;
+    }
+
+    return Parse(strIPAddr, (uint16_t) ulPort);
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::AddrString(const string& strIPAddr, uint16_t u16Port)
+void
+libthrocket::SocketAddress::Set(const string& strIPAddr, uint16_t u16Port)
 {
-    return strIPAddr + ":" + std::to_string(u16Port);
+    if (Parse(strIPAddr, u16Port) == false)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "not an IP address: " + strIPAddr);
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::InetSocket::LockedGetEncodedLocalIP()
+void
+libthrocket::SocketAddress::Set(in_addr_t inaIPAddr, uint16_t u16Port)
 {
-    struct sockaddr_in          sin;
-    socklen_t                   slen                    =   sizeof(sin);
-    memset(&sin, 0, sizeof(sin));
-    if (getsockname(m_nSocket, (struct sockaddr*) &sin, &slen) == -1)
-        return 0;
-    return sin.sin_addr.s_addr;
+    clear();
+
+    struct sockaddr_in        * psin                    =   (struct sockaddr_in*) &m_ss;
+    psin->sin_family      = AF_INET;
+    psin->sin_addr.s_addr = inaIPAddr;
+    psin->sin_port        = htons(u16Port);
+    m_slen = sizeof(struct sockaddr_in);
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::LockedGetLocalIPString()
+void
+libthrocket::SocketAddress::Set(const struct sockaddr* psa, socklen_t slen)
 {
-    string                      strIP                   =   AddrString(LockedGetEncodedLocalIP());
-    return strIP;
+    clear();
+
+    if (psa == NULL || slen > sizeof(m_ss))
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "slen " + std::to_string(slen));
+
+    memcpy(&m_ss, psa, slen);
+    m_slen = slen;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint16_t
-libthrocket::InetSocket::LockedGetDecodedLocalPort()
+bool
+libthrocket::SocketAddress::GetIPv4(in_addr_t& inaIPAddr) const
 {
-    struct sockaddr_in          sin;
-    socklen_t                   slen                    =   sizeof(sin);
-    memset(&sin, 0, sizeof(sin));
-    if (getsockname(m_nSocket, (struct sockaddr*) &sin, &slen) == -1)
-        return 0;
-    return ntohs(sin.sin_port);
+    if (m_ss.ss_family == AF_INET)
+    {
+        inaIPAddr = ((const struct sockaddr_in*) &m_ss)->sin_addr.s_addr;
+        return true;
+    }
+
+    const struct sockaddr_in6 * psin6                   =   (const struct sockaddr_in6*) &m_ss;
+    if (m_ss.ss_family == AF_INET6 && IN6_IS_ADDR_V4MAPPED(&psin6->sin6_addr))
+    {
+        memcpy(&inaIPAddr, &psin6->sin6_addr.s6_addr[12], sizeof(inaIPAddr));
+        return true;
+    }
+
+    return false;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::LockedGetLocalPortString()
+libthrocket::SocketAddress
+libthrocket::SocketAddress::MapToIPv6() const
 {
-    uint16_t                    u16Port                 =   LockedGetDecodedLocalPort();
-    string                      strPort                 =   std::to_string(u16Port);
-    return strPort;
+    if (m_ss.ss_family != AF_INET)
+        return *this;
+
+    const struct sockaddr_in  * psin                    =   (const struct sockaddr_in*) &m_ss;
+    SocketAddress               addr;
+    struct sockaddr_in6       * psin6                   =   (struct sockaddr_in6*) &addr.m_ss;
+    psin6->sin6_family = AF_INET6;
+    psin6->sin6_port   = psin->sin_port;
+    psin6->sin6_addr.s6_addr[10] = 0xFF;
+    psin6->sin6_addr.s6_addr[11] = 0xFF;
+    memcpy(&psin6->sin6_addr.s6_addr[12], &psin->sin_addr.s_addr, sizeof(psin->sin_addr.s_addr));
+    addr.m_slen = sizeof(struct sockaddr_in6);
+    return addr;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::InetSocket::LockedGetLocalAddrString()
+uint16_t
+libthrocket::SocketAddress::GetDecodedPort() const
 {
-    return LockedGetLocalIPString() + ':' + LockedGetLocalPortString();
+    if (m_ss.ss_family == AF_INET)
+        return ntohs(((const struct sockaddr_in*) &m_ss)->sin_port);
+    if (m_ss.ss_family == AF_INET6)
+        return ntohs(((const struct sockaddr_in6*) &m_ss)->sin6_port);
+    return 0;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::UDPSocket::LockedSend(in_addr_t inaIPAddr, uint16_t u16Port, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+void
+libthrocket::SocketAddress::SetDecodedPort(uint16_t u16Port)
 {
-    int                         nRC                     =   0;
-    bool                        bWantRead               =   false;
-    bool                        bWantWrite              =   true;
-
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "UDP> send: %d (%21s) %u bytes TO %ld uS", 
-        LockedGetFD(), AddrString(inaIPAddr, u16Port).c_str(), u32Bytes, LockedGetSendTimeout());
+    if (m_ss.ss_family == AF_INET)
+        ((struct sockaddr_in*) &m_ss)->sin_port = htons(u16Port);
+    else if (m_ss.ss_family == AF_INET6)
+        ((struct sockaddr_in6*) &m_ss)->sin6_port = htons(u16Port);
+    else
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "no address family");
+}
 
-    LockedWait(bWantRead, bWantWrite, m_i64SendTimeout);
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::SocketAddress::IPString() const
+{
+    char                        acAddr[INET6_ADDRSTRLEN + IF_NAMESIZE + 1];
 
-    struct sockaddr_in          sin;
-    memset(&sin, 0, sizeof(sin));
-    sin.sin_family = PF_INET;
-    sin.sin_addr.s_addr = inaIPAddr;
-    sin.sin_port = htons(u16Port);
-    #ifdef WIN32
-        nRC = sendto(LockedGetFD(), (char*) pu8Bytes, u32Bytes, 0, (struct sockaddr*) &sin, sizeof(sin));
-    #else   // WIN32
-        nRC = sendto(LockedGetFD(),         pu8Bytes, u32Bytes, 0, (struct sockaddr*) &sin, sizeof(sin));
-    #endif  // WIN32
+    if (m_ss.ss_family == AF_INET)
+        return InetSocket::IPAddrString(((const struct sockaddr_in*) &m_ss)->sin_addr.s_addr);
 
-    if (nRC == -1)
-    {
-        int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "send: " + std::to_string(LockedGetFD()) + " " + 
-                                                  AddrString(inaIPAddr, u16Port) + " " + std::to_string(nSaveErrno) +
-                                                  " (" + SocketErrorString(nSaveErrno) + ")");
+    if (m_ss.ss_family != AF_INET6)
+        return "0.0.0.0";
 
-    } else if ((uint32_t) nRC != u32Bytes)
-    {
-        LOGWARNING("UDP> send: %d (%21s) %u bytes send mismatch %d bytes", 
-            LockedGetFD(), AddrString(inaIPAddr, u16Port).c_str(), u32Bytes, nRC);
+    const struct sockaddr_in6 * psin6                   =   (const struct sockaddr_in6*) &m_ss;
+    if (inet_ntop(AF_INET6, &psin6->sin6_addr, acAddr, INET6_ADDRSTRLEN) == NULL)
+        return "::";
 
-    } else
+    string                      strAddr                 =   acAddr;
+    if (psin6->sin6_scope_id != 0)
     {
-        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-            "UDP> send: %d (%21s) %d bytes", 
-            LockedGetFD(), AddrString(inaIPAddr, u16Port).c_str(), nRC);
+        char                    acScope[IF_NAMESIZE];
+        strAddr += '%';
+        if (if_indextoname(psin6->sin6_scope_id, acScope) != NULL)
+            strAddr += acScope;
+        else
+            strAddr += std::to_string(psin6->sin6_scope_id);
     }
-
-    return (uint32_t) nRC;
+    return strAddr;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::UDPSocket::LockedSend(const string& strIPAddr, uint16_t u16Port, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+const string
+libthrocket::SocketAddress::AddrString() const
 {
-    return LockedSend(inet_addr(strIPAddr.c_str()), u16Port, pu8Bytes, u32Bytes);
+    if (m_ss.ss_family == AF_INET6)
+        return '[' + IPString() + "]:" + std::to_string(GetDecodedPort());
+    return IPString() + ':' + std::to_string(GetDecodedPort());
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::UDPSocket::LockedRecv(in_addr_t& inaIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes)
+bool
+libthrocket::SocketAddress::operator==(const SocketAddress& other) const
 {
-    int                         nRC                     =   0;
-    bool                        bWantRead               =   true;
-    bool                        bWantWrite              =   false;
-
-    inaIPAddr = 0;
-    u16Port = 0;
+    if (m_ss.ss_family != other.m_ss.ss_family)
+        return false;
 
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "UDP> recv: %d (%21s) %u bytes TO %ld uS", 
-        LockedGetFD(), LockedGetLocalAddrString().c_str(), u32Bytes, LockedGetSendTimeout());
+    if (m_ss.ss_family == AF_INET)
+    {
+        const struct sockaddr_in  * psinA               =   (const struct sockaddr_in*) &m_ss;
+        const struct sockaddr_in  * psinB               =   (const struct sockaddr_in*) &other.m_ss;
+        return psinA->sin_port == psinB->sin_port && psinA->sin_addr.s_addr == psinB->sin_addr.s_addr;
+    }
 
-    LockedWait(bWantRead, bWantWrite, m_i64RecvTimeout);
+    if (m_ss.ss_family == AF_INET6)
+    {
+        const struct sockaddr_in6 * psin6A              =   (const struct sockaddr_in6*) &m_ss;
+        const struct sockaddr_in6 * psin6B              =   (const struct sockaddr_in6*) &other.m_ss;
+        return psin6A->sin6_port == psin6B->sin6_port && psin6A->sin6_scope_id == psin6B->sin6_scope_id &&
+               memcmp(&psin6A->sin6_addr, &psin6B->sin6_addr, sizeof(psin6A->sin6_addr)) == 0;
+    }
 
-    struct sockaddr_in          sin;
-    memset(&sin, 0, sizeof(sin));
-    socklen_t                   slen                    =   sizeof(sin);
-    #ifdef WIN32
-        nRC = recvfrom(LockedGetFD(), (char*) pu8Bytes, u32Bytes, 0, (struct sockaddr*) &sin, &slen);
-    #else   // WIN32
-        nRC = recvfrom(LockedGetFD(),         pu8Bytes, u32Bytes, 0, (struct sockaddr*) &sin, &slen);
-    #endif  // WIN32
+    return true;
+}
 
-    if (nRC == -1)
-    {
-        int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "recv: " + std::to_string(LockedGetFD()) + " " + 
-                                                  LockedGetLocalAddrString() + " " + std::to_string(nSaveErrno) +
-                                                  " (" + SocketErrorString(nSaveErrno) + ")");
-
-    } else
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::InetSocket::LockedOpen()
+{
+    if (m_nSocket == INVALID_SOCKET)
     {
-        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-            "UDP> recv: %d (%21s) %d bytes", 
-            LockedGetFD(), LockedGetLocalAddrString().c_str(), nRC);
+        if (m_nFamily != AF_INET6)
+            m_nFamily = AF_INET;
+        LockedSetFD(socket(m_nFamily == AF_INET6 ? PF_INET6 : PF_INET, m_nSocketType, 0));
+        if (m_nSocket == INVALID_SOCKET)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "socket " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+        }
     }
 
-    inaIPAddr = sin.sin_addr.s_addr;
-    u16Port = htons(sin.sin_port);
-
-    return (uint32_t) nRC;
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK> open: %d (%21s) got fd",
+        LockedGetFD(), LockedGetPeerAddrString().c_str());
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::UDPSocket::LockedRecv(string& strIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes)
+void
+libthrocket::InetSocket::LockedBind(const string& strIPAddr, uint16_t u16Port, int nListenLen)
 {
-    in_addr_t                   inaIPAddr;
-    uint32_t                    u32RC                   =   LockedRecv(inaIPAddr, u16Port, pu8Bytes, u32Bytes);
-    strIPAddr = AddrString(inaIPAddr);
-    return u32RC;
+    SocketAddress               addr;
+    if (addr.Parse(strIPAddr, u16Port) == false)
+        throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "bind " + AddrString(strIPAddr, u16Port) + " not an IP address");
+
+    LockedBind(addr, nListenLen);
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 void
-libthrocket::UDPSocket::LockedBroadcast()
+libthrocket::InetSocket::LockedBind(const SocketAddress& addr, int nListenLen)
 {
-    int                         nEnabled                =   1;
+    if (addr.IsValid() == false)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "bind: no address family");
 
-#ifdef WIN32
-
-    if (setsockopt(m_nSocket, SOL_SOCKET, SO_BROADCAST, (const char*) &nEnabled, sizeof (nEnabled)) != 0)
+    // ReusePort() may have opened the socket before we knew which family the address would be
+    if (m_nSocket != INVALID_SOCKET && m_strIPAddr == "" && LockedGetFamily() != addr.GetFamily())
     {
-        int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_BROADCAST " +
-                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        LockedClose();
+        m_nFamily = addr.GetFamily();
+        LockedOpen();
+        if (m_bReusePort)
+            LockedReusePort();
     }
+    if (m_nSocket == INVALID_SOCKET)
+        m_nFamily = addr.GetFamily();
 
-#else   // WIN32
+    LockedOpen();
 
-    if (setsockopt(m_nSocket, SOL_SOCKET, SO_BROADCAST, &nEnabled, sizeof (nEnabled)) != 0)
+    if (m_strIPAddr == "")
     {
-        int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_BROADCAST " + 
-                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        LockedReuseAddr();
+        if (addr.GetFamily() == AF_INET6)
+            LockedV6Only();
+
+        if (bind(m_nSocket, addr.GetSockAddr(), addr.GetLength()) != 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            // closed and forgotten - the destructor must not close the number again once another thread has it
+            LockedClose();
+            throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "bind " + addr.AddrString() + " " +
+                                      std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+
+        SocketAddress           addrBound;
+        if (LockedGetLocalAddress(addrBound) == false)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            // closed and forgotten - the destructor must not close the number again once another thread has it
+            LockedClose();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "getsockname " + addr.AddrString() + " " +
+                                     std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+
+        if (m_nSocketType == SOCK_STREAM && listen(m_nSocket, nListenLen) != 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY,    "listen " + addr.AddrString() + " " +
+                                                   std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ')');
+        }
+
+        m_strIPAddr =   addr.IPString();
+        m_u16Port   =   addrBound.GetDecodedPort();
     }
 
-#endif  // WIN32
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK> bind: %d (%21s) bound",
+        LockedGetFD(), LockedGetLocalAddrString().c_str());
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
+// use on listen socket to immediately release port binding upon close
 void
-libthrocket::TCPSocket::LockedNoNagle()
+libthrocket::InetSocket::LockedReuseAddr()
 {
-    int                         nEnabled                =   1;
+    #ifdef WIN32
 
-#ifdef WIN32
+        // WIN32 doesn't seem to need this
 
-    if (setsockopt(m_nSocket, IPPROTO_TCP, TCP_NODELAY, (const char*) &nEnabled, sizeof (nEnabled)) != 0)
+    #else   // WIN32
+        int                         nEnabled                =   1;
+
+        if (setsockopt(m_nSocket, SOL_SOCKET, SO_REUSEADDR, &nEnabled, sizeof(nEnabled)) != 0)
+        {
+            int                     nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_REUSEADDR " +
+                                    std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+    #endif  // WIN32
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK>       %d (%21s) reuse addr",
+        LockedGetFD(), LockedGetPeerAddrString().c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// use before bind to let several listen sockets share one port - the kernel load-balances connections among them
+void
+libthrocket::InetSocket::LockedReusePort()
+{
+    LockedOpen();
+
+    #ifdef WIN32
+
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "LockedReusePort not implemented on WIN32");
+
+    #else   // WIN32
+        int                         nEnabled                =   1;
+
+        if (setsockopt(m_nSocket, SOL_SOCKET, SO_REUSEPORT, &nEnabled, sizeof(nEnabled)) != 0)
+        {
+            int                     nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_REUSEPORT " +
+                                    std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+        m_bReusePort = true;
+    #endif  // WIN32
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK>       %d (%21s) reuse port",
+        LockedGetFD(), LockedGetPeerAddrString().c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// set either way - the net.ipv6.bindv6only default differs between hosts
+void
+libthrocket::InetSocket::LockedV6Only()
+{
+    int                         nEnabled                =   m_bV6Only ? 1 : 0;
+
+    if (setsockopt(m_nSocket, IPPROTO_IPV6, IPV6_V6ONLY, (const char*) &nEnabled, sizeof(nEnabled)) != 0)
     {
         int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " TCP_NODELAY " +
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " IPV6_V6ONLY " +
                                                   std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
     }
+}
 
-#else   // WIN32
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int
+libthrocket::InetSocket::LockedGetFamily()
+{
+    if (m_nFamily == AF_UNSPEC && m_nSocket != INVALID_SOCKET)
+    {
+        SocketAddress           addr;
+        if (LockedGetLocalAddress(addr))
+            m_nFamily = addr.GetFamily();
+    }
+    return m_nFamily == AF_INET6 ? AF_INET6 : AF_INET;
+}
 
-    if (setsockopt(m_nSocket, IPPROTO_TCP, TCP_NODELAY, &nEnabled, sizeof (nEnabled)) != 0)
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::InetSocket::IPAddrString(uint32_t u32IPAddr)
+{
+    uint32_t                    hl;
+    string                      strAddr;
+
+    hl = htonl(u32IPAddr);
+    strAddr  = std::to_string((hl & 0xFF000000) >> 24);
+    strAddr += '.';
+    strAddr += std::to_string((hl & 0x00FF0000) >> 16);
+    strAddr += '.';
+    strAddr += std::to_string((hl & 0x0000FF00) >>  8);
+    strAddr += '.';
+    strAddr += std::to_string((hl & 0x000000FF));
+
+    return strAddr;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::InetSocket::AddrString(uint32_t u32IPAddr, uint16_t u16Port)
+{
+    string                      strAddr;
+    strAddr = IPAddrString(u32IPAddr);
+    if (u16Port != 0)
     {
-        int                     nSaveErrno              =   GetLastError();
-        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " TCP_NODELAY " + 
-                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        strAddr += ':';
+        strAddr += std::to_string(u16Port);
     }
+    return strAddr;
+}
 
-#endif  // WIN32
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::InetSocket::AddrString(const string& strIPAddr, uint16_t u16Port)
+{
+    if (strIPAddr.find(':') != string::npos)
+        return '[' + strIPAddr + "]:" + std::to_string(u16Port);
+    return strIPAddr + ":" + std::to_string(u16Port);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// false (addr empty) when there is no socket or it is not bound
+bool
+libthrocket::InetSocket::LockedGetLocalAddress(SocketAddress& addr)
+{
+    socklen_t                   slen                    =   SocketAddress::GetCapacity();
+    addr.clear();
+    if (getsockname(m_nSocket, addr.GetSockAddrBuffer(), &slen) == -1)
+    {
+        addr.clear();
+        return false;
+    }
+    addr.SetLength(slen);
+    return true;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 uint32_t
-libthrocket::TCPSocket::LockedGetEncodedPeerIP()
+libthrocket::InetSocket::LockedGetEncodedLocalIP()
 {
-    struct sockaddr_in          sin;
-    socklen_t                   slen                    =   sizeof(sin);
-    memset(&sin, 0, sizeof(sin));
-    if (getpeername(m_nSocket, (struct sockaddr*) &sin, &slen) == -1)
-        return 0;
-    return sin.sin_addr.s_addr;
+    SocketAddress               addr;
+    in_addr_t                   inaIPAddr               =   0;
+    if (LockedGetLocalAddress(addr))
+        addr.GetIPv4(inaIPAddr);
+    return inaIPAddr;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint16_t
-libthrocket::TCPSocket::LockedGetDecodedPeerPort()
+const string
+libthrocket::InetSocket::LockedGetLocalIPString()
 {
-    struct sockaddr_in          sin;
-    socklen_t                   slen                    =   sizeof(sin);
-    memset(&sin, 0, sizeof(sin));
-    if (getpeername(m_nSocket, (struct sockaddr*) &sin, &slen) == -1)
-        return 0;
-    return ntohs(sin.sin_port);
+    SocketAddress               addr;
+    LockedGetLocalAddress(addr);
+    return addr.IPString();
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-const string
-libthrocket::TCPSocket::LockedGetPeerIPString()
+uint16_t
+libthrocket::InetSocket::LockedGetDecodedLocalPort()
 {
-    string                      strIP                   =   AddrString(LockedGetEncodedPeerIP());
-    return strIP;
+    SocketAddress               addr;
+    LockedGetLocalAddress(addr);
+    return addr.GetDecodedPort();
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 const string
-libthrocket::TCPSocket::LockedGetPeerPortString()
+libthrocket::InetSocket::LockedGetLocalPortString()
 {
-    uint16_t                    u16Port                 =   LockedGetDecodedPeerPort();
+    uint16_t                    u16Port                 =   LockedGetDecodedLocalPort();
     string                      strPort                 =   std::to_string(u16Port);
     return strPort;
 }
@@ -944,240 +1119,2135 @@ libthrocket::TCPSocket::LockedGetPeerPortString()
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 const string
-libthrocket::TCPSocket::LockedGetPeerAddrString()
+libthrocket::InetSocket::LockedGetLocalAddrString()
 {
-    return LockedGetPeerIPString() + ':' + LockedGetPeerPortString();
+    SocketAddress               addr;
+    LockedGetLocalAddress(addr);
+    return addr.AddrString();
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-void
-libthrocket::TCPSocket::LockedConnect
-(
-    const string&               strIPAddr,
-    uint16_t                    u16Port
-)
+uint32_t
+libthrocket::UDPSocket::LockedSend(in_addr_t inaIPAddr, uint16_t u16Port, const uint8_t* pu8Bytes, uint32_t u32Bytes)
 {
-    if (m_nSocket != INVALID_SOCKET)
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "m_nSocket != INVALID_SOCKET");
+    return LockedSend(SocketAddress(inaIPAddr, u16Port), pu8Bytes, u32Bytes);
+}
 
-    m_nSocket = socket(PF_INET, SOCK_STREAM, 0);
-    if (m_nSocket == INVALID_SOCKET)
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedSend(const SocketAddress& addrTo, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    int                         nRC                     =   0;
+    bool                        bWantRead               =   false;
+    bool                        bWantWrite              =   true;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> send: %d (%21s) %u bytes TO %ld uS", 
+        LockedGetFD(), addrTo.AddrString().c_str(), u32Bytes, LockedGetSendTimeout());
+
+    // an AF_INET6 socket only speaks IPv4 through mapped addresses
+    SocketAddress               addr                    =   addrTo;
+    if (addr.GetFamily() == AF_INET && LockedGetFamily() == AF_INET6)
+        addr = addrTo.MapToIPv6();
+    socklen_t                   slen                    =   addr.GetLength();
+
+    bool                        bIOEngine               =   LockedUseIOEngine(IORING_OP_SENDMSG, m_i64SendTimeout);
+
+    nRC = -1;
+    if (bIOEngine)
     {
-        int                     nSaveErrno;
-        nSaveErrno = GetLastError();
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "socket: " + std::to_string(nSaveErrno) +
-                                                      " (" + SocketErrorString(nSaveErrno) + ")");
-    }
+        nRC = LockedTransferMsgIOEngine(SOCKET_TRANSFER_SEND, (uint8_t*) pu8Bytes, u32Bytes, addr.GetSockAddrBuffer(), &slen,
+                                        m_i64SendTimeout);
 
-    try
+    } else if (m_bOptimisticIO)
     {
-        LockedSetNonBlocking();
+        #ifdef WIN32
+            nRC = sendto(LockedGetFD(), (char*) pu8Bytes, u32Bytes, MSG_DONTWAIT, addr.GetSockAddr(), slen);
+        #else   // WIN32
+            nRC = sendto(LockedGetFD(),         pu8Bytes, u32Bytes, MSG_DONTWAIT, addr.GetSockAddr(), slen);
+        #endif  // WIN32
     }
-    catch (const libthrocket::Exception & e)
+    if (bIOEngine == false && (m_bOptimisticIO == false || (nRC == -1 && (GetLastError() == EAGAIN || GetLastError() == EWOULDBLOCK))))
     {
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, e.GetDetail());
-    }
+        LockedWait(bWantRead, bWantWrite, m_i64SendTimeout);
 
-    struct sockaddr_in          sin;
-    memset(&sin, 0, sizeof(sin));
-    sin.sin_family = PF_INET;
-    sin.sin_addr.s_addr = inet_addr(strIPAddr.c_str());
-    sin.sin_port = htons(u16Port);
+        #ifdef WIN32
+            nRC = sendto(LockedGetFD(), (char*) pu8Bytes, u32Bytes, 0, addr.GetSockAddr(), slen);
+        #else   // WIN32
+            nRC = sendto(LockedGetFD(),         pu8Bytes, u32Bytes, 0, addr.GetSockAddr(), slen);
+        #endif  // WIN32
+    }
 
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "TCP> conn: %d (%21s)", 
-        LockedGetFD(), AddrString(sin.sin_addr.s_addr, htons(sin.sin_port)).c_str());
+    if (nRC == -1)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "send: " + std::to_string(LockedGetFD()) + " " + 
+                                                  addrTo.AddrString() + " " + std::to_string(nSaveErrno) +
+                                                  " (" + SocketErrorString(nSaveErrno) + ")");
 
-    if (connect(m_nSocket, (struct sockaddr*) &sin, sizeof(sin)) == SOCKET_ERROR)
+    } else if ((uint32_t) nRC != u32Bytes)
     {
-        int                     nSaveErrno;
-        nSaveErrno = GetLastError();
-        if (nSaveErrno != EINPROGRESS)
-            throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + std::to_string(nSaveErrno) +
-                                                          " (" + SocketErrorString(nSaveErrno) + ")");
-    }
+        LOGWARNING("UDP> send: %d (%21s) %u bytes send mismatch %d bytes", 
+            LockedGetFD(), addrTo.AddrString().c_str(), u32Bytes, nRC);
 
-    // non-blocking async connect completion
-    try
+    } else
     {
-        Select(false/*bWantRead*/, true/*bWantWrite*/, m_i64SendTimeout);
-        m_bConnected = true;
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "UDP> send: %d (%21s) %d bytes", 
+            LockedGetFD(), addrTo.AddrString().c_str(), nRC);
+    }
+
+    return (uint32_t) nRC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedSend(const string& strIPAddr, uint16_t u16Port, const uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    SocketAddress               addr;
+    if (addr.Parse(strIPAddr, u16Port) == false)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "send: " + AddrString(strIPAddr, u16Port) + " not an IP address");
+
+    return LockedSend(addr, pu8Bytes, u32Bytes);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedRecv(in_addr_t& inaIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    SocketAddress               addr;
+
+    inaIPAddr = 0;
+    u16Port = 0;
+
+    uint32_t                    u32RC                   =   LockedRecv(addr, pu8Bytes, u32Bytes);
+
+    // an IPv6 sender has no in_addr_t - it reads as 0
+    addr.GetIPv4(inaIPAddr);
+    u16Port = addr.GetDecodedPort();
+
+    return u32RC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedRecv(SocketAddress& addr, uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    int                         nRC                     =   0;
+    bool                        bWantRead               =   true;
+    bool                        bWantWrite              =   false;
+
+    addr.clear();
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> recv: %d (%21s) %u bytes TO %ld uS", 
+        LockedGetFD(), LockedGetLocalAddrString().c_str(), u32Bytes, LockedGetSendTimeout());
+
+    socklen_t                   slen                    =   SocketAddress::GetCapacity();
+
+    bool                        bIOEngine               =   LockedUseIOEngine(IORING_OP_RECVMSG, m_i64RecvTimeout);
+
+    nRC = -1;
+    if (bIOEngine)
+    {
+        nRC = LockedTransferMsgIOEngine(SOCKET_TRANSFER_RECV, pu8Bytes, u32Bytes, addr.GetSockAddrBuffer(), &slen, m_i64RecvTimeout);
+
+    } else if (m_bOptimisticIO)
+    {
+        #ifdef WIN32
+            nRC = recvfrom(LockedGetFD(), (char*) pu8Bytes, u32Bytes, MSG_DONTWAIT, addr.GetSockAddrBuffer(), &slen);
+        #else   // WIN32
+            nRC = recvfrom(LockedGetFD(),         pu8Bytes, u32Bytes, MSG_DONTWAIT, addr.GetSockAddrBuffer(), &slen);
+        #endif  // WIN32
+    }
+    if (bIOEngine == false && (m_bOptimisticIO == false || (nRC == -1 && (GetLastError() == EAGAIN || GetLastError() == EWOULDBLOCK))))
+    {
+        LockedWait(bWantRead, bWantWrite, m_i64RecvTimeout);
+
+        slen = SocketAddress::GetCapacity();
+        #ifdef WIN32
+            nRC = recvfrom(LockedGetFD(), (char*) pu8Bytes, u32Bytes, 0, addr.GetSockAddrBuffer(), &slen);
+        #else   // WIN32
+            nRC = recvfrom(LockedGetFD(),         pu8Bytes, u32Bytes, 0, addr.GetSockAddrBuffer(), &slen);
+        #endif  // WIN32
+    }
+
+    if (nRC == -1)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "recv: " + std::to_string(LockedGetFD()) + " " + 
+                                                  LockedGetLocalAddrString() + " " + std::to_string(nSaveErrno) +
+                                                  " (" + SocketErrorString(nSaveErrno) + ")");
+
+    } else
+    {
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "UDP> recv: %d (%21s) %d bytes", 
+            LockedGetFD(), LockedGetLocalAddrString().c_str(), nRC);
+    }
+
+    addr.SetLength(slen);
+
+    return (uint32_t) nRC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// sendmsg/recvmsg through the ring - returns like sendto()/recvfrom(): -1 with errno set on failure
+int
+libthrocket::UDPSocket::LockedTransferMsgIOEngine
+(
+    bool                        bDirection,
+    uint8_t                   * pu8Bytes,
+    uint32_t                    u32Bytes,
+    struct sockaddr           * psa,
+    socklen_t                 * pslen,
+    int64_t                     i64Timeout
+)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+    int32_t                     i32RC;
+
+    iov.iov_base = pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_name    = psa;
+    msg.msg_namelen = *pslen;
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+
+    IOUringEngine             * pEngine                 =   m_pIOEngine;
+    int                         nFD                     =   m_nSocket;
+    int                         nFixedSlot              =   m_nIOFixedSlot;
+
+    // like LockedWait(), do not block other threads while the ring waits
+    LockedBeginRingIO();
+    try
+    {
+        if (bDirection == SOCKET_TRANSFER_RECV)
+            i32RC = pEngine->RecvMsg(nFD, nFixedSlot, &msg, i64Timeout);
+        else
+            i32RC = pEngine->SendMsg(nFD, nFixedSlot, &msg, i64Timeout);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        EndRingIO();
+        throw;
+    }
+    EndRingIO();
+    LockedCheckRingClosed(nFD, bDirection == SOCKET_TRANSFER_RECV ? "recv" : "send");
+
+    if (i32RC == -ETIMEDOUT)
+        throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(bDirection == SOCKET_TRANSFER_RECV ? "recv" : "send") +
+                                                  ": " + std::to_string(LockedGetFD()) + " " + LockedGetLocalAddrString() + " timeout");
+    if (i32RC < 0)
+    {
+        errno = -i32RC;
+        return -1;
+    }
+    *pslen = msg.msg_namelen;
+    return i32RC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedRecv(string& strIPAddr, uint16_t& u16Port, uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    SocketAddress               addr;
+    uint32_t                    u32RC                   =   LockedRecv(addr, pu8Bytes, u32Bytes);
+    strIPAddr = addr.IPString();
+    u16Port = addr.GetDecodedPort();
+    return u32RC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the in_addr_t form of the batch calls - IPv6 peers read as address 0
+uint32_t
+libthrocket::UDPSocket::LockedRecvBatch
+(
+    uint8_t* const*             ppu8Bytes,
+    uint32_t*                   pu32Bytes,
+    in_addr_t*                  pinaIPAddr,
+    uint16_t*                   pu16Port,
+    uint32_t                    u32Count
+)
+{
+    if (pinaIPAddr == NULL && pu16Port == NULL)
+        return LockedRecvBatch(ppu8Bytes, pu32Bytes, (SocketAddress*) NULL, u32Count);
+
+    SocketAddress               aaddrLocal[SOCKET_MMSG_LOCAL];
+    std::vector<SocketAddress>  vecAddr;
+    SocketAddress*              paddr                   =   aaddrLocal;
+    if (u32Count > SOCKET_MMSG_LOCAL)
+    {
+        vecAddr.resize(u32Count);
+        paddr = &vecAddr[0];
+    }
+
+    uint32_t                    u32RC                   =   LockedRecvBatch(ppu8Bytes, pu32Bytes, paddr, u32Count);
+    for (uint32_t i = 0; i < u32RC; i++)
+    {
+        if (pinaIPAddr != NULL)
+        {
+            pinaIPAddr[i] = 0;
+            paddr[i].GetIPv4(pinaIPAddr[i]);
+        }
+        if (pu16Port != NULL)
+            pu16Port[i] = paddr[i].GetDecodedPort();
+    }
+    return u32RC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UDPSocket::LockedSendBatch
+(
+    const uint8_t* const*       ppu8Bytes,
+    const uint32_t*             pu32Bytes,
+    const in_addr_t*            pinaIPAddr,
+    const uint16_t*             pu16Port,
+    uint32_t                    u32Count
+)
+{
+    if (pinaIPAddr == NULL || pu16Port == NULL)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "u32Count " + std::to_string(u32Count));
+
+    SocketAddress               aaddrLocal[SOCKET_MMSG_LOCAL];
+    std::vector<SocketAddress>  vecAddr;
+    SocketAddress*              paddr                   =   aaddrLocal;
+    if (u32Count > SOCKET_MMSG_LOCAL)
+    {
+        vecAddr.resize(u32Count);
+        paddr = &vecAddr[0];
+    }
+
+    for (uint32_t i = 0; i < u32Count; i++)
+        paddr[i].Set(pinaIPAddr[i], pu16Port[i]);
+
+    return LockedSendBatch(ppu8Bytes, pu32Bytes, paddr, u32Count);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// one wait, then one recvmmsg() that returns as soon as at least one datagram is in hand; paddr may be NULL
+uint32_t
+libthrocket::UDPSocket::LockedRecvBatch
+(
+    uint8_t* const*             ppu8Bytes,
+    uint32_t*                   pu32Bytes,
+    SocketAddress*              paddr,
+    uint32_t                    u32Count
+)
+{
+    if (ppu8Bytes == NULL || pu32Bytes == NULL || u32Count < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "u32Count " + std::to_string(u32Count));
+
+    struct mmsghdr              ammsgLocal[SOCKET_MMSG_LOCAL];
+    struct iovec                aiovLocal[SOCKET_MMSG_LOCAL];
+    std::vector<struct mmsghdr> vecMMsg;
+    std::vector<struct iovec>   vecIOV;
+    struct mmsghdr*             pmmsg                   =   ammsgLocal;
+    struct iovec*               piov                    =   aiovLocal;
+    if (u32Count > SOCKET_MMSG_LOCAL)
+    {
+        vecMMsg.resize(u32Count);
+        vecIOV.resize(u32Count);
+        pmmsg = &vecMMsg[0];
+        piov  = &vecIOV[0];
+    }
+
+    for (uint32_t i = 0; i < u32Count; i++)
+    {
+        piov[i].iov_base = ppu8Bytes[i];
+        piov[i].iov_len  = pu32Bytes[i];
+        pmmsg[i].msg_hdr.msg_name       = paddr != NULL ? paddr[i].GetSockAddrBuffer() : NULL;
+        pmmsg[i].msg_hdr.msg_namelen    = paddr != NULL ? SocketAddress::GetCapacity() : 0;
+        pmmsg[i].msg_hdr.msg_iov        = &piov[i];
+        pmmsg[i].msg_hdr.msg_iovlen     = 1;
+        pmmsg[i].msg_hdr.msg_control    = NULL;
+        pmmsg[i].msg_hdr.msg_controllen = 0;
+        pmmsg[i].msg_hdr.msg_flags      = 0;
+        pmmsg[i].msg_len                = 0;
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> rcvm: %d (%21s) %u datagrams TO %ld uS",
+        LockedGetFD(), LockedGetLocalAddrString().c_str(), u32Count, LockedGetRecvTimeout());
+
+    int                         nRC                     =   -1;
+    if (m_bOptimisticIO)
+        nRC = recvmmsg(LockedGetFD(), pmmsg, u32Count, MSG_DONTWAIT, NULL);
+    if (m_bOptimisticIO == false || (nRC == -1 && (GetLastError() == EAGAIN || GetLastError() == EWOULDBLOCK)))
+    {
+        int64_t                 i64Now                  =   TimeuS64();
+        int64_t                 i64Expire               =   i64Now + m_i64RecvTimeout;
+        while (1)
+        {
+            LockedWait(true/*bWantRead*/, false/*bWantWrite*/, m_i64RecvTimeout > 0 ? i64Expire - i64Now : 0);
+
+            nRC = recvmmsg(LockedGetFD(), pmmsg, u32Count, MSG_WAITFORONE, NULL);
+            if (nRC != -1 || m_i64RecvTimeout < 1 || (GetLastError() != EAGAIN && GetLastError() != EWOULDBLOCK))
+                break;
+
+            // readable did not last (another reader took the datagram) - wait out the rest of the timeout, as
+            // LockedTransfer() does
+            i64Now = TimeuS64();
+            if (i64Now >= i64Expire)
+                throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "recvmmsg: " + std::to_string(LockedGetFD()) + " " +
+                                                        LockedGetLocalAddrString() + " timeout");
+        }
+    }
+    if (nRC == -1)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        if ((nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK) && m_i64RecvTimeout < 1)
+            throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "recvmmsg: " + std::to_string(LockedGetFD()) + " " +
+                                                      LockedGetLocalAddrString());
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "recvmmsg: " + std::to_string(LockedGetFD()) + " " +
+                                                  LockedGetLocalAddrString() + " " + std::to_string(nSaveErrno) +
+                                                  " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+    for (int i = 0; i < nRC; i++)
+    {
+        pu32Bytes[i] = pmmsg[i].msg_len;
+        if (paddr != NULL)
+            paddr[i].SetLength(pmmsg[i].msg_hdr.msg_namelen);
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> rcvm: %d (%21s) %d datagrams",
+        LockedGetFD(), LockedGetLocalAddrString().c_str(), nRC);
+
+    return (uint32_t) nRC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// keeps calling sendmmsg() until every datagram is out or the send timeout expires
+uint32_t
+libthrocket::UDPSocket::LockedSendBatch
+(
+    const uint8_t* const*       ppu8Bytes,
+    const uint32_t*             pu32Bytes,
+    const SocketAddress*        paddr,
+    uint32_t                    u32Count
+)
+{
+    if (ppu8Bytes == NULL || pu32Bytes == NULL || paddr == NULL || u32Count < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "u32Count " + std::to_string(u32Count));
+
+    struct mmsghdr              ammsgLocal[SOCKET_MMSG_LOCAL];
+    struct iovec                aiovLocal[SOCKET_MMSG_LOCAL];
+    std::vector<struct mmsghdr> vecMMsg;
+    std::vector<struct iovec>   vecIOV;
+    std::vector<SocketAddress>  vecMapped;
+    struct mmsghdr*             pmmsg                   =   ammsgLocal;
+    struct iovec*               piov                    =   aiovLocal;
+    if (u32Count > SOCKET_MMSG_LOCAL)
+    {
+        vecMMsg.resize(u32Count);
+        vecIOV.resize(u32Count);
+        pmmsg = &vecMMsg[0];
+        piov  = &vecIOV[0];
+    }
+
+    // an AF_INET6 socket only speaks IPv4 through mapped addresses
+    if (LockedGetFamily() == AF_INET6)
+    {
+        for (uint32_t i = 0; i < u32Count && vecMapped.empty(); i++)
+        {
+            if (paddr[i].GetFamily() != AF_INET)
+                continue;
+            vecMapped.resize(u32Count);
+            for (uint32_t j = 0; j < u32Count; j++)
+                vecMapped[j] = paddr[j].MapToIPv6();
+        }
+        if (vecMapped.size() > 0)
+            paddr = &vecMapped[0];
+    }
+
+    for (uint32_t i = 0; i < u32Count; i++)
+    {
+        piov[i].iov_base = (void*) ppu8Bytes[i];
+        piov[i].iov_len  = pu32Bytes[i];
+        pmmsg[i].msg_hdr.msg_name       = (void*) paddr[i].GetSockAddr();
+        pmmsg[i].msg_hdr.msg_namelen    = paddr[i].GetLength();
+        pmmsg[i].msg_hdr.msg_iov        = &piov[i];
+        pmmsg[i].msg_hdr.msg_iovlen     = 1;
+        pmmsg[i].msg_hdr.msg_control    = NULL;
+        pmmsg[i].msg_hdr.msg_controllen = 0;
+        pmmsg[i].msg_hdr.msg_flags      = 0;
+        pmmsg[i].msg_len                = 0;
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> sndm: %d %u datagrams TO %ld uS",
+        LockedGetFD(), u32Count, LockedGetSendTimeout());
+
+    uint32_t                    u32Sent                 =   0;
+    bool                        bTryFirst               =   m_bOptimisticIO;
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + m_i64SendTimeout;
+    while (u32Sent < u32Count)
+    {
+        if (bTryFirst == false)
+            LockedWait(false/*bWantRead*/, true/*bWantWrite*/, i64Expire - i64Now);
+
+        int                     nRC                     =   sendmmsg(LockedGetFD(), pmmsg + u32Sent, u32Count - u32Sent,
+                                                                     bTryFirst ? MSG_DONTWAIT : 0);
+        if (nRC == -1)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            if ((nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK) && bTryFirst)
+            {
+                bTryFirst = false;
+                continue;
+            }
+            if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            {
+                if (m_i64SendTimeout < 1 && u32Sent > 0)
+                    break;
+                if (m_i64SendTimeout < 1)
+                    throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "sendmmsg: " + std::to_string(LockedGetFD()));
+            } else
+            {
+                throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "sendmmsg: " + std::to_string(LockedGetFD()) + " " +
+                                                          paddr[u32Sent].AddrString() + " " +
+                                                          std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+            }
+        } else
+        {
+            u32Sent += nRC;
+        }
+        bTryFirst = false;
+
+        // with no timeout a short batch is reported rather than waited out
+        if (u32Sent >= u32Count || m_i64SendTimeout < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "sendmmsg: " + std::to_string(LockedGetFD()) + " " +
+                                                    std::to_string(u32Sent) + "/" + std::to_string(u32Count) + " timeout");
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UDP> sndm: %d %u datagrams",
+        LockedGetFD(), u32Sent);
+
+    return u32Sent;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UDPSocket::LockedBroadcast()
+{
+    int                         nEnabled                =   1;
+
+#ifdef WIN32
+
+    if (setsockopt(m_nSocket, SOL_SOCKET, SO_BROADCAST, (const char*) &nEnabled, sizeof (nEnabled)) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_BROADCAST " +
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+#else   // WIN32
+
+    if (setsockopt(m_nSocket, SOL_SOCKET, SO_BROADCAST, &nEnabled, sizeof (nEnabled)) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_BROADCAST " + 
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+#endif  // WIN32
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// MSG_ZEROCOPY bookkeeping - the kernel numbers each successful MSG_ZEROCOPY send call 0, 1, 2, ... and reports
+// completed [lo, hi] ranges of those numbers on the socket error queue
+namespace libthrocket
+{
+
+struct TCPZeroCopyState
+{
+    struct Pending
+    {
+        uint32_t                u32FirstID;
+        uint32_t                u32LastID;      // complete once u32DoneID passes this
+        uint64_t                u64Cookie;
+        bool                    bCopied;
+    };
+
+    TCPZeroCopyHandler        * pHandler;
+    uint32_t                    u32NextID;      // number the kernel gives the next MSG_ZEROCOPY send
+    uint32_t                    u32DoneID;      // every number below this has completed
+    std::deque<Pending>         dqPending;
+    std::map<uint32_t, uint32_t> mapEarly;      // out-of-order completed ranges, lo -> hi
+    std::vector<std::pair<uint64_t, bool> > vecDone;    // completed, not yet handed to pHandler
+};
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::TCPSocket::~TCPSocket()
+{
+    LockedCloseSplicePipe();
+    delete m_pZeroCopy;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPSocket::LockedNoNagle()
+{
+    int                         nEnabled                =   1;
+
+#ifdef WIN32
+
+    if (setsockopt(m_nSocket, IPPROTO_TCP, TCP_NODELAY, (const char*) &nEnabled, sizeof (nEnabled)) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " TCP_NODELAY " +
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+#else   // WIN32
+
+    if (setsockopt(m_nSocket, IPPROTO_TCP, TCP_NODELAY, &nEnabled, sizeof (nEnabled)) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " TCP_NODELAY " + 
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+#endif  // WIN32
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a kept-alive connection the server has since timed out reads as EOF (or an unsolicited 408) - catch it before we write
+bool
+libthrocket::TCPSocket::LockedIsStale()
+{
+    if (IsConnected() == false)
+        return true;
+
+    struct pollfd               pfd;
+    pfd.fd      = m_nSocket;
+    pfd.events  = POLLIN;
+    pfd.revents = 0;
+
+    int                         nRC                     =   poll(&pfd, 1, 0);
+    if (nRC == 0)
+        return false;
+    if (nRC < 0 || (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0)
+        return true;
+
+    uint8_t                     u8Peek;
+    ssize_t                     nPeek                   =   recv(m_nSocket, (char*) &u8Peek, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (nPeek < 0 && (GetLastError() == EAGAIN || GetLastError() == EWOULDBLOCK))
+        return false;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> stal: %d (%21s) %s",
+        LockedGetFD(), LockedGetPeerAddrString().c_str(), nPeek == 0 ? "peer closed" : "unsolicited data");
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+// false (addr empty) when there is no socket or it is not connected
+bool
+libthrocket::TCPSocket::LockedGetPeerAddress(SocketAddress& addr)
+{
+    socklen_t                   slen                    =   SocketAddress::GetCapacity();
+    addr.clear();
+    if (getpeername(m_nSocket, addr.GetSockAddrBuffer(), &slen) == -1)
+    {
+        addr.clear();
+        return false;
+    }
+    addr.SetLength(slen);
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::TCPSocket::LockedGetEncodedPeerIP()
+{
+    SocketAddress               addr;
+    in_addr_t                   inaIPAddr               =   0;
+    if (LockedGetPeerAddress(addr))
+        addr.GetIPv4(inaIPAddr);
+    return inaIPAddr;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint16_t
+libthrocket::TCPSocket::LockedGetDecodedPeerPort()
+{
+    SocketAddress               addr;
+    LockedGetPeerAddress(addr);
+    return addr.GetDecodedPort();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::TCPSocket::LockedGetPeerIPString()
+{
+    SocketAddress               addr;
+    LockedGetPeerAddress(addr);
+    return addr.IPString();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::TCPSocket::LockedGetPeerPortString()
+{
+    uint16_t                    u16Port                 =   LockedGetDecodedPeerPort();
+    string                      strPort                 =   std::to_string(u16Port);
+    return strPort;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::TCPSocket::LockedGetPeerAddrString()
+{
+    SocketAddress               addr;
+    LockedGetPeerAddress(addr);
+    return addr.AddrString();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPSocket::LockedConnect
+(
+    const string&               strIPAddr,
+    uint16_t                    u16Port
+)
+{
+    SocketAddress               addr;
+    if (addr.Parse(strIPAddr, u16Port) == false)
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + AddrString(strIPAddr, u16Port) +
+                                                      " not an IP address");
+
+    LockedConnect(addr);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPSocket::LockedConnect(const SocketAddress& addr)
+{
+    if (m_nSocket != INVALID_SOCKET)
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "m_nSocket != INVALID_SOCKET");
+    if (addr.IsValid() == false)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "connect: no address family");
+
+    m_nFamily = addr.GetFamily();
+    // close-on-exec, like the sockets the address-list connect tries
+    LockedSetFD(socket(m_nFamily == AF_INET6 ? PF_INET6 : PF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (m_nSocket == INVALID_SOCKET)
+    {
+        int                     nSaveErrno;
+        nSaveErrno = GetLastError();
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "socket: " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+    try
+    {
+        LockedSetNonBlocking();
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> conn: %d (%21s)", 
+        LockedGetFD(), addr.AddrString().c_str());
+
+    // connect holds the socket lock while it waits, as the poll() path does
+    if (LockedUseIOEngine(IORING_OP_CONNECT, m_i64SendTimeout))
+    {
+        int32_t                 i32RC                   =   m_pIOEngine->Connect(m_nSocket, m_nIOFixedSlot, addr.GetSockAddr(),
+                                                                                 addr.GetLength(), m_i64SendTimeout);
+        if (i32RC < 0)
+            throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + std::to_string(-i32RC) +
+                                                          " (" + SocketErrorString(-i32RC) + ")");
+        m_bConnected = true;
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "TCP> conn: %d (%21s) success io_uring",
+            LockedGetFD(), LockedGetPeerAddrString().c_str());
+        return;
+    }
+
+    if (connect(m_nSocket, addr.GetSockAddr(), addr.GetLength()) == SOCKET_ERROR)
+    {
+        int                     nSaveErrno;
+        nSaveErrno = GetLastError();
+        if (nSaveErrno != EINPROGRESS)
+            throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + std::to_string(nSaveErrno) +
+                                                          " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+    // non-blocking async connect completion
+    try
+    {
+        Select(false/*bWantRead*/, true/*bWantWrite*/, m_i64SendTimeout);
+        m_bConnected = true;
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        // just throw?
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> conn: %d (%21s) success", 
+        LockedGetFD(), LockedGetPeerAddrString().c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// happy eyeballs (RFC 8305) - a dead IPv6 route costs one attempt delay rather than a whole connect timeout
+void
+libthrocket::TCPSocket::LockedConnect(const std::vector<SocketAddress>& vecAddrs, int64_t i64AttemptDelay)
+{
+    if (m_nSocket != INVALID_SOCKET)
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "m_nSocket != INVALID_SOCKET");
+    if (vecAddrs.size() < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "connect: no addresses");
+
+    // alternate the families, starting with whichever the caller listed first
+    std::vector<const SocketAddress*> vecFirst;
+    std::vector<const SocketAddress*> vecSecond;
+    std::vector<const SocketAddress*> vecOrder;
+    for (size_t i = 0; i < vecAddrs.size(); i++)
+    {
+        if (vecAddrs[i].IsValid() == false)
+            throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "connect: no address family");
+        if (vecAddrs[i].GetFamily() == vecAddrs[0].GetFamily())
+            vecFirst.push_back(&vecAddrs[i]);
+        else
+            vecSecond.push_back(&vecAddrs[i]);
+    }
+    for (size_t i = 0; i < vecFirst.size() || i < vecSecond.size(); i++)
+    {
+        if (i < vecFirst.size())
+            vecOrder.push_back(vecFirst[i]);
+        if (i < vecSecond.size())
+            vecOrder.push_back(vecSecond[i]);
+    }
+
+    std::vector<struct pollfd>  vecPoll;                // attempts in progress
+    std::vector<const SocketAddress*> vecPending;       // ... and where each is going
+    size_t                      uNext                   =   0;
+    int                         nWinner                 =   INVALID_SOCKET;
+    const SocketAddress       * paddrWinner             =   NULL;
+    int                         nLastErrno              =   0;
+    string                      strLastAddr;
+    int64_t                     i64Now                  =   TimeuS64();
+    // no send timeout means no deadline, as for a single address - only the attempt delay bounds each poll()
+    bool                        bExpire                 =   m_i64SendTimeout > 0;
+    int64_t                     i64Expire               =   i64Now + m_i64SendTimeout;
+    int64_t                     i64NextAttempt          =   i64Now;
+
+    try
+    {
+        while (nWinner == INVALID_SOCKET)
+        {
+            // the next address goes when its turn comes round, or at once when nothing is left in progress
+            if (uNext < vecOrder.size() && (i64Now >= i64NextAttempt || vecPoll.empty()))
+            {
+                const SocketAddress * paddr             =   vecOrder[uNext++];
+                int             nFD                     =   socket(paddr->GetFamily() == AF_INET6 ? PF_INET6 : PF_INET,
+                                                                   SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+                int             nRC                     =   nFD == INVALID_SOCKET ? SOCKET_ERROR :
+                                                            connect(nFD, paddr->GetSockAddr(), paddr->GetLength());
+                if (nRC == 0)
+                {
+                    nWinner = nFD;
+                    paddrWinner = paddr;
+                    break;
+                }
+                if (nFD == INVALID_SOCKET || GetLastError() != EINPROGRESS)
+                {
+                    nLastErrno = GetLastError();
+                    strLastAddr = paddr->AddrString();
+                    if (nFD != INVALID_SOCKET)
+                        closesocket(nFD);
+                    continue;
+                }
+
+                struct pollfd   pfd;
+                pfd.fd      = nFD;
+                pfd.events  = POLLOUT;
+                pfd.revents = 0;
+                vecPoll.push_back(pfd);
+                vecPending.push_back(paddr);
+                i64NextAttempt = i64Now + i64AttemptDelay;
+
+                LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                    "TCP> conn: %d (%21s) attempt %zu/%zu",
+                    nFD, paddr->AddrString().c_str(), uNext, vecOrder.size());
+            }
+
+            if (vecPoll.empty())
+                throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + strLastAddr + " " +
+                                                              std::to_string(nLastErrno) + " (" + SocketErrorString(nLastErrno) + ")");
+            if (bExpire && i64Now >= i64Expire)
+                throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + vecPending[0]->AddrString() + " " +
+                                                              std::to_string(vecOrder.size()) + " addresses timeout");
+
+            // -1 - nothing to wait for but the attempts in progress
+            int64_t             i64Wait                 =   bExpire ? i64Expire - i64Now : -1;
+            if (uNext < vecOrder.size() && (i64Wait < 0 || i64NextAttempt - i64Now < i64Wait))
+                i64Wait = i64NextAttempt > i64Now ? i64NextAttempt - i64Now : 0;
+
+            // clamped, as in Reactor::Poll() - a wait too long for an int must not wrap to a negative "forever"
+            int                 nRC                     =   poll(&vecPoll[0], vecPoll.size(),
+                                                                 i64Wait < 0 ? -1 :
+                                                                 i64Wait >= (int64_t) INT_MAX * 1000 ? INT_MAX :
+                                                                 (int) ((i64Wait + 999) / 1000));
+            if (nRC == -1 && GetLastError() != EINTR)
+            {
+                int             nSaveErrno              =   GetLastError();
+                throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "poll: " + std::to_string(nSaveErrno) +
+                                                          " (" + SocketErrorString(nSaveErrno) + ")");
+            }
+
+            for (size_t i = 0; nRC > 0 && i < vecPoll.size(); )
+            {
+                if (vecPoll[i].revents == 0)
+                {
+                    i++;
+                    continue;
+                }
+
+                int             nError                  =   0;
+                socklen_t       slen                    =   sizeof(nError);
+                if (getsockopt(vecPoll[i].fd, SOL_SOCKET, SO_ERROR, &nError, &slen) != 0)
+                    nError = GetLastError();
+                if (nError == 0)
+                {
+                    nWinner = vecPoll[i].fd;
+                    paddrWinner = vecPending[i];
+                }
+                else
+                {
+                    nLastErrno = nError;
+                    strLastAddr = vecPending[i]->AddrString();
+                    closesocket(vecPoll[i].fd);
+                    // a refusal lets the next address go now rather than wait out its turn
+                    i64NextAttempt = 0;
+                }
+                vecPoll.erase(vecPoll.begin() + i);
+                vecPending.erase(vecPending.begin() + i);
+                if (nWinner != INVALID_SOCKET)
+                    break;
+            }
+
+            i64Now = TimeuS64();
+        }
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        for (size_t i = 0; i < vecPoll.size(); i++)
+            closesocket(vecPoll[i].fd);
+        throw;
+    }
+
+    // the losers
+    for (size_t i = 0; i < vecPoll.size(); i++)
+        closesocket(vecPoll[i].fd);
+
+    LockedSetFD(nWinner);
+    m_nFamily = paddrWinner->GetFamily();
+    LockedSetNonBlocking();
+    m_bConnected = true;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> conn: %d (%21s) success happy eyeballs",
+        LockedGetFD(), LockedGetPeerAddrString().c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::TCPSocket::LockedTransfer(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort)
+{
+    int                         nRC                     =   0;
+    const char*                 pcFunc                  =   NULL;
+    tTransferProc               pfFunc                  =   NULL;
+    bool                        bWantRead               =   false;
+    bool                        bWantWrite              =   false;
+    uint32_t                    u32BytesTransferred     =   0;
+    bool                        bTryFirst               =   m_bOptimisticIO;
+    int64_t                     i64Now;
+    int64_t                     i64Timeout;
+    int64_t                     i64Expire;
+
+    if (bDirection == SOCKET_TRANSFER_SEND)
+    {
+        pcFunc = (const char*) "send";
+        pfFunc = (tTransferProc) send;
+        bWantRead  = false;
+        bWantWrite = true;
+        i64Timeout = LockedGetSendTimeout();
+
+    } else if (bDirection == SOCKET_TRANSFER_RECV)
+    {
+        pcFunc = (const char*) "recv";
+        pfFunc = (tTransferProc) recv;
+        bWantRead  = true;
+        bWantWrite = false;
+        i64Timeout = LockedGetRecvTimeout();
+
+    } else
+    {
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "invalid transfer type");
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> %s: %d (%21s) %u bytes TO %ld uS", 
+        pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), u32Bytes, i64Timeout);
+
+    if (LockedUseIOEngine(bDirection == SOCKET_TRANSFER_RECV ? IORING_OP_RECV : IORING_OP_SEND, i64Timeout))
+        return LockedTransferIOEngine(bDirection, pu8Bytes, u32Bytes, bShort, -1);
+
+    i64Now = TimeuS64();
+    i64Expire = i64Now + i64Timeout;
+    while (1)
+    {
+        #ifdef WIN32
+        #else   // WIN32
+            if (bDirection == SOCKET_TRANSFER_RECV && WOULDDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH) != false)
+            {
+                int                 nCount;
+                if (ioctl(LockedGetFD(), FIONREAD, &nCount) == 0)
+                {
+                    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                        "TCP> recv: %d (%21s) FIONREAD %d", 
+                        LockedGetFD(), LockedGetPeerAddrString().c_str(), nCount);
+                }
+            }
+        #endif
+
+        if (bTryFirst == false)
+            LockedWait(bWantRead, bWantWrite, i64Expire - i64Now);
+
+        nRC = pfFunc(LockedGetFD(), pu8Bytes, u32Bytes, bTryFirst ? MSG_DONTWAIT : 0);
+
+        if (nRC == 0)
+        {
+            break;
+
+        } else if (nRC < 1)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            if ((nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK) && bTryFirst)
+            {
+                // nothing buffered after all - fall back to waiting
+                bTryFirst = false;
+                continue;
+            }
+            if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            {
+                // a zero timeout on a non-blocking socket (e.g. one driven by a Reactor) reports what moved so far
+                if (i64Timeout < 1 && u32BytesTransferred > 0)
+                    break;
+                if (i64Timeout < 1)
+                    throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString());
+                // spurious readiness - wait again if there is time left
+                i64Now = TimeuS64();
+                if (i64Now >= i64Expire)
+                    throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString() + " timeout");
+                continue;
+            }
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " + 
+                                                      LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+
+        } else
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "TCP> %s: %d (%21s) %d bytes", 
+                pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), nRC);
+            u32Bytes            -=  nRC;
+            u32BytesTransferred +=  nRC;
+            pu8Bytes            +=  nRC;
+        }
+        // after a partial transfer the remainder is unlikely to be ready yet
+        bTryFirst = false;
+
+        if (bShort || u32Bytes < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " + 
+                                                    LockedGetPeerAddrString() + " timeout");
+    }
+
+    return u32BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// LockedTransfer() through the ring - the ring does the waiting, so there is no poll() and no EAGAIN round trip
+uint32_t
+libthrocket::TCPSocket::LockedTransferIOEngine(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort, int32_t i32BufIndex)
+{
+    const char*                 pcFunc                  =   bDirection == SOCKET_TRANSFER_RECV ? "recv" : "send";
+    int64_t                     i64Timeout              =   bDirection == SOCKET_TRANSFER_RECV ? LockedGetRecvTimeout() :
+                                                                                                 LockedGetSendTimeout();
+    IOUringEngine             * pEngine                 =   m_pIOEngine;
+    int                         nFD                     =   m_nSocket;
+    int                         nFixedSlot              =   m_nIOFixedSlot;
+    uint32_t                    u32BytesTransferred     =   0;
+    int64_t                     i64Expire               =   TimeuS64() + i64Timeout;
+
+    while (u32Bytes > 0)
+    {
+        int64_t                 i64Remain               =   i64Expire - TimeuS64();
+        int32_t                 i32RC;
+
+        if (i64Remain < 1)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(nFD) + " " +
+                                                    LockedGetPeerAddrString() + " timeout");
+
+        // like LockedWait(), do not block other threads while the ring waits
+        LockedBeginRingIO();
+        try
+        {
+            if (i32BufIndex < 0 && bDirection == SOCKET_TRANSFER_RECV)
+                i32RC = pEngine->Recv(nFD, nFixedSlot, pu8Bytes, u32Bytes, i64Remain);
+            else if (i32BufIndex < 0)
+                i32RC = pEngine->Send(nFD, nFixedSlot, pu8Bytes, u32Bytes, i64Remain);
+            else if (bDirection == SOCKET_TRANSFER_RECV)
+                i32RC = pEngine->ReadFixed(nFD, nFixedSlot, pu8Bytes, u32Bytes, (uint16_t) i32BufIndex, i64Remain);
+            else
+                i32RC = pEngine->WriteFixed(nFD, nFixedSlot, pu8Bytes, u32Bytes, (uint16_t) i32BufIndex, i64Remain);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            EndRingIO();
+            throw;
+        }
+        EndRingIO();
+        LockedCheckRingClosed(nFD, pcFunc);
+
+        if (i32RC == 0)
+            break;
+        if (i32RC == -ETIMEDOUT)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(nFD) + " " +
+                                                    LockedGetPeerAddrString() + " timeout");
+        if (i32RC < 0)
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(nFD) + " " +
+                                                      LockedGetPeerAddrString() + " " + std::to_string(-i32RC) +
+                                                      " (" + SocketErrorString(-i32RC) + ")");
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "TCP> %s: %d (%21s) %d bytes io_uring",
+            pcFunc, nFD, LockedGetPeerAddrString().c_str(), i32RC);
+        u32Bytes            -=  i32RC;
+        u32BytesTransferred +=  i32RC;
+        pu8Bytes            +=  i32RC;
+
+        if (bShort)
+            break;
+    }
+
+    return u32BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::TCPSocket::LockedTransferFixed(bool bDirection, uint16_t u16BufIndex, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort)
+{
+    int64_t                     i64Timeout              =   bDirection == SOCKET_TRANSFER_RECV ? LockedGetRecvTimeout() :
+                                                                                                 LockedGetSendTimeout();
+
+    if (LockedUseIOEngine(bDirection == SOCKET_TRANSFER_RECV ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED, i64Timeout))
+        return LockedTransferIOEngine(bDirection, pu8Bytes, u32Bytes, bShort, u16BufIndex);
+
+    return LockedTransfer(bDirection, pu8Bytes, u32Bytes, bShort);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// scatter/gather counterpart of LockedTransfer - the caller's iovec list is not modified
+uint32_t
+libthrocket::TCPSocket::LockedTransferV(bool bDirection, const struct iovec* piov, int nIOV, bool bShort)
+{
+    ssize_t                     nRC                     =   0;
+    const char*                 pcFunc                  =   NULL;
+    bool                        bWantRead               =   false;
+    bool                        bWantWrite              =   false;
+    uint64_t                    u64Bytes                =   0;
+    uint32_t                    u32BytesTransferred     =   0;
+    bool                        bTryFirst               =   m_bOptimisticIO;
+    int64_t                     i64Now;
+    int64_t                     i64Timeout;
+    int64_t                     i64Expire;
+
+    if (bDirection == SOCKET_TRANSFER_SEND)
+    {
+        pcFunc = (const char*) "sendmsg";
+        bWantRead  = false;
+        bWantWrite = true;
+        i64Timeout = LockedGetSendTimeout();
+
+    } else if (bDirection == SOCKET_TRANSFER_RECV)
+    {
+        pcFunc = (const char*) "recvmsg";
+        bWantRead  = true;
+        bWantWrite = false;
+        i64Timeout = LockedGetRecvTimeout();
+
+    } else
+    {
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "invalid transfer type");
+    }
+
+    if (piov == NULL || nIOV < 1 || nIOV > IOV_MAX)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "nIOV " + std::to_string(nIOV));
+
+    // work on a copy so partial transfers can advance through the list
+    struct iovec                aiovLocal[SOCKET_IOV_LOCAL];
+    std::vector<struct iovec>   vecIOV;
+    struct iovec*               piovWork                =   aiovLocal;
+    if (nIOV > SOCKET_IOV_LOCAL)
+    {
+        vecIOV.resize(nIOV);
+        piovWork = &vecIOV[0];
+    }
+    for (int i = 0; i < nIOV; i++)
+    {
+        piovWork[i] = piov[i];
+        u64Bytes += piov[i].iov_len;
+    }
+    if (u64Bytes > UINT32_MAX)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "bytes " + std::to_string(u64Bytes));
+
+    struct msghdr               msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov     = piovWork;
+    msg.msg_iovlen  = nIOV;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> %s: %d (%21s) %lu bytes in %d TO %ld uS",
+        pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), u64Bytes, nIOV, i64Timeout);
+
+    i64Now = TimeuS64();
+    i64Expire = i64Now + i64Timeout;
+    while (u64Bytes > 0)
+    {
+        if (bTryFirst == false)
+            LockedWait(bWantRead, bWantWrite, i64Expire - i64Now);
+
+        if (bDirection == SOCKET_TRANSFER_SEND)
+            nRC = sendmsg(LockedGetFD(), &msg, bTryFirst ? MSG_DONTWAIT : 0);
+        else
+            nRC = recvmsg(LockedGetFD(), &msg, bTryFirst ? MSG_DONTWAIT : 0);
+
+        if (nRC == 0)
+        {
+            break;
+
+        } else if (nRC < 1)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            if ((nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK) && bTryFirst)
+            {
+                bTryFirst = false;
+                continue;
+            }
+            if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            {
+                if (i64Timeout < 1 && u32BytesTransferred > 0)
+                    break;
+                if (i64Timeout < 1)
+                    throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString());
+                i64Now = TimeuS64();
+                if (i64Now >= i64Expire)
+                    throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString() + " timeout");
+                continue;
+            }
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " +
+                                                      LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+
+        } else
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "TCP> %s: %d (%21s) %zd bytes",
+                pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), nRC);
+            u64Bytes            -=  nRC;
+            u32BytesTransferred +=  nRC;
+
+            // step over whatever has been fully transferred
+            size_t              uDone                   =   nRC;
+            while (msg.msg_iovlen > 0 && uDone >= msg.msg_iov->iov_len)
+            {
+                uDone -= msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            }
+            if (uDone > 0)
+            {
+                msg.msg_iov->iov_base  = (uint8_t*) msg.msg_iov->iov_base + uDone;
+                msg.msg_iov->iov_len  -= uDone;
+            }
+        }
+        bTryFirst = false;
+
+        if (bShort || u64Bytes < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " +
+                                                    LockedGetPeerAddrString() + " timeout");
+    }
+
+    return u32BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::TCPSocket::LockedRecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    uint32_t                    u32BytesRecvd           =   0;
+    uint32_t                    u32BytesTotal           =   0;
+
+    while (u32Bytes > 0)
+    {
+        u32BytesRecvd = LockedTransfer(SOCKET_TRANSFER_RECV, pu8Bytes, u32Bytes, false/*bShort*/);
+        if (u32BytesRecvd == 0)
+            break;
+        pu8Bytes      += u32BytesRecvd;
+        u32Bytes      -= u32BytesRecvd;
+        u32BytesTotal += u32BytesRecvd;
+    }
+
+    return u32BytesTotal;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the bytes land in the buffer that is handed on - the receive is the only copy they ever see in user space
+libthrocket::SharedBuffer
+libthrocket::TCPSocket::LockedRecvShared(uint32_t u32Bytes, bool bShort)
+{
+    SharedBuffer                buf                     =   SharedBuffer::Allocate(u32Bytes);
+    uint32_t                    u32BytesRecvd           =   LockedTransfer(SOCKET_TRANSFER_RECV, buf.GetWritable(), u32Bytes, bShort);
+
+    if (u32BytesRecvd == 0)
+        return SharedBuffer();
+    buf.SetLength(u32BytesRecvd);
+    return buf;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the kernel moves page-cache pages straight to the socket - no user-space copy
+uint64_t
+libthrocket::TCPSocket::LockedSendFile(int nFileFD, off_t offOffset, uint64_t u64Bytes)
+{
+    uint64_t                    u64BytesTransferred     =   0;
+    int64_t                     i64Timeout              =   LockedGetSendTimeout();
+    int64_t                     i64Now;
+    int64_t                     i64Expire;
+
+    if (nFileFD < 0)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "nFileFD " + std::to_string(nFileFD));
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> sndf: %d (%21s) fd %d @ %ld %lu bytes TO %ld uS",
+        LockedGetFD(), LockedGetPeerAddrString().c_str(), nFileFD, (long) offOffset, u64Bytes, i64Timeout);
+
+    i64Now = TimeuS64();
+    i64Expire = i64Now + i64Timeout;
+    while (u64Bytes > 0)
+    {
+        LockedWait(false/*bWantRead*/, true/*bWantWrite*/, i64Expire - i64Now);
+
+        size_t                  uChunk                  =   u64Bytes < SOCKET_SPLICE_CHUNK ? u64Bytes : SOCKET_SPLICE_CHUNK;
+        ssize_t                 nRC                     =   sendfile(LockedGetFD(), nFileFD, &offOffset, uChunk);
+
+        if (nRC == 0)
+        {
+            // the file is shorter than asked for
+            break;
+
+        } else if (nRC < 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            {
+                if (i64Timeout < 1 && u64BytesTransferred > 0)
+                    break;
+                if (i64Timeout < 1)
+                    throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "sendfile " + std::to_string(LockedGetFD()) +
+                                                      " " + LockedGetPeerAddrString());
+            } else
+            {
+                throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "sendfile " + std::to_string(LockedGetFD()) + " " +
+                                                          LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                          " (" + SocketErrorString(nSaveErrno) + ")");
+            }
+
+        } else
+        {
+            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+                "TCP> sndf: %d (%21s) %zd bytes",
+                LockedGetFD(), LockedGetPeerAddrString().c_str(), nRC);
+            u64Bytes            -=  nRC;
+            u64BytesTransferred +=  nRC;
+        }
+
+        if (u64Bytes < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "sendfile " + std::to_string(LockedGetFD()) + " " +
+                                                    LockedGetPeerAddrString() + " timeout");
+    }
+
+    return u64BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPSocket::LockedCloseSplicePipe()
+{
+    if (m_anSplicePipe[0] != -1)
+        close(m_anSplicePipe[0]);
+    if (m_anSplicePipe[1] != -1)
+        close(m_anSplicePipe[1]);
+    m_anSplicePipe[0] = m_anSplicePipe[1] = -1;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// proxy sockFrom -> this through a kernel pipe - the payload never enters user space
+// sockFrom reads honor its receive timeout, writes to this socket honor our send timeout
+uint64_t
+libthrocket::TCPSocket::LockedSplice(TCPSocket & sockFrom, int nFromFD, int64_t i64RecvTimeout, uint64_t u64Bytes, bool bShort)
+{
+    if (&sockFrom == this)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "splice to self");
+
+    if (m_anSplicePipe[0] == -1)
+    {
+        if (pipe2(m_anSplicePipe, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            m_anSplicePipe[0] = m_anSplicePipe[1] = -1;
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "pipe2 " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+    }
+
+    uint64_t                    u64BytesTransferred     =   0;
+    size_t                      uInPipe                 =   0;
+    int64_t                     i64SendTimeout          =   LockedGetSendTimeout();
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64RecvExpire           =   i64Now + i64RecvTimeout;
+    int64_t                     i64SendExpire           =   i64Now + i64SendTimeout;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> splc: %d -> %d (%21s) %lu bytes",
+        nFromFD, LockedGetFD(), LockedGetPeerAddrString().c_str(), u64Bytes);
+
+    try
+    {
+        while (u64Bytes > 0 || uInPipe > 0)
+        {
+            // fill the pipe from the source socket
+            if (u64Bytes > 0 && uInPipe == 0)
+            {
+                // SPLICE_F_NONBLOCK only covers the pipe - a blocking source socket would still block splice() with our
+                // lock held, so it is only called once the source polls readable
+                bool            bReady                  =   true;
+                if (i64RecvTimeout > 0)
+                {
+                    // do not hold our lock while blocked on the other socket
+                    m_CSLocal.unlock();
+                    try
+                    {
+                        sockFrom.Wait(true/*bWantRead*/, false/*bWantWrite*/, i64RecvExpire - i64Now);
+                    }
+                    catch (const libthrocket::Exception & e)
+                    {
+                        m_CSLocal.lock();
+                        throw;
+                    }
+                    m_CSLocal.lock();
+
+                } else
+                {
+                    struct pollfd   pfd;
+                    pfd.fd      = nFromFD;
+                    pfd.events  = POLLIN;
+                    pfd.revents = 0;
+                    bReady = poll(&pfd, 1, 0) > 0;
+                }
+
+                size_t          uChunk                  =   u64Bytes < SOCKET_SPLICE_CHUNK ? u64Bytes : SOCKET_SPLICE_CHUNK;
+                ssize_t         nRC                     =   -1;
+                int             nSaveErrno              =   EAGAIN;
+                if (bReady)
+                {
+                    nRC = splice(nFromFD, NULL, m_anSplicePipe[1], NULL, uChunk, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                    nSaveErrno = GetLastError();
+                }
+
+                if (nRC == 0)
+                {
+                    // source EOF
+                    break;
+
+                } else if (nRC < 0)
+                {
+                    if (nSaveErrno != EAGAIN && nSaveErrno != EWOULDBLOCK && nSaveErrno != EINTR)
+                        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "splice in " + std::to_string(nFromFD) + " " +
+                                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+                    if (i64RecvTimeout < 1 && u64BytesTransferred > 0)
+                        break;
+                    if (i64RecvTimeout < 1)
+                        throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "splice in " + std::to_string(nFromFD));
+
+                    // readable did not last (another reader, a spurious wakeup) - wait again: a short return of 0 here
+                    // would read as EOF
+                    i64Now = TimeuS64();
+                    if (i64Now >= i64RecvExpire)
+                        throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "splice in " + std::to_string(nFromFD) +
+                                                                  " timeout");
+                    continue;
+
+                } else
+                {
+                    uInPipe  += nRC;
+                    u64Bytes -= nRC;
+                }
+            }
+
+            // drain the pipe into this socket
+            while (uInPipe > 0)
+            {
+                LockedWait(false/*bWantRead*/, true/*bWantWrite*/, i64SendTimeout > 0 ? i64SendExpire - i64Now : 0);
+
+                ssize_t         nRC                     =   splice(m_anSplicePipe[0], NULL, LockedGetFD(), NULL, uInPipe,
+                                                                   SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+                if (nRC < 0)
+                {
+                    int         nSaveErrno              =   GetLastError();
+                    if (nSaveErrno != EAGAIN && nSaveErrno != EWOULDBLOCK)
+                        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "splice out " + std::to_string(LockedGetFD()) + " " +
+                                                                  LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                                  " (" + SocketErrorString(nSaveErrno) + ")");
+                    // bytes already pulled off the source cannot be handed back, so wait them out even with no timeout -
+                    // in poll() and without our lock, as LockedWait() would, rather than spinning on EAGAIN
+                    if (i64SendTimeout < 1)
+                    {
+                        struct pollfd   pfd;
+                        pfd.fd      = LockedGetFD();
+                        pfd.events  = POLLOUT;
+                        pfd.revents = 0;
+                        m_CSLocal.unlock();
+                        int     nPoll                   =   poll(&pfd, 1, -1);
+                        nSaveErrno = GetLastError();
+                        m_CSLocal.lock();
+                        if (nPoll < 0 && nSaveErrno != EINTR)
+                            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "splice out poll " + std::to_string(pfd.fd) +
+                                                                      " " + std::to_string(nSaveErrno) + " (" +
+                                                                      SocketErrorString(nSaveErrno) + ")");
+                    }
+                } else
+                {
+                    uInPipe             -=  nRC;
+                    u64BytesTransferred +=  nRC;
+                }
+
+                i64Now = TimeuS64();
+                if (uInPipe > 0 && i64SendTimeout > 0 && i64Now >= i64SendExpire)
+                    throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "splice out " + std::to_string(LockedGetFD()) + " " +
+                                                            LockedGetPeerAddrString() + " timeout");
+            }
+
+            if (bShort)
+                break;
+
+            i64Now = TimeuS64();
+            if (u64Bytes > 0 && i64RecvTimeout > 0 && i64Now >= i64RecvExpire)
+                throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "splice in " + std::to_string(nFromFD) + " timeout");
+        }
     }
     catch (const libthrocket::Exception & e)
     {
-        // just throw?
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+        // anything stranded in the pipe belongs to a dead transfer
+        if (uInPipe > 0)
+            LockedCloseSplicePipe();
+        throw;
     }
 
     LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "TCP> conn: %d (%21s) success", 
-        LockedGetFD(), LockedGetPeerAddrString().c_str());
+        "TCP> splc: %d -> %d (%21s) %lu bytes done",
+        nFromFD, LockedGetFD(), LockedGetPeerAddrString().c_str(), u64BytesTransferred);
+
+    return u64BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// serial number comparison - the kernel's counter wraps
+static inline bool ZeroCopyBefore(uint32_t u32A, uint32_t u32B)
+{
+    return (int32_t) (u32A - u32B) < 0;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPSocket::LockedSetZeroCopy(TCPZeroCopyHandler * pHandler)
+{
+    #ifdef WIN32
+
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "LockedSetZeroCopy not implemented on WIN32");
+
+    #else   // WIN32
+
+        if (pHandler == NULL)
+        {
+            if (m_pZeroCopy == NULL)
+                return;
+            if (m_pZeroCopy->dqPending.size() > 0 || m_pZeroCopy->vecDone.size() > 0)
+                throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "zero-copy sends still pending " +
+                                                    std::to_string(m_pZeroCopy->dqPending.size()));
+            delete m_pZeroCopy;
+            m_pZeroCopy = NULL;
+            return;
+        }
+
+        if (m_pZeroCopy != NULL)
+        {
+            m_pZeroCopy->pHandler = pHandler;
+            return;
+        }
+
+        LockedOpen();
+
+        int                     nEnabled                =   1;
+        if (setsockopt(m_nSocket, SOL_SOCKET, SO_ZEROCOPY, &nEnabled, sizeof(nEnabled)) != 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " SO_ZEROCOPY " +
+                                    std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+
+        m_pZeroCopy = new TCPZeroCopyState;
+        m_pZeroCopy->pHandler = pHandler;
+        m_pZeroCopy->u32NextID = 0;
+        m_pZeroCopy->u32DoneID = 0;
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "TCP>       %d (%21s) zero-copy",
+            LockedGetFD(), LockedGetPeerAddrString().c_str());
+    #endif  // WIN32
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the buffer belongs to the kernel until its completion is reaped - even if we throw after part of it went out
+uint32_t
+libthrocket::TCPSocket::LockedSendZeroCopy(const uint8_t* pu8Bytes, uint32_t u32Bytes, uint64_t u64Cookie)
+{
+    if (m_pZeroCopy == NULL)
+        throw libthrocket::SocketInitException(LIBTHROCKET_THROWN_BY, "zero-copy not enabled");
+
+    TCPZeroCopyState::Pending   pending;
+    pending.u32FirstID  = m_pZeroCopy->u32NextID;
+    pending.u64Cookie   = u64Cookie;
+    pending.bCopied     = false;
+
+    uint32_t                    u32BytesTransferred     =   0;
+
+    if (u32Bytes < SOCKET_ZEROCOPY_MIN)
+    {
+        // completes as soon as everything sent before it has
+        LockedReapZeroCopy(0);
+        u32BytesTransferred = LockedTransfer(SOCKET_TRANSFER_SEND, (uint8_t*) pu8Bytes, u32Bytes, false/*bShort*/);
+        pending.u32LastID   = m_pZeroCopy->u32NextID - 1;
+        pending.bCopied     = true;
+        m_pZeroCopy->dqPending.push_back(pending);
+        LockedReapZeroCopy(0);
+        return u32BytesTransferred;
+    }
+
+    int64_t                     i64Timeout              =   LockedGetSendTimeout();
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64Timeout;
+    int                         nFlags                  =   MSG_ZEROCOPY;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "TCP> zsnd: %d (%21s) %u bytes cookie %lu TO %ld uS",
+        LockedGetFD(), LockedGetPeerAddrString().c_str(), u32Bytes, u64Cookie, i64Timeout);
+
+    try
+    {
+        while (u32BytesTransferred < u32Bytes)
+        {
+            LockedWait(false/*bWantRead*/, true/*bWantWrite*/, i64Timeout > 0 ? i64Expire - i64Now : 0);
+
+            ssize_t             nRC                     =   send(LockedGetFD(), pu8Bytes + u32BytesTransferred,
+                                                                 u32Bytes - u32BytesTransferred, nFlags);
+            if (nRC < 0)
+            {
+                int             nSaveErrno              =   GetLastError();
+                if (nSaveErrno == ENOBUFS && nFlags != 0)
+                {
+                    // out of optmem for notifications - copy the rest
+                    LOGWARNING("TCP> zsnd: %d (%21s) ENOBUFS - copying", LockedGetFD(), LockedGetPeerAddrString().c_str());
+                    nFlags = 0;
+                    pending.bCopied = true;
+                    continue;
+                } else if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+                {
+                    if (i64Timeout < 1 && u32BytesTransferred > 0)
+                        break;
+                    if (i64Timeout < 1)
+                        throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "send " + std::to_string(LockedGetFD()) +
+                                                          " " + LockedGetPeerAddrString());
+                } else
+                {
+                    throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "send " + std::to_string(LockedGetFD()) + " " +
+                                                              LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                              " (" + SocketErrorString(nSaveErrno) + ")");
+                }
+            } else
+            {
+                if (nFlags != 0 && nRC > 0)
+                    m_pZeroCopy->u32NextID++;
+                u32BytesTransferred += nRC;
+            }
+
+            if (u32BytesTransferred >= u32Bytes)
+                break;
+
+            i64Now = TimeuS64();
+            if (i64Timeout > 0 && i64Now >= i64Expire)
+                throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "send " + std::to_string(LockedGetFD()) + " " +
+                                                        LockedGetPeerAddrString() + " timeout");
+        }
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        if (u32BytesTransferred > 0)
+        {
+            pending.u32LastID = m_pZeroCopy->u32NextID - 1;
+            m_pZeroCopy->dqPending.push_back(pending);
+        }
+        throw;
+    }
+
+    pending.u32LastID = m_pZeroCopy->u32NextID - 1;
+    m_pZeroCopy->dqPending.push_back(pending);
+    if (pending.u32FirstID == m_pZeroCopy->u32NextID)
+        LockedReapZeroCopy(0);
+
+    return u32BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// harvest the error queue into m_pZeroCopy->vecDone; waits (unlocked) only while nothing has completed yet
+void
+libthrocket::TCPSocket::LockedReapZeroCopy(int64_t i64Timeout)
+{
+    if (m_pZeroCopy == NULL)
+        return;
+
+    TCPZeroCopyState          & zc                      =   *m_pZeroCopy;
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64Timeout;
+
+    while (true)
+    {
+        // drain every notification queued so far
+        while (true)
+        {
+            uint8_t             au8Control[128];
+            struct msghdr       msg;
+
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_control     = au8Control;
+            msg.msg_controllen  = sizeof(au8Control);
+
+            if (recvmsg(LockedGetFD(), &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            {
+                int             nSaveErrno              =   GetLastError();
+                if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+                    break;
+                if (nSaveErrno == EINTR)
+                    continue;
+                throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "recvmsg MSG_ERRQUEUE " + std::to_string(LockedGetFD()) + " " +
+                                                          LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                          " (" + SocketErrorString(nSaveErrno) + ")");
+            }
+
+            for (struct cmsghdr * pcm = CMSG_FIRSTHDR(&msg); pcm != NULL; pcm = CMSG_NXTHDR(&msg, pcm))
+            {
+                if (!(pcm->cmsg_level == SOL_IP   && pcm->cmsg_type == IP_RECVERR) &&
+                    !(pcm->cmsg_level == SOL_IPV6 && pcm->cmsg_type == IPV6_RECVERR))
+                    continue;
+
+                struct sock_extended_err  * pee         =   (struct sock_extended_err*) CMSG_DATA(pcm);
+                if (pee->ee_origin != SO_EE_ORIGIN_ZEROCOPY || pee->ee_errno != 0)
+                    continue;
+
+                uint32_t        u32Lo                   =   pee->ee_info;
+                uint32_t        u32Hi                   =   pee->ee_data;
+                bool            bCopied                 =   (pee->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+
+                if (bCopied)
+                {
+                    for (size_t i = 0; i < zc.dqPending.size(); i++)
+                        if (!ZeroCopyBefore(u32Hi, zc.dqPending[i].u32FirstID) &&
+                            !ZeroCopyBefore(zc.dqPending[i].u32LastID, u32Lo))
+                            zc.dqPending[i].bCopied = true;
+                }
+
+                if (u32Lo == zc.u32DoneID)
+                {
+                    zc.u32DoneID = u32Hi + 1;
+                    std::map<uint32_t, uint32_t>::iterator it;
+                    while ((it = zc.mapEarly.find(zc.u32DoneID)) != zc.mapEarly.end())
+                    {
+                        zc.u32DoneID = it->second + 1;
+                        zc.mapEarly.erase(it);
+                    }
+                } else if (ZeroCopyBefore(zc.u32DoneID, u32Lo))
+                {
+                    zc.mapEarly[u32Lo] = u32Hi;
+                }
+            }
+        }
+
+        while (zc.dqPending.size() > 0 && ZeroCopyBefore(zc.dqPending.front().u32LastID, zc.u32DoneID))
+        {
+            zc.vecDone.push_back(std::make_pair(zc.dqPending.front().u64Cookie, zc.dqPending.front().bCopied));
+            zc.dqPending.pop_front();
+        }
+
+        if (zc.vecDone.size() > 0 || zc.dqPending.size() < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            break;
+
+        // POLLERR is always reported - an empty event mask waits for the error queue alone
+        struct pollfd           pfd;
+        pfd.fd      = LockedGetFD();
+        pfd.events  = 0;
+        pfd.revents = 0;
+
+        m_CSLocal.unlock();
+        poll(&pfd, 1, (int) ((i64Expire - i64Now + 999) / 1000));
+        m_CSLocal.lock();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// Select() takes an errqueue-only POLLERR (SO_ERROR 0) for readiness, so every wait in the transfer paths would return at
+// once and the caller spin on EAGAIN; reaped here the completions are handed out by the next SendZeroCopy()/ReapZeroCopy()
+void
+libthrocket::TCPSocket::LockedWait(bool bWantRead, bool bWantWrite, int64_t i64Timeout)
+{
+    if (i64Timeout > 0)
+        LockedReapZeroCopy(0);
+
+    Socket::LockedWait(bWantRead, bWantWrite, i64Timeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::TCPSocket::LockedGetZeroCopyPending()
+{
+    if (m_pZeroCopy == NULL)
+        return 0;
+    return m_pZeroCopy->dqPending.size() + m_pZeroCopy->vecDone.size();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// completions are handed out with no socket lock held so the handler may send again
+size_t
+libthrocket::TCPSocket::DispatchZeroCopy()
+{
+    std::vector<std::pair<uint64_t, bool> > vecDone;
+    TCPZeroCopyHandler        * pHandler                =   NULL;
+
+    {
+        libthrocket::Lock       l(&m_CSLocal);
+        if (m_pZeroCopy == NULL)
+            return 0;
+        vecDone.swap(m_pZeroCopy->vecDone);
+        pHandler = m_pZeroCopy->pHandler;
+    }
+
+    for (size_t i = 0; i < vecDone.size(); i++)
+        pHandler->OnSendComplete(vecDone[i].first, vecDone[i].second);
+
+    return vecDone.size();
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
 uint32_t
-libthrocket::TCPSocket::LockedTransfer(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort)
+libthrocket::TCPSocket::SendZeroCopy(const uint8_t* pu8Bytes, uint32_t u32Bytes, uint64_t u64Cookie)
 {
-    int                         nRC                     =   0;
-    const char*                 pcFunc                  =   NULL;
-    tTransferProc               pfFunc                  =   NULL;
-    bool                        bWantRead               =   false;
-    bool                        bWantWrite              =   false;
-    uint32_t                    u32BytesTransferred     =   0;
-    int64_t                     i64Now;
-    int64_t                     i64Timeout;
-    int64_t                     i64Expire;
+    uint32_t                    u32BytesTransferred;
 
-    if (bDirection == SOCKET_TRANSFER_SEND)
     {
-        pcFunc = (const char*) "send";
-        pfFunc = (tTransferProc) send;
-        bWantRead  = false;
-        bWantWrite = true;
-        i64Timeout = LockedGetSendTimeout();
+        libthrocket::Lock       l(&m_CSLocal);
+        u32BytesTransferred = LockedSendZeroCopy(pu8Bytes, u32Bytes, u64Cookie);
+    }
+    DispatchZeroCopy();
 
-    } else if (bDirection == SOCKET_TRANSFER_RECV)
-    {
-        pcFunc = (const char*) "recv";
-        pfFunc = (tTransferProc) recv;
-        bWantRead  = true;
-        bWantWrite = false;
-        i64Timeout = LockedGetRecvTimeout();
+    return u32BytesTransferred;
+}
 
-    } else
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::TCPSocket::ReapZeroCopy(int64_t i64Timeout)
+{
     {
-        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "invalid transfer type");
+        libthrocket::Lock       l(&m_CSLocal);
+        LockedReapZeroCopy(i64Timeout);
     }
+    return DispatchZeroCopy();
+}
 
-    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "TCP> %s: %d (%21s) %u bytes TO %ld uS", 
-        pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), u32Bytes, i64Timeout);
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the listen socket is non-blocking so that a connection taken by another thread between poll() and accept() cannot block us
+void
+libthrocket::TCPAcceptSocket::LockedBind(const SocketAddress& addr, int nListenLen)
+{
+    InetSocket::LockedBind(addr, nListenLen);
+    LockedSetNonBlocking();
+    if (m_bAcceptNoNagle)
+        LockedApplyAcceptNoNagle();
+}
 
-    i64Now = TimeuS64();
-    i64Expire = i64Now + i64Timeout;
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPAcceptSocket::LockedSetAcceptOptions(bool bNoNagle, bool bNonBlocking)
+{
+    m_bAcceptNoNagle     = bNoNagle;
+    m_bAcceptNonBlocking = bNonBlocking;
+
+    if (m_nSocket != INVALID_SOCKET)
+        LockedApplyAcceptNoNagle();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// accepted sockets inherit TCP_NODELAY from the listener, so this costs one setsockopt rather than one per connection
+void
+libthrocket::TCPAcceptSocket::LockedApplyAcceptNoNagle()
+{
+    int                         nEnabled                =   m_bAcceptNoNagle ? 1 : 0;
+
+    if (setsockopt(m_nSocket, IPPROTO_TCP, TCP_NODELAY, &nEnabled, sizeof (nEnabled)) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "setsockopt FD " + std::to_string(m_nSocket) + " TCP_NODELAY " +
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// returns INVALID_SOCKET when there is nothing left to accept
+int
+libthrocket::TCPAcceptSocket::LockedAcceptFD(int nFlags)
+{
     while (1)
     {
-        #ifdef WIN32
-        #else   // WIN32
-            if (bDirection == SOCKET_TRANSFER_RECV && WOULDDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH) != false)
-            {
-                int                 nCount;
-                if (ioctl(LockedGetFD(), FIONREAD, &nCount) == 0)
-                {
-                    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-                        "TCP> recv: %d (%21s) FIONREAD %d", 
-                        LockedGetFD(), LockedGetPeerAddrString().c_str(), nCount);
-                }
-            }
-        #endif
+        int                     nFD                     =   accept4(m_nSocket, NULL, NULL, nFlags);
+        if (nFD != INVALID_SOCKET)
+            return nFD;
 
-        LockedWait(bWantRead, bWantWrite, i64Expire - i64Now);
+        int                     nSaveErrno              =   GetLastError();
+        if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            return INVALID_SOCKET;
+        // the peer gave up while queued - move on to the next one
+        if (nSaveErrno == ECONNABORTED || nSaveErrno == EINTR)
+            continue;
 
-        nRC = pfFunc(LockedGetFD(), pu8Bytes, u32Bytes, 0);
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "accept4: " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+}
 
-        if (nRC == 0)
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::TCPSocket *
+libthrocket::TCPAcceptSocket::LockedAccept(int64_t i64AcceptTimeout)
+{
+    int                         nFD;
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64AcceptTimeout;
+    bool                        bIOEngine               =   LockedUseIOEngine(IORING_OP_ACCEPT, i64AcceptTimeout);
+    while (1)
+    {
+        if (bIOEngine)
         {
-            break;
+            int32_t             i32RC;
 
-        } else if (nRC < 1)
-        {
-            int                 nSaveErrno              =   GetLastError();
-            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " + 
-                                                      LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
-                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+            IOUringEngine     * pEngine                 =   m_pIOEngine;
+            int                 nListenFD               =   m_nSocket;
+            int                 nFixedSlot              =   m_nIOFixedSlot;
+            int                 nFlags                  =   LockedGetAcceptFlags();
 
+            LockedBeginRingIO();
+            try
+            {
+                i32RC = pEngine->Accept(nListenFD, nFixedSlot, nFlags, i64Expire - i64Now);
+            }
+            catch (const libthrocket::Exception & e)
+            {
+                EndRingIO();
+                throw;
+            }
+            EndRingIO();
+            // a connection accepted just as Close() cancelled us is not wanted
+            if (i32RC >= 0 && (m_bRingQuiescing || m_nSocket != nListenFD))
+                closesocket(i32RC);
+            LockedCheckRingClosed(nListenFD, "accept");
+
+            nFD = i32RC;
+            if (i32RC >= 0)
+                break;
+            if (i32RC == -ETIMEDOUT)
+                throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "accept");
+            if (i32RC != -ECONNABORTED && i32RC != -EINTR)
+                throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "accept: " + std::to_string(-i32RC) +
+                                                              " (" + SocketErrorString(-i32RC) + ")");
         } else
         {
-            LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-                "TCP> %s: %d (%21s) %d bytes", 
-                pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), nRC);
-            u32Bytes            -=  nRC;
-            u32BytesTransferred +=  nRC;
-            pu8Bytes            +=  nRC;
-        }
+            LockedWait(true/*bWantRead*/, false/*bWantWrite*/, i64Expire - i64Now);
 
-        if (bShort || u32Bytes < 1)
-            break;
+            nFD = LockedAcceptFD(LockedGetAcceptFlags());
+            if (nFD != INVALID_SOCKET)
+                break;
+        }
 
         i64Now = TimeuS64();
         if (i64Now >= i64Expire)
-            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " + 
-                                                    LockedGetPeerAddrString() + " timeout");
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "accept");
     }
+    TCPSocket * pSock = new TCPSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout);
+    if (m_pIOEngine != NULL)
+        pSock->SetIOEngine(m_pIOEngine, m_bIOFixedFile);
 
-    return u32BytesTransferred;
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK> acpt: %d (%21s)",
+        pSock->GetFD(), pSock->GetPeerAddrString().c_str());
+
+    return pSock;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 //
-uint32_t
-libthrocket::TCPSocket::LockedRecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes)
+libthrocket::TCPSocket *
+libthrocket::TCPAcceptSocket::LockedAcceptNonBlocking()
 {
-    uint32_t                    u32BytesRecvd           =   0;
-    uint32_t                    u32BytesTotal           =   0;
+    int                         nFD                     =   LockedAcceptFD(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (nFD == INVALID_SOCKET)
+        return NULL;
 
-    while (u32Bytes > 0)
-    {
-        u32BytesRecvd = LockedTransfer(SOCKET_TRANSFER_RECV, pu8Bytes, u32Bytes, false/*bShort*/);
-        if (u32BytesRecvd == 0)
-            break;
-        pu8Bytes      += u32BytesRecvd;
-        u32Bytes      -= u32BytesRecvd;
-        u32BytesTotal += u32BytesRecvd;
-    }
+    TCPSocket * pSock = new TCPSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout);
+    if (m_pIOEngine != NULL)
+        pSock->SetIOEngine(m_pIOEngine, m_bIOFixedFile);
 
-    return u32BytesTotal;
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK> acpt: %d (%21s) non-blocking",
+        pSock->GetFD(), pSock->GetPeerAddrString().c_str());
+
+    return pSock;
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
-//
-libthrocket::TCPSocket *
-libthrocket::TCPAcceptSocket::LockedAccept(int64_t i64AcceptTimeout)
+// a single wait covers the whole burst - after a failover thousands of connections are typically already queued
+size_t
+libthrocket::TCPAcceptSocket::LockedAcceptBatch(std::vector<TCPSocket *> & vecSockets, size_t uMax, int64_t i64AcceptTimeout)
 {
-    fd_set                      fdsRead;
-    FD_ZERO(&fdsRead);
-    FD_SET(m_nSocket, &fdsRead);
-    fd_set                      fdsWrite;
-    FD_ZERO(&fdsWrite);
-    FD_SET(m_nSocket, &fdsWrite);
-    fd_set                      fdsExcept;
-    FD_ZERO(&fdsExcept);
-    FD_SET(m_nSocket, &fdsExcept);
-    struct timeval              tv;
-    tv.tv_sec  = (int32_t) (i64AcceptTimeout / (1000 * 1000));
-    tv.tv_usec = (int32_t) (i64AcceptTimeout % (1000 * 1000));
-    int                     nRC;
-    nRC = select(m_nSocket + 1, &fdsRead, &fdsWrite, &fdsExcept, &tv);
-    if (nRC == 0)
-        throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "select");
-    if (nRC == -1)
-    {
-        int nSaveErrno = GetLastError();
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "select: " + std::to_string(nSaveErrno) +
-                                                      " (" + SocketErrorString(nSaveErrno) + ")");
-    }
-    if (!FD_ISSET(m_nSocket, &fdsRead))
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "select: listening socket is not readable");
+    if (uMax < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "uMax " + std::to_string(uMax));
+
+    vecSockets.clear();
+    vecSockets.reserve(uMax);
 
-    struct sockaddr saddr;
-    memset(&saddr, 0, sizeof(saddr));
-    socklen_t addrlen = sizeof(saddr);
-    int nFD = accept(m_nSocket, &saddr, &addrlen);
-    if (nFD == -1)
+    int                         nFlags                  =   LockedGetAcceptFlags();
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64AcceptTimeout;
+    while (1)
     {
-        int nSaveErrno = GetLastError();
-        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "accept: " + std::to_string(nSaveErrno) +
-                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+        LockedWait(true/*bWantRead*/, false/*bWantWrite*/, i64Expire - i64Now);
+
+        try
+        {
+            int                 nFD;
+            while (vecSockets.size() < uMax && (nFD = LockedAcceptFD(nFlags)) != INVALID_SOCKET)
+            {
+                vecSockets.push_back(new TCPSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout));
+                if (m_pIOEngine != NULL)
+                    vecSockets.back()->SetIOEngine(m_pIOEngine, m_bIOFixedFile);
+            }
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            // e.g. EMFILE part way through - hand back what we already own
+            if (vecSockets.size() < 1)
+                throw;
+            e.LogWarning(LIBTHROCKET_CAUGHT_BY);
+        }
+
+        if (vecSockets.size() > 0)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "accept batch");
     }
-    TCPSocket * pSock = new TCPSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout);
 
     LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
-        "SCK> acpt: %d (%21s)",
-        pSock->GetFD(), pSock->GetPeerAddrString().c_str());
+        "SCK> acpt: %d (%21s) batch %zu/%zu",
+        LockedGetFD(), LockedGetLocalAddrString().c_str(), vecSockets.size(), uMax);
 
-    return pSock;
+    return vecSockets.size();
 }
 
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
@@ -1203,4 +3273,173 @@ libthrocket::HTTPClient::Request
     return RecvAll(pu8Response, u32ResponseLen);
 }
 
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::HTTPClient::Request
+(
+    const uint8_t*      pu8Request,
+    uint32_t            u32RequestLen,
+    HTTPResponseHandler* pHandler,
+    bool                bHead
+)
+{
+    // anything left over from a previous exchange was never asked for
+    m_u32RecvBufOff = m_u32RecvBufLen = 0;
+
+    try
+    {
+        Send(pu8Request, u32RequestLen);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        throw libthrocket::HTTPClientSendException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+    }
+
+    m_parser.Reset(pHandler, bHead);
+    if (RecvResponse() == false)
+        throw libthrocket::HTTPParserTruncatedException(LIBTHROCKET_THROWN_BY, "connection closed before response");
+
+    // bytes past the end of the response mean the framing is not what the server thinks it is
+    bool                        bReusable               =   m_parser.IsKeepAlive() && m_u32RecvBufLen == 0;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "HTP> rsp: %d status %u body %lu%s",
+        GetFD(), m_parser.GetStatus(), (unsigned long) m_parser.GetBodyBytes(), bReusable ? "" : " (not reusable)");
+
+    return bReusable;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::HTTPClient::RecvResponse()
+{
+    while (1)
+    {
+        if (m_u32RecvBufLen > 0)
+        {
+            size_t              uUsed                   =   m_parser.Parse(m_au8RecvBuf + m_u32RecvBufOff, m_u32RecvBufLen);
+            m_u32RecvBufOff += uUsed;
+            m_u32RecvBufLen -= uUsed;
+            if (m_parser.IsComplete())
+                return true;
+        }
+
+        m_u32RecvBufOff = 0;
+        m_u32RecvBufLen = Recv(m_au8RecvBuf, sizeof(m_au8RecvBuf), true);
+        if (m_u32RecvBufLen == 0)
+        {
+            if (m_parser.IsIdle())
+                return false;
+            m_parser.ParseEOF();
+            return true;
+        }
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::HTTPClient::Queue
+(
+    const uint8_t*      pu8Request,
+    uint32_t            u32RequestLen,
+    HTTPResponseHandler* pHandler,
+    bool                bHead
+)
+{
+    Queued                      queued;
+
+    if (pu8Request == NULL || u32RequestLen < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "empty request");
+
+    queued.pu8Request       = pu8Request;
+    queued.u32RequestLen    = u32RequestLen;
+    queued.pHandler         = pHandler;
+    queued.bHead            = bHead;
+
+    m_vecQueue.push_back(queued);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// all requests go out before any response is read - fine for requests that fit the socket buffers, which is what
+// pipelining is for; large uploads would stall against a server that is blocked writing responses we are not reading
+size_t
+libthrocket::HTTPClient::Flush(bool& bReusable)
+{
+    std::vector<Queued>         vecQueue;
+    std::vector<struct iovec>   vecIOV;
+    size_t                      uAnswered               =   0;
+
+    vecQueue.swap(m_vecQueue);
+    m_u32RecvBufOff = m_u32RecvBufLen = 0;
+    bReusable = false;
+
+    if (vecQueue.size() < 1)
+    {
+        bReusable = true;
+        return 0;
+    }
+
+    vecIOV.resize(vecQueue.size());
+    for (size_t i = 0; i < vecQueue.size(); i++)
+    {
+        vecIOV[i].iov_base  = (void*) vecQueue[i].pu8Request;
+        vecIOV[i].iov_len   = vecQueue[i].u32RequestLen;
+    }
+
+    try
+    {
+        try
+        {
+            for (size_t i = 0; i < vecIOV.size(); i += IOV_MAX)
+            {
+                size_t          uIOV                    =   vecIOV.size() - i;
+                SendV(&vecIOV[i], (int) (uIOV > IOV_MAX ? IOV_MAX : uIOV));
+            }
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            throw libthrocket::HTTPClientSendException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+        }
+
+        // responses come back in request order, possibly several to a read - leftovers carry over in m_au8RecvBuf
+        for (uAnswered = 0; uAnswered < vecQueue.size(); uAnswered++)
+        {
+            m_parser.Reset(vecQueue[uAnswered].pHandler, vecQueue[uAnswered].bHead);
+            if (RecvResponse() == false)
+                break;
+            if (m_parser.IsKeepAlive() == false)
+            {
+                uAnswered++;
+                break;
+            }
+        }
+    }
+    catch (...)
+    {
+        // the unanswered tail goes back on the queue, ahead of anything queued since, so GetNumQueued() tells the caller
+        // where it stopped - in a send batch or a response, the connection is beyond reuse either way
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "HTP> pipeline: %d %zu/%zu answered, failed", GetFD(), uAnswered, vecQueue.size());
+        m_vecQueue.insert(m_vecQueue.begin(), vecQueue.begin() + uAnswered, vecQueue.end());
+        throw;
+    }
+
+    // closed part way (Connection: close, or a hangup) - the tail goes back on the queue as above, for the caller to send
+    // again on a new connection
+    if (uAnswered < vecQueue.size())
+        m_vecQueue.insert(m_vecQueue.begin(), vecQueue.begin() + uAnswered, vecQueue.end());
+
+    // anything beyond the last response we asked for means the framing is off
+    bReusable = uAnswered == vecQueue.size() && m_parser.IsKeepAlive() && m_u32RecvBufLen == 0;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "HTP> pipeline: %d %zu/%zu answered%s",
+        GetFD(), uAnswered, vecQueue.size(), bReusable ? "" : " (not reusable)");
+
+    return uAnswered;
+}
+
 //============================================================================================================================= 132
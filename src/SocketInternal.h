@@ -0,0 +1,79 @@
+//============================================================================================================================= 132
+//
+//  SocketInternal.h
+//
+//      Private to the socket sources - the error spellings Socket.cc and UnixSocket.cc share, so their error paths read
+//      the same.  Not installed.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+#pragma once
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <string>
+
+#ifdef WIN32
+
+#include <windows.h>
+
+#else   // WIN32
+
+#include <errno.h>
+#include <string.h>
+
+#define GetLastError() errno
+
+#endif  // WIN32
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#ifdef WIN32
+
+static inline const std::string
+SocketErrorString(int nErr)
+{
+    char                        acMsg[128];
+    FormatMessage(FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                    NULL, nErr, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                    (LPTSTR) acMsg, sizeof(acMsg), NULL );
+    return acMsg;
+}
+
+#else   // WIN32
+
+static inline const std::string
+SocketErrorString(int nErr)
+{
+    return strerror(nErr);
+}
+
+#endif  // WIN32
+
+//============================================================================================================================= 132
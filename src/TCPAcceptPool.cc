@@ -0,0 +1,240 @@
+//============================================================================================================================= 132
+//
+//  TCPAcceptPool.cc
+//
+//      SO_REUSEPORT listen sockets, one acceptor thread each.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <unistd.h>
+
+#include "AlarmDebugLog.h"
+#include "TCPAcceptPool.h"
+
+using namespace std;
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// one per listen socket
+class TCPAcceptThread       :   public Thread
+{
+    public:
+                                TCPAcceptThread
+                                (
+                                    TCPAcceptSocket   * pListener,
+                                    TCPAcceptHandler  * pHandler,
+                                    int64_t             i64PollInterval
+                                )   :
+                                    m_pListener(pListener),
+                                    m_pHandler(pHandler),
+                                    m_i64PollInterval(i64PollInterval)
+                                {}
+        virtual                 ~TCPAcceptThread()
+                                {}
+
+    protected:
+
+        virtual void            Run();
+
+    private:
+
+        TCPAcceptSocket       * m_pListener;
+        TCPAcceptHandler      * m_pHandler;
+        int64_t                 m_i64PollInterval;
+
+                                // disallow default construction / copy constructors
+                                TCPAcceptThread();
+                                TCPAcceptThread(const TCPAcceptThread &);
+        void                    operator=(const TCPAcceptThread &);
+};
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPAcceptThread::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    int64_t                     i64LastLog              =   0;
+    uint32_t                    u32Unlogged             =   0;
+
+    while (GetStopRequested() == false)
+    {
+        try
+        {
+            m_pListener->Wait(true/*bWantRead*/, false/*bWantWrite*/, m_i64PollInterval);
+        }
+        catch (const libthrocket::SocketTimeoutException & e)
+        {
+            continue;
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            // e.g. EINTR or POLLERR from the poll - one bad wake must not cost the pool an acceptor
+            e.LogError(LIBTHROCKET_CAUGHT_BY);
+            continue;
+        }
+
+        // drain the backlog while we are awake
+        try
+        {
+            TCPSocket         * pSocket;
+            while ((pSocket = m_pListener->AcceptNonBlocking()) != NULL)
+                m_pHandler->OnAccept(pSocket);
+        }
+        catch (const libthrocket::Exception & e)
+        {
+            // e.g. EMFILE - keep serving once descriptors free up.  The backlog stays readable meanwhile, so the next Wait()
+            // would return at once: back off a poll interval, and log once per TCP_ACCEPT_POOL_LOG_INTERVAL at most
+            int64_t             i64Now                  =   TimeuS64();
+            if (i64Now - i64LastLog >= TCP_ACCEPT_POOL_LOG_INTERVAL)
+            {
+                if (u32Unlogged > 0)
+                    LOGWARNING("%s: %u more accept failures", __PRETTY_FUNCTION__, u32Unlogged);
+                e.LogError(LIBTHROCKET_CAUGHT_BY);
+                i64LastLog  = i64Now;
+                u32Unlogged = 0;
+
+            } else
+            {
+                u32Unlogged++;
+            }
+            usleep((useconds_t) m_i64PollInterval);
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::TCPAcceptPool::TCPAcceptPool
+(
+    uint32_t                    u32Acceptors,
+    int64_t                     i64RecvTimeout,
+    int64_t                     i64SendTimeout,
+    int64_t                     i64PollInterval
+)   :
+    m_u32Acceptors(u32Acceptors),
+    m_i64RecvTimeout(i64RecvTimeout),
+    m_i64SendTimeout(i64SendTimeout),
+    m_i64PollInterval(i64PollInterval)
+{
+    if (u32Acceptors < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "u32Acceptors " + std::to_string(u32Acceptors));
+    if (i64PollInterval < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "i64PollInterval " + std::to_string(i64PollInterval));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::TCPAcceptPool::~TCPAcceptPool()
+{
+    Stop();
+
+    for (size_t i = 0; i < m_vecListeners.size(); i++)
+        delete m_vecListeners[i];
+    m_vecListeners.clear();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPAcceptPool::Bind(const string& strIPAddr, uint16_t u16Port, int nListenLen)
+{
+    if (m_vecListeners.size() > 0)
+        throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "already bound");
+
+    m_vecListeners.reserve(m_u32Acceptors);
+    try
+    {
+        for (uint32_t i = 0; i < m_u32Acceptors; i++)
+        {
+            TCPAcceptSocket   * pListener               =   new TCPAcceptSocket(m_i64RecvTimeout, m_i64SendTimeout);
+            m_vecListeners.push_back(pListener);
+            pListener->ReusePort();
+            pListener->Bind(strIPAddr, u16Port, nListenLen);
+            if (u16Port == 0)
+                u16Port = pListener->GetDecodedLocalPort();
+        }
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        for (size_t i = 0; i < m_vecListeners.size(); i++)
+            delete m_vecListeners[i];
+        m_vecListeners.clear();
+        throw;
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "SCK> pool: %u listeners on %s",
+        m_u32Acceptors, InetSocket::AddrString(strIPAddr, u16Port).c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::TCPAcceptPool::Start(TCPAcceptHandler * pHandler)
+{
+    if (pHandler == NULL)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "NULL handler");
+    if (m_vecListeners.size() < 1)
+        throw libthrocket::SocketInitException(LIBTHROCKET_THROWN_BY, "not bound");
+    if (GetNumChildren() > 0)
+        throw libthrocket::SocketInitException(LIBTHROCKET_THROWN_BY, "already started");
+
+    for (size_t i = 0; i < m_vecListeners.size(); i++)
+        ChildBirth(new TCPAcceptThread(m_vecListeners[i], pHandler, m_i64PollInterval))->go();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// acceptors notice within one poll interval
+void
+libthrocket::TCPAcceptPool::Stop()
+{
+    Infanticide();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint16_t
+libthrocket::TCPAcceptPool::GetDecodedLocalPort()
+{
+    if (m_vecListeners.size() < 1)
+        return 0;
+    return m_vecListeners[0]->GetDecodedLocalPort();
+}
+
+//============================================================================================================================= 132
@@ -32,8 +32,18 @@ SOFTWARE.
 
 ============================================================================ */
 
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <new>
+
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 
 #include "AlarmDebugLog.h"
 #include "Exception.h"
@@ -41,6 +51,346 @@ SOFTWARE.
 
 using namespace std;
 
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// MessagePool internals - size class i holds blocks of 16 << i bytes; a free block's first word links it to the next
+namespace libthrocket
+{
+
+#define MESSAGE_POOL_MIN_SHIFT  4
+#define MESSAGE_POOL_CLASSES    (__builtin_ctz(MESSAGE_POOL_MAX_BLOCK) - MESSAGE_POOL_MIN_SHIFT + 1)
+
+struct MessagePoolBlock
+{
+    MessagePoolBlock          * pNext;
+};
+
+struct MessagePoolList
+{
+    MessagePoolBlock          * pHead;
+    size_t                      uCount;
+
+                                // moves up to uMax blocks from the front of this list to the front of dst
+    size_t                      MoveTo(MessagePoolList & dst, size_t uMax)
+                                {
+                                    size_t uMoved = 0;
+                                    while (pHead != NULL && uMoved < uMax)
+                                    {
+                                        MessagePoolBlock * pBlock = pHead;
+                                        pHead = pBlock->pNext;
+                                        pBlock->pNext = dst.pHead;
+                                        dst.pHead = pBlock;
+                                        uMoved++;
+                                    }
+                                    uCount     -= uMoved;
+                                    dst.uCount += uMoved;
+                                    return uMoved;
+                                }
+    void                        Release()
+                                {
+                                    while (pHead != NULL)
+                                    {
+                                        MessagePoolBlock * pBlock = pHead;
+                                        pHead = pBlock->pNext;
+                                        ::operator delete(pBlock);
+                                    }
+                                    uCount = 0;
+                                }
+};
+
+static inline size_t MessagePoolBlockSize(int nClass)
+{
+    return (size_t) 1 << (nClass + MESSAGE_POOL_MIN_SHIFT);
+}
+
+static inline size_t MessagePoolThreadLimit(int nClass)
+{
+    size_t                      uLimit                  =   MESSAGE_POOL_THREAD_BYTES / MessagePoolBlockSize(nClass);
+    return uLimit < 4 ? 4 : uLimit;
+}
+
+// -1 above the largest class
+static inline int MessagePoolClass(size_t uBytes)
+{
+    if (uBytes <= ((size_t) 1 << MESSAGE_POOL_MIN_SHIFT))
+        return 0;
+    if (uBytes > MESSAGE_POOL_MAX_BLOCK)
+        return -1;
+    return (int) (sizeof(unsigned long) * 8 - __builtin_clzl(uBytes - 1)) - MESSAGE_POOL_MIN_SHIFT;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// shared by every thread - touched once per batch, not once per block
+class MessagePoolDepot
+{
+public:
+                                MessagePoolDepot()
+                                { memset(m_lists, 0, sizeof(m_lists)); }
+
+                                // up to uMax blocks of nClass into list, how many
+    size_t                      Take(int nClass, MessagePoolList & list, size_t uMax)
+                                {
+                                    Lock l(m_mutex);
+                                    return m_lists[nClass].MoveTo(list, uMax);
+                                }
+                                // uMax blocks from list; whatever the depot has no room for goes back to malloc
+    void                        Give(int nClass, MessagePoolList & list, size_t uMax)
+                                {
+                                    MessagePoolList excess = { NULL, 0 };
+                                    {
+                                        Lock l(m_mutex);
+                                        size_t uLimit = MESSAGE_POOL_DEPOT_BYTES / MessagePoolBlockSize(nClass);
+                                        size_t uRoom  = m_lists[nClass].uCount < uLimit ? uLimit - m_lists[nClass].uCount : 0;
+                                        uMax -= list.MoveTo(m_lists[nClass], uMax < uRoom ? uMax : uRoom);
+                                    }
+                                    list.MoveTo(excess, uMax);
+                                    excess.Release();
+                                }
+    void                        Trim()
+                                {
+                                    MessagePoolList lists[MESSAGE_POOL_CLASSES];
+                                    {
+                                        Lock l(m_mutex);
+                                        memcpy(lists, m_lists, sizeof(lists));
+                                        memset(m_lists, 0, sizeof(m_lists));
+                                    }
+                                    for (int i = 0; i < MESSAGE_POOL_CLASSES; i++)
+                                        lists[i].Release();
+                                }
+
+private:
+    Mutex                       m_mutex;
+    MessagePoolList             m_lists[MESSAGE_POOL_CLASSES];
+};
+
+// never destroyed - messages still sitting in static ThreadQueues are deleted after every static destructor could have run
+static MessagePoolDepot & GetMessagePoolDepot()
+{
+    static MessagePoolDepot   * pDepot                  =   new MessagePoolDepot;
+    return *pDepot;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// one per thread - handed to the depot when the thread exits
+class MessagePoolCache
+{
+public:
+                                MessagePoolCache()
+                                { memset(m_lists, 0, sizeof(m_lists)); }
+                                ~MessagePoolCache();
+
+    MessagePoolList             m_lists[MESSAGE_POOL_CLASSES];
+};
+
+// trivially destructible, so still readable from destructors that run after the cache's own
+static thread_local bool        tls_bMessagePoolCacheGone   =   false;
+
+MessagePoolCache::~MessagePoolCache()
+{
+    tls_bMessagePoolCacheGone = true;
+    for (int i = 0; i < MESSAGE_POOL_CLASSES; i++)
+        if (m_lists[i].uCount > 0)
+            GetMessagePoolDepot().Give(i, m_lists[i], m_lists[i].uCount);
+}
+
+static inline MessagePoolCache * GetMessagePoolCache()
+{
+    if (tls_bMessagePoolCacheGone)
+        return NULL;
+    // the depot first, so that it is there for the cache to drain into
+    GetMessagePoolDepot();
+    static thread_local MessagePoolCache cache;
+    return &cache;
+}
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void *
+libthrocket::MessagePool::Alloc(size_t uBytes)
+{
+    int                         nClass                  =   MessagePoolClass(uBytes);
+    if (nClass < 0)
+        return ::operator new(uBytes);
+
+    MessagePoolCache          * pCache                  =   GetMessagePoolCache();
+    if (pCache == NULL)
+        return ::operator new(MessagePoolBlockSize(nClass));
+
+    MessagePoolList           & list                    =   pCache->m_lists[nClass];
+    if (list.pHead == NULL &&
+        GetMessagePoolDepot().Take(nClass, list, MessagePoolThreadLimit(nClass) / 2) == 0)
+        return ::operator new(MessagePoolBlockSize(nClass));
+
+    MessagePoolBlock          * pBlock                  =   list.pHead;
+    list.pHead = pBlock->pNext;
+    list.uCount--;
+    return pBlock;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a consumer that only ever frees fills up and passes half a cache at a time on to the producers through the depot
+void
+libthrocket::MessagePool::Free(void * p, size_t uBytes)
+{
+    if (p == NULL)
+        return;
+
+    int                         nClass                  =   MessagePoolClass(uBytes);
+    MessagePoolCache          * pCache                  =   nClass < 0 ? NULL : GetMessagePoolCache();
+    if (pCache == NULL)
+    {
+        ::operator delete(p);
+        return;
+    }
+
+    MessagePoolList           & list                    =   pCache->m_lists[nClass];
+    MessagePoolBlock          * pBlock                  =   (MessagePoolBlock *) p;
+    pBlock->pNext = list.pHead;
+    list.pHead    = pBlock;
+    list.uCount++;
+
+    size_t                      uLimit                  =   MessagePoolThreadLimit(nClass);
+    if (list.uCount > uLimit)
+        GetMessagePoolDepot().Give(nClass, list, uLimit / 2);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::MessagePool::Trim()
+{
+    MessagePoolCache          * pCache                  =   GetMessagePoolCache();
+    if (pCache != NULL)
+        for (int i = 0; i < MESSAGE_POOL_CLASSES; i++)
+            pCache->m_lists[i].Release();
+    GetMessagePoolDepot().Trim();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// "0-3,8,10-11" (sysfs cpulist format) to CPU numbers
+static std::vector<int> ParseCPUList(const std::string & strList)
+{
+    std::vector<int>            vecCPUs;
+    const char                * psz                     =   strList.c_str();
+
+    while (*psz != '\0' && *psz != '\n')
+    {
+        char                  * pszEnd;
+        long                    lFirst                  =   strtol(psz, &pszEnd, 10);
+        long                    lLast                   =   lFirst;
+        if (pszEnd == psz)
+            break;
+        psz = pszEnd;
+        if (*psz == '-')
+        {
+            lLast = strtol(psz + 1, &pszEnd, 10);
+            psz = pszEnd;
+        }
+        for (long l = lFirst; l <= lLast; l++)
+            vecCPUs.push_back((int) l);
+        if (*psz == ',')
+            psz++;
+    }
+    return vecCPUs;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// -1 for a virtual device, or a kernel without NUMA
+int
+libthrocket::ThreadPlacement::GetNUMANodeOfNetDevice(const std::string & strInterface)
+{
+    std::ifstream               ifs(("/sys/class/net/" + strInterface + "/device/numa_node").c_str());
+    int                         nNode                   =   -1;
+    if (!(ifs >> nNode))
+        return -1;
+    return nNode;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+std::vector<int>
+libthrocket::ThreadPlacement::GetCPUsOfNUMANode(int nNode)
+{
+    if (nNode < 0)
+        return std::vector<int>();
+
+    std::ifstream               ifs(("/sys/devices/system/node/node" + std::to_string(nNode) + "/cpulist").c_str());
+    std::string                 strList;
+    std::getline(ifs, strList);
+    return ParseCPUList(strList);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// runs on the new thread, so it only ever moves itself; each part is tried on its own and a refusal costs a warning, not the
+// thread - set_mempolicy() goes straight to the syscall rather than pulling in libnuma for one call
+void
+libthrocket::Thread::ApplyPlacement()
+{
+    std::vector<int>            vecCPUs                 =   mPlacement.vecCPUs;
+    if (vecCPUs.empty())
+        vecCPUs = ThreadPlacement::GetCPUsOfNUMANode(mPlacement.nNUMANode);
+
+    if (vecCPUs.size() > 0)
+    {
+        cpu_set_t               cpus;
+        CPU_ZERO(&cpus);
+        for (size_t i = 0; i < vecCPUs.size(); i++)
+            if (vecCPUs[i] >= 0 && vecCPUs[i] < CPU_SETSIZE)
+                CPU_SET(vecCPUs[i], &cpus);
+        int                     rc                      =   pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (rc != 0)
+            LOGWARNING("THR> pthread_setaffinity_np (%zu CPUs) %d (%s)", vecCPUs.size(), rc, strerror(rc));
+    }
+
+    if (mPlacement.nNUMANode >= 0)
+    {
+        const size_t            uBits                   =   8 * sizeof(unsigned long);
+        unsigned long           aulNodes[1024 / uBits];
+        memset(aulNodes, 0, sizeof(aulNodes));
+        if (mPlacement.nNUMANode < 1024)
+        {
+            aulNodes[mPlacement.nNUMANode / uBits] = 1UL << (mPlacement.nNUMANode % uBits);
+            int                 nMode                   =   mPlacement.bNUMAStrict ? MPOL_BIND : MPOL_PREFERRED;
+            if (syscall(SYS_set_mempolicy, nMode, aulNodes, (unsigned long) (1024 + 1)) != 0)
+            {
+                int             nSaveErrno              =   errno;
+                LOGWARNING("THR> set_mempolicy node %d %d (%s)", mPlacement.nNUMANode, nSaveErrno, strerror(nSaveErrno));
+            }
+        } else
+        {
+            LOGWARNING("THR> NUMA node %d out of range", mPlacement.nNUMANode);
+        }
+    }
+
+    if (mPlacement.nSchedPolicy >= 0)
+    {
+        struct sched_param      param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = mPlacement.nSchedPriority;
+        int                     rc                      =   pthread_setschedparam(pthread_self(), mPlacement.nSchedPolicy, &param);
+        if (rc != 0)
+            LOGWARNING("THR> pthread_setschedparam policy %d priority %d %d (%s)",
+                       mPlacement.nSchedPolicy, mPlacement.nSchedPriority, rc, strerror(rc));
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+static thread_local libthrocket::Thread   * tls_pActingFor      =   NULL;
+
+libthrocket::Thread * libthrocket::Thread::GetActingFor()
+{
+    return tls_pActingFor;
+}
+
+libthrocket::Thread * libthrocket::Thread::SetActingFor(libthrocket::Thread * pThread)
+{
+    libthrocket::Thread * pPrevious = tls_pActingFor;
+    tls_pActingFor = pThread;
+    return pPrevious;
+}
+
 //------------------------------=-----------------------=---------------------------------------------------------------------- 132
 // friend of Thread
 // expects to be called with a pointer to a Thread as arg
@@ -48,6 +398,10 @@ void * libthrocket::Thread::ProcWrapThread(void * pvArg)
 {
     libthrocket::Thread * pThread = (Thread *) pvArg;
 
+    // before go() returns - nothing the thread does runs, or allocates, in the wrong place
+    if (pThread->mPlacement.empty() == false)
+        pThread->ApplyPlacement();
+
     {
         libthrocket::Lock l((pThread->mCSLocal));
         pThread->mbStarted      = true;
@@ -55,6 +409,9 @@ void * libthrocket::Thread::ProcWrapThread(void * pvArg)
         pThread->mStarted.signal();
     }
 
+    // its own work, until a ThreadActingFor says otherwise
+    libthrocket::Thread::SetActingFor(pThread);
+
     try
     {
         // run the routine
@@ -178,4 +535,168 @@ void libthrocket::ThreadMother::SendAllChildren(libthrocket::ThreadMessage * m)
     LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
 }
 
+// --------------------------------------------------------------------------------------------------------------------------------
+// the respond queue for a concurrent SendAllChildren - counts acknowledgements down and notes which child each was made for
+// (Thread::GetActingFor(), so one forwarded to a ThreadPool or answered under a ThreadActingFor still counts as the child's)
+// it outlives the broadcast when children miss the timeout: the caller and every child that has yet to answer hold a
+// reference, and the last one out deletes it (and the message, if the caller gave up on it)
+namespace libthrocket
+{
+
+class ThreadAckQueue        :   public ThreadQueue
+{
+public:
+                                ThreadAckQueue(size_t uChildren)    :
+                                    m_latch(uChildren),
+                                    m_uRefs(uChildren + 1),
+                                    m_uHolding(uChildren),
+                                    m_uAcked(0),
+                                    m_pmsgOrphan(NULL)
+                                {}
+    virtual                     ~ThreadAckQueue()
+                                {}
+
+    virtual void                put(ThreadMessage * msg)
+                                {
+                                    {
+                                        Lock l(m_mutex);
+                                        m_vecAcked.push_back(Thread::GetActingFor());
+                                        m_uAcked++;
+                                        m_uHolding--;
+                                    }
+                                    m_latch.CountDown();
+                                    Release();
+                                    (void) msg;
+                                }
+                                // a child reaped with m still queued - it will never answer, and m is ours, not its queue's
+    virtual void                Abandon(ThreadMessage * msg)
+                                {
+                                    {
+                                        Lock l(m_mutex);
+                                        m_uHolding--;
+                                    }
+                                    m_latch.CountDown();
+                                    Release();
+                                    (void) msg;
+                                }
+
+    CountdownLatch            & GetLatch()
+                                { return m_latch; }
+                                // the caller's reference - whether they all answered, who did not, and whether m is still
+                                // held by a child (and so handed over to the stragglers) all come from one look under
+                                // m_mutex, so an answer landing meanwhile cannot make them disagree
+    bool                        Finish(ThreadMessage * m, const std::vector<Thread *> & vecChildren,
+                                       std::vector<Thread *> * pvecMissing)
+                                {
+                                    bool bAll;
+                                    bool bOrphan;
+                                    {
+                                        Lock l(m_mutex);
+                                        bAll    = m_uAcked == vecChildren.size();
+                                        bOrphan = m_uHolding > 0;
+                                        if (bOrphan)
+                                            m_pmsgOrphan = m;
+                                        for (size_t i = 0; bAll == false && pvecMissing != NULL && i < vecChildren.size(); i++)
+                                            if (std::find(m_vecAcked.begin(), m_vecAcked.end(), vecChildren[i]) == m_vecAcked.end())
+                                                pvecMissing->push_back(vecChildren[i]);
+                                        if (bAll == false)
+                                            LOGWARNING("%s: %zu of %zu children did not acknowledge", __PRETTY_FUNCTION__,
+                                                       vecChildren.size() - m_uAcked, vecChildren.size());
+                                    }
+                                    // no child can touch m now unless it was orphaned, and then we must not
+                                    if (bOrphan == false)
+                                    {
+                                        m->SetRespondOwns(false);
+                                        m->SetQRespond(NULL);
+                                    }
+                                    Release();
+                                    // a false return always consumes m - the caller cannot tell which kind it was
+                                    if (bAll == false && bOrphan == false)
+                                        delete m;
+                                    return bAll;
+                                }
+
+private:
+    Mutex                       m_mutex;
+    CountdownLatch              m_latch;
+    size_t                      m_uRefs;
+    size_t                      m_uHolding;
+    size_t                      m_uAcked;
+    ThreadMessage             * m_pmsgOrphan;
+    std::vector<Thread *>       m_vecAcked;
+
+    void                        Release()
+                                {
+                                    ThreadMessage * pmsgDelete = NULL;
+                                    bool bDelete;
+                                    {
+                                        Lock l(m_mutex);
+                                        bDelete = --m_uRefs == 0;
+                                        if (bDelete)
+                                            pmsgDelete = m_pmsgOrphan;
+                                    }
+                                    if (bDelete)
+                                    {
+                                        delete pmsgDelete;
+                                        delete this;
+                                    }
+                                }
+};
+
+};  // namespace libthrocket
+
+// --------------------------------------------------------------------------------------------------------------------------------
+// the children are locked while m is queued to them, so none can be reaped half way through; m belongs to the ack queue
+// until every child has let go of it, so reaping a straggler afterwards does not delete it from under the others
+bool libthrocket::ThreadMother::SendAllChildren(libthrocket::ThreadMessage * m, int64_t i64Timeout,
+                                                 std::vector<libthrocket::Thread *> * pvecMissing)
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry", __PRETTY_FUNCTION__);
+
+    // the children are taken now - one reaped while we wait is not there to ask
+    std::vector<libthrocket::Thread *> vecChildren;
+    libthrocket::ThreadAckQueue * pqAck;
+    {
+        libthrocket::Lock l(m_lockThreadMother);
+        vecChildren.assign(m_childrenThreadMother.begin(), m_childrenThreadMother.end());
+
+        pqAck = new libthrocket::ThreadAckQueue(vecChildren.size());
+        m->SetQRespond(pqAck);
+        m->SetRespondOwns(true);
+        for (size_t i = 0; i < vecChildren.size(); i++)
+            vecChildren[i]->Queue(m);
+    }
+
+    if (i64Timeout < 1)
+        pqAck->GetLatch().Wait();
+    else
+        (void) pqAck->GetLatch().WaitTimed(i64Timeout > UINT32_MAX ? UINT32_MAX : (uint32_t) i64Timeout);
+
+    if (pvecMissing != NULL)
+        pvecMissing->clear();
+    bool bAll = pqAck->Finish(m, vecChildren, pvecMissing);
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit", __PRETTY_FUNCTION__);
+    return bAll;
+}
+
+// --------------------------------------------------------------------------------------------------------------------------------
+// one message each (a child deletes what it is sent) but a single payload between them all
+void libthrocket::ThreadMother::PostAllChildren(uint32_t u32ID, const libthrocket::SharedBuffer & buf)
+{
+    libthrocket::Lock l(m_lockThreadMother);
+
+    std::list<libthrocket::Thread *>::iterator iter;
+    for (iter = m_childrenThreadMother.begin(); iter != m_childrenThreadMother.end(); iter++)
+    {
+        libthrocket::ThreadMessage * m = new libthrocket::ThreadMessage;
+        m->SetID(u32ID);
+        m->SetBuf(buf);
+        (*iter)->Queue(m);
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: %zu children %zu bytes", __PRETTY_FUNCTION__, m_childrenThreadMother.size(),
+             buf.GetLength());
+}
+
 //============================================================================================================================= 132
@@ -0,0 +1,332 @@
+//============================================================================================================================= 132
+//
+//  ThreadPool.cc
+//
+//      Work-stealing executor - short tasks without a pthread_create()/join each.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <unistd.h>
+
+#include "AlarmDebugLog.h"
+#include "ThreadPool.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// which pool and worker the calling thread is, if any - a task submitting more work keeps it on its own deque
+static thread_local libthrocket::ThreadPool   * tls_pThreadPool     =   NULL;
+static thread_local uint32_t                    tls_u32Worker       =   0;
+
+namespace libthrocket
+{
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class ThreadPoolWorker      :   public Thread
+{
+    public:
+                                ThreadPoolWorker(ThreadPool * pPool, uint32_t u32Worker, uint32_t u32StackSize)   :
+                                    Thread(u32StackSize),
+                                    m_pPool(pPool),
+                                    m_u32Worker(u32Worker)
+                                {}
+        virtual                 ~ThreadPoolWorker()
+                                {}
+
+    protected:
+
+        virtual void            Run();
+
+    private:
+
+        ThreadPool            * m_pPool;
+        uint32_t                m_u32Worker;
+
+                                // disallow default construction / copy constructors
+                                ThreadPoolWorker();
+                                ThreadPoolWorker(const ThreadPoolWorker &);
+        void                    operator=(const ThreadPoolWorker &);
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+class ThreadPoolDispatchTask :  public ThreadPoolTask
+{
+    public:
+                                ThreadPoolDispatchTask(ThreadMessage * msg, ThreadPoolMessageHandler * pHandler)    :
+                                    m_msg(msg),
+                                    m_pHandler(pHandler)
+                                {}
+        virtual                 ~ThreadPoolDispatchTask()
+                                { delete m_msg; }
+
+        virtual void            Run();
+
+    private:
+
+        ThreadMessage         * m_msg;
+        ThreadPoolMessageHandler * m_pHandler;
+
+                                // disallow default construction / copy constructors
+                                ThreadPoolDispatchTask();
+                                ThreadPoolDispatchTask(const ThreadPoolDispatchTask &);
+        void                    operator=(const ThreadPoolDispatchTask &);
+};
+
+};  // namespace libthrocket
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// workers drain the deques before they go - Stop() promises every queued task runs
+void
+libthrocket::ThreadPoolWorker::Run()
+{
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: entry %u", __PRETTY_FUNCTION__, m_u32Worker);
+
+    tls_pThreadPool = m_pPool;
+    tls_u32Worker   = m_u32Worker;
+
+    while (GetStopRequested() == false || m_pPool->GetNumQueued() > 0)
+        m_pPool->Work(m_u32Worker);
+
+    tls_pThreadPool = NULL;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH, "%s: exit %u", __PRETTY_FUNCTION__, m_u32Worker);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the message goes on even if the handler threw - whoever is waiting on the respond queue must still hear back
+void
+libthrocket::ThreadPoolDispatchTask::Run()
+{
+    try
+    {
+        m_pHandler->OnMessage(m_msg);
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+    catch (const std::exception & e)
+    {
+        LOGWARNING("POOL> handler threw std::exception: %s", e.what());
+    }
+    catch (...)
+    {
+        LOGWARNING("POOL> handler threw an unknown exception");
+    }
+
+    ThreadMessage             * msg                     =   m_msg;
+    m_msg = NULL;
+    if (msg->GetQRespond() != NULL)
+        msg->GetQRespond()->put(msg);
+    else
+        delete msg;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadPool::ThreadPool(uint32_t u32Workers, uint32_t u32StackSize)    :
+    m_u32Workers(u32Workers),
+    m_u32NextWorker(0),
+    m_uQueued(0),
+    m_u32Sleeping(0),
+    m_u64Steals(0),
+    m_bStopped(false)
+{
+    if (m_u32Workers < 1)
+    {
+        long                    lCPUs                   =   sysconf(_SC_NPROCESSORS_ONLN);
+        m_u32Workers = lCPUs > 0 ? (uint32_t) lCPUs : 1;
+    }
+
+    for (uint32_t i = 0; i < m_u32Workers; i++)
+        m_vecDeques.push_back(new WorkerDeque);
+    for (uint32_t i = 0; i < m_u32Workers; i++)
+        ChildBirth(new ThreadPoolWorker(this, i, u32StackSize))->go();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadPool::~ThreadPool()
+{
+    Stop();
+
+    for (size_t i = 0; i < m_vecDeques.size(); i++)
+    {
+        while (m_vecDeques[i]->deq.size() > 0)
+        {
+            delete m_vecDeques[i]->deq.front();
+            m_vecDeques[i]->deq.pop_front();
+        }
+        delete m_vecDeques[i];
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a task still running while Stop() drains may queue more - the workers are still there to run it
+void
+libthrocket::ThreadPool::Post(ThreadPoolTask * pTask)
+{
+    if (m_bStopped.load(std::memory_order_relaxed) && tls_pThreadPool != this)
+    {
+        delete pTask;
+        throw libthrocket::ThreadPoolStoppedException(LIBTHROCKET_THROWN_BY, "Post after Stop");
+    }
+
+    // an answer the task sends is then its poster's, as if the poster had sent it
+    pTask->m_pActingFor = Thread::GetActingFor();
+
+    uint32_t                    u32Worker               =   tls_pThreadPool == this ? tls_u32Worker :
+                                                            m_u32NextWorker.fetch_add(1, std::memory_order_relaxed) % m_u32Workers;
+    Push(u32Worker, pTask);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ThreadPool::Dispatch(ThreadMessage * msg, ThreadPoolMessageHandler * pHandler)
+{
+    Post(new ThreadPoolDispatchTask(msg, pHandler));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// counted before it is visible, so a worker never sees a task the count does not cover; a sleeper is only woken if there is
+// one - the count and m_u32Sleeping are each written before the other is read (seq_cst), so one side always sees the other
+void
+libthrocket::ThreadPool::Push(uint32_t u32Worker, ThreadPoolTask * pTask)
+{
+    m_uQueued.fetch_add(1);
+    {
+        Lock                    l(m_vecDeques[u32Worker]->mutex);
+        m_vecDeques[u32Worker]->deq.push_back(pTask);
+    }
+
+    if (m_u32Sleeping.load() > 0)
+    {
+        Lock                    l(m_mutexIdle);
+        m_condIdle.signal();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// newest from our own deque (still warm in cache), else the oldest from the next busy worker along
+libthrocket::ThreadPoolTask *
+libthrocket::ThreadPool::Take(uint32_t u32Worker)
+{
+    ThreadPoolTask            * pTask                   =   NULL;
+
+    {
+        WorkerDeque           & own                     =   *m_vecDeques[u32Worker];
+        Lock                    l(own.mutex);
+        if (own.deq.size() > 0)
+        {
+            pTask = own.deq.back();
+            own.deq.pop_back();
+        }
+    }
+
+    for (uint32_t i = 1; pTask == NULL && i < m_u32Workers; i++)
+    {
+        WorkerDeque           & victim                  =   *m_vecDeques[(u32Worker + i) % m_u32Workers];
+        Lock                    l(victim.mutex);
+        if (victim.deq.size() > 0)
+        {
+            pTask = victim.deq.front();
+            victim.deq.pop_front();
+            m_u64Steals.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    if (pTask != NULL)
+        m_uQueued.fetch_sub(1);
+    return pTask;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ThreadPool::Work(uint32_t u32Worker)
+{
+    ThreadPoolTask            * pTask                   =   Take(u32Worker);
+    if (pTask == NULL)
+    {
+        Sleep();
+        return;
+    }
+
+    try
+    {
+        libthrocket::ThreadActingFor actingFor(pTask->m_pActingFor);
+        pTask->Run();
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        e.LogError(LIBTHROCKET_CAUGHT_BY);
+    }
+    catch (const std::exception & e)
+    {
+        LOGWARNING("POOL> task threw std::exception: %s", e.what());
+    }
+    catch (...)
+    {
+        // anything else would end this worker and quietly shrink the pool
+        LOGWARNING("POOL> task threw an unknown exception");
+    }
+    delete pTask;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the timed block only matters for a stop request; Push() wakes us for work
+void
+libthrocket::ThreadPool::Sleep()
+{
+    Lock                        l(m_mutexIdle);
+    m_u32Sleeping.fetch_add(1);
+    if (m_uQueued.load() == 0 && m_bStopped.load() == false)
+        m_condIdle.blockTimed(m_mutexIdle, THREAD_POOL_POLL);
+    m_u32Sleeping.fetch_sub(1);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::ThreadPool::Stop()
+{
+    m_bStopped.store(true);
+    {
+        Lock                    l(m_mutexIdle);
+        m_condIdle.broadcast();
+    }
+    Infanticide();
+}
+
+//============================================================================================================================= 132
@@ -0,0 +1,294 @@
+//============================================================================================================================= 132
+//
+//  ThreadRingQueue.cc
+//
+//      Bounded lock-free ThreadQueue for high-rate thread pipelines.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <sched.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "ThreadRingQueue.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadRingQueue::ThreadRingQueue(eProducers eMode, uint32_t u32Capacity)  :
+    m_eMode(eMode),
+    m_u32Capacity(2),
+    m_u32Spin(sysconf(_SC_NPROCESSORS_ONLN) > 1 ? THREAD_RING_SPIN : 0),
+    m_u64Tail(0),
+    m_u64Head(0),
+    m_bSleeping(false)
+{
+    while (m_u32Capacity < u32Capacity && m_u32Capacity < 0x80000000)
+        m_u32Capacity <<= 1;
+    m_u64Mask = m_u32Capacity - 1;
+
+    m_pSlots = new Slot [m_u32Capacity];
+    for (uint32_t i = 0; i < m_u32Capacity; i++)
+    {
+        m_pSlots[i].u64Sequence.store(i, std::memory_order_relaxed);
+        m_pSlots[i].pMessage = NULL;
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadRingQueue::~ThreadRingQueue()
+{
+    ThreadMessage             * msg;
+    while ((msg = Take()) != NULL)
+        Discard(msg);
+    delete [] m_pSlots;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the slot at the tail is free when its sequence has come round to the tail position; one behind means the consumer has not
+// taken last lap's message yet, i.e. the ring is full
+bool
+libthrocket::ThreadRingQueue::Publish(ThreadMessage * msg)
+{
+    uint64_t                    u64Pos                  =   m_u64Tail.load(std::memory_order_relaxed);
+    Slot                      * pSlot;
+
+    while (1)
+    {
+        pSlot = &m_pSlots[u64Pos & m_u64Mask];
+        int64_t                 i64Diff                 =   (int64_t) (pSlot->u64Sequence.load(std::memory_order_acquire) - u64Pos);
+        if (i64Diff < 0)
+            return false;
+
+        if (m_eMode == eSingleProducer)
+        {
+            m_u64Tail.store(u64Pos + 1, std::memory_order_relaxed);
+            break;
+        }
+        // another producer got here first - on failure u64Pos is reloaded with where it got to
+        if (i64Diff == 0 && m_u64Tail.compare_exchange_weak(u64Pos, u64Pos + 1, std::memory_order_relaxed))
+            break;
+        if (i64Diff > 0)
+            u64Pos = m_u64Tail.load(std::memory_order_relaxed);
+    }
+
+    pSlot->pMessage = msg;
+    pSlot->u64Sequence.store(u64Pos + 1, std::memory_order_release);
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+bool
+libthrocket::ThreadRingQueue::tryPut(ThreadMessage * msg)
+{
+    if (Publish(msg) == false)
+        return false;
+    Wake();
+    return true;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a full ring means the consumer is behind - give it the CPU first, then stop burning ours
+void
+libthrocket::ThreadRingQueue::put(ThreadMessage * msg)
+{
+    for (uint32_t u32Tries = 0; tryPut(msg) == false; u32Tries++)
+    {
+        if (u32Tries < THREAD_RING_FULL_YIELDS)
+            sched_yield();
+        else
+            usleep(THREAD_RING_FULL_WAIT);
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// one wakeup check for the burst - plus one before waiting for room, so the consumer is not left asleep on what is already in
+void
+libthrocket::ThreadRingQueue::putBatch(ThreadMessage ** ppMsgs, size_t uCount)
+{
+    for (size_t i = 0; i < uCount; i++)
+    {
+        if (Publish(ppMsgs[i]))
+            continue;
+
+        Wake();
+        put(ppMsgs[i]);
+    }
+    if (uCount > 0)
+        Wake();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the consumer's store to m_bSleeping and a producer's publish are each followed by a full fence before the other side is
+// looked at, so at least one of them sees the other: either the consumer finds the message, or the producer finds it asleep
+// and signals under the mutex it is blocked on
+void
+libthrocket::ThreadRingQueue::Wake()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_bSleeping.load(std::memory_order_relaxed))
+    {
+        Lock                    l(m_mutex);
+        m_cond.signal();
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadMessage *
+libthrocket::ThreadRingQueue::Take()
+{
+    uint64_t                    u64Pos                  =   m_u64Head.load(std::memory_order_relaxed);
+    Slot                      * pSlot                   =   &m_pSlots[u64Pos & m_u64Mask];
+
+    if (pSlot->u64Sequence.load(std::memory_order_acquire) != u64Pos + 1)
+        return NULL;
+
+    ThreadMessage             * msg                     =   pSlot->pMessage;
+    pSlot->pMessage = NULL;
+    pSlot->u64Sequence.store(u64Pos + m_u32Capacity, std::memory_order_release);
+    m_u64Head.store(u64Pos + 1, std::memory_order_relaxed);
+    return msg;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::ThreadRingQueue::TakeBatch(ThreadMessage ** ppMsgs, size_t uMax)
+{
+    size_t                      uCount                  =   0;
+    while (uCount < uMax && (ppMsgs[uCount] = Take()) != NULL)
+        uCount++;
+    return uCount;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::ThreadRingQueue::getBatch(ThreadMessage ** ppMsgs, size_t uMax)
+{
+    if (uMax < 1)
+        return 0;
+    ppMsgs[0] = Park(NULL);
+    return 1 + TakeBatch(ppMsgs + 1, uMax - 1);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::ThreadRingQueue::getBatch(ThreadMessage ** ppMsgs, size_t uMax, uint32_t u32USec)
+{
+    if (uMax < 1)
+        return 0;
+    if ((ppMsgs[0] = getTimed(u32USec)) == NULL)
+        return 0;
+    return 1 + TakeBatch(ppMsgs + 1, uMax - 1);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadMessage *
+libthrocket::ThreadRingQueue::Park(struct timespec * pts)
+{
+    ThreadMessage             * msg;
+
+    // a busy producer usually has the next message along within a few hundred nanoseconds
+    for (uint32_t i = 0; i < m_u32Spin; i++)
+    {
+        if ((msg = Take()) != NULL)
+            return msg;
+        CPURelax();
+    }
+
+    Lock                        l(m_mutex);
+    while (1)
+    {
+        m_bSleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((msg = Take()) != NULL)
+            break;
+
+        if (pts == NULL)
+        {
+            m_cond.block(m_mutex);
+        } else if (m_cond.blockTimed(m_mutex, pts) == Condition::eBlockTimedOut)
+        {
+            msg = Take();
+            break;
+        }
+    }
+    m_bSleeping.store(false, std::memory_order_relaxed);
+
+    return msg;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::ThreadMessage *
+libthrocket::ThreadRingQueue::getTimed(uint32_t u32USec)
+{
+    if (u32USec == 0)
+        return Take();
+
+    struct timeval              tv;
+    struct timespec             ts;
+    gettimeofday(&tv, NULL);
+    tv.tv_sec  += u32USec / 1000000;
+    tv.tv_usec += u32USec % 1000000;
+    if (tv.tv_usec >= 1000000)
+    {
+        tv.tv_sec  += 1;
+        tv.tv_usec -= 1000000;
+    }
+    ts.tv_sec  = tv.tv_sec;
+    ts.tv_nsec = tv.tv_usec * 1000;
+
+    return Park(&ts);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+size_t
+libthrocket::ThreadRingQueue::size()
+{
+    uint64_t                    u64Head                 =   m_u64Head.load(std::memory_order_relaxed);
+    uint64_t                    u64Tail                 =   m_u64Tail.load(std::memory_order_relaxed);
+
+    // claimed-but-not-yet-published slots count; a stale head can make the difference briefly exceed the ring
+    if (u64Tail <= u64Head)
+        return 0;
+    return u64Tail - u64Head > m_u32Capacity ? m_u32Capacity : u64Tail - u64Head;
+}
+
+//============================================================================================================================= 132
@@ -0,0 +1,716 @@
+//============================================================================================================================= 132
+//
+//  UnixSocket.cc
+//
+//      AF_UNIX stream, accept and datagram sockets, with SCM_RIGHTS descriptor passing.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <errno.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+
+#include "AlarmDebugLog.h"
+#include "SocketInternal.h"
+#include "UnixSocket.h"
+
+using namespace std;
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// room for UNIX_SOCKET_MAX_FDS descriptors, aligned as CMSG_FIRSTHDR() wants
+union UnixControl
+{
+    uint8_t                     au8[CMSG_SPACE(UNIX_SOCKET_MAX_FDS * sizeof(int))];
+    struct cmsghdr              cmsg;
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::UnixSocket::~UnixSocket()
+{
+    // ~Socket() would only reach Socket::LockedClose() and leave the file behind
+    LockedClose();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixSocket::EncodePath(const string& strPath, struct sockaddr_un& sun, socklen_t& slen)
+{
+    if (strPath.size() < 1 || strPath.size() >= sizeof(sun.sun_path))
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "path length " + std::to_string(strPath.size()) + " " + strPath);
+
+    memset(&sun, 0, sizeof(sun));
+    sun.sun_family = AF_UNIX;
+    memcpy(sun.sun_path, strPath.data(), strPath.size());
+
+    // abstract names are counted bytes, not NUL terminated
+    if (strPath[0] == '@')
+    {
+        sun.sun_path[0] = '\0';
+        slen = offsetof(struct sockaddr_un, sun_path) + strPath.size();
+    } else
+    {
+        slen = offsetof(struct sockaddr_un, sun_path) + strPath.size() + 1;
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::UnixSocket::DecodePath(const struct sockaddr_un& sun, socklen_t slen)
+{
+    if (slen <= offsetof(struct sockaddr_un, sun_path) || sun.sun_family != AF_UNIX)
+        return "";
+
+    size_t                      uLen                    =   slen - offsetof(struct sockaddr_un, sun_path);
+    if (uLen > sizeof(sun.sun_path))
+        uLen = sizeof(sun.sun_path);
+    if (sun.sun_path[0] == '\0')
+        return '@' + string(sun.sun_path + 1, uLen - 1);
+    return string(sun.sun_path, strnlen(sun.sun_path, uLen));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixSocket::LockedOpen()
+{
+    if (m_nSocket == INVALID_SOCKET)
+    {
+        LockedSetFD(socket(AF_UNIX, m_nSocketType | SOCK_CLOEXEC, 0));
+        if (m_nSocket == INVALID_SOCKET)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "socket " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> open: %d got fd",
+        LockedGetFD());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a socket file outlives its process, so a restart after a crash finds the path taken - only a refused connect proves
+// nobody is behind it, and only then is the file replaced; the probe never waits, a live listener with a full backlog
+// answers EAGAIN and counts as in use
+void
+libthrocket::UnixSocket::LockedBind(const string& strPath, int nListenLen)
+{
+    struct sockaddr_un          sun;
+    socklen_t                   slen;
+
+    EncodePath(strPath, sun, slen);
+    LockedOpen();
+
+    int                         nRC                     =   bind(m_nSocket, (struct sockaddr*) &sun, slen);
+    if (nRC != 0 && GetLastError() == EADDRINUSE && strPath[0] != '@')
+    {
+        struct stat             st;
+        int                     nProbe                  =   socket(AF_UNIX, m_nSocketType | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        bool                    bStale                  =   stat(strPath.c_str(), &st) == 0 && S_ISSOCK(st.st_mode) &&
+                                                            nProbe != INVALID_SOCKET &&
+                                                            connect(nProbe, (struct sockaddr*) &sun, slen) != 0 &&
+                                                            GetLastError() == ECONNREFUSED;
+        if (nProbe != INVALID_SOCKET)
+            close(nProbe);
+        if (bStale == false)
+            throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "bind " + strPath + " in use");
+
+        LOGWARNING("UNX> bind: %d (%s) replacing stale socket file", LockedGetFD(), strPath.c_str());
+        unlink(strPath.c_str());
+        nRC = bind(m_nSocket, (struct sockaddr*) &sun, slen);
+    }
+    if (nRC != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketBindException(LIBTHROCKET_THROWN_BY, "bind " + strPath + " " + std::to_string(nSaveErrno) +
+                                                   " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+    if (strPath[0] != '@')
+        m_strBoundPath = strPath;
+
+    if (m_nSocketType == SOCK_STREAM && listen(m_nSocket, nListenLen) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "listen " + strPath + " " + std::to_string(nSaveErrno) +
+                                                  " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> bind: %d (%s) bound",
+        LockedGetFD(), strPath.c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixSocket::LockedClose()
+{
+    if (m_strBoundPath.size() > 0)
+    {
+        unlink(m_strBoundPath.c_str());
+        m_strBoundPath.clear();
+    }
+    Socket::LockedClose();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::UnixSocket::LockedGetLocalPath()
+{
+    struct sockaddr_un          sun;
+    socklen_t                   slen                    =   sizeof(sun);
+    memset(&sun, 0, sizeof(sun));
+    if (getsockname(m_nSocket, (struct sockaddr*) &sun, &slen) == -1)
+        return "";
+    return DecodePath(sun, slen);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+const string
+libthrocket::UnixSocket::LockedGetPeerPath()
+{
+    struct sockaddr_un          sun;
+    socklen_t                   slen                    =   sizeof(sun);
+    memset(&sun, 0, sizeof(sun));
+    if (getpeername(m_nSocket, (struct sockaddr*) &sun, &slen) == -1)
+        return "";
+    return DecodePath(sun, slen);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixSocket::LockedGetPeerCredentials(pid_t& pid, uid_t& uid, gid_t& gid)
+{
+    struct ucred                cred;
+    socklen_t                   slen                    =   sizeof(cred);
+
+    if (getsockopt(m_nSocket, SOL_SOCKET, SO_PEERCRED, &cred, &slen) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, "getsockopt FD " + std::to_string(m_nSocket) + " SO_PEERCRED " +
+                                                  std::to_string(nSaveErrno) + " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+    pid = cred.pid;
+    uid = cred.uid;
+    gid = cred.gid;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixSocket::PackFDs(struct msghdr* pmsg, uint8_t* pu8Control, const int* pnFDs, uint32_t u32FDs)
+{
+    if (u32FDs > UNIX_SOCKET_MAX_FDS || (u32FDs > 0 && pnFDs == NULL))
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "u32FDs " + std::to_string(u32FDs));
+
+    if (u32FDs < 1)
+    {
+        pmsg->msg_control    = NULL;
+        pmsg->msg_controllen = 0;
+        return;
+    }
+
+    pmsg->msg_control    = pu8Control;
+    pmsg->msg_controllen = CMSG_SPACE(u32FDs * sizeof(int));
+
+    struct cmsghdr            * pcmsg                   =   CMSG_FIRSTHDR(pmsg);
+    pcmsg->cmsg_level = SOL_SOCKET;
+    pcmsg->cmsg_type  = SCM_RIGHTS;
+    pcmsg->cmsg_len   = CMSG_LEN(u32FDs * sizeof(int));
+    memcpy(CMSG_DATA(pcmsg), pnFDs, u32FDs * sizeof(int));
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// a descriptor we cannot hand back would otherwise leak into this process for good
+void
+libthrocket::UnixSocket::UnpackFDs(struct msghdr* pmsg, int* pnFDs, uint32_t& u32FDs)
+{
+    uint32_t                    u32Room                 =   u32FDs;
+
+    u32FDs = 0;
+    if (pmsg->msg_controllen < 1)
+        return;
+
+    for (struct cmsghdr* pcmsg = CMSG_FIRSTHDR(pmsg); pcmsg != NULL; pcmsg = CMSG_NXTHDR(pmsg, pcmsg))
+    {
+        if (pcmsg->cmsg_level != SOL_SOCKET || pcmsg->cmsg_type != SCM_RIGHTS)
+            continue;
+
+        uint32_t                u32Count                =   (pcmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        for (uint32_t i = 0; i < u32Count; i++)
+        {
+            int                 nFD;
+            memcpy(&nFD, CMSG_DATA(pcmsg) + i * sizeof(int), sizeof(int));
+            if (u32FDs < u32Room)
+                pnFDs[u32FDs++] = nFD;
+            else
+                close(nFD);
+        }
+    }
+
+    if (u32FDs < u32Room && (pmsg->msg_flags & MSG_CTRUNC) != 0)
+        LOGWARNING("UNX> recv: descriptors truncated by the kernel");
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the caller's msghdr is worked on in place - iovecs advance over partial transfers
+uint32_t
+libthrocket::UnixSocket::LockedTransferMsg(bool bDirection, struct msghdr* pmsg, bool bShort)
+{
+    ssize_t                     nRC                     =   0;
+    const char*                 pcFunc                  =   bDirection == SOCKET_TRANSFER_RECV ? "recvmsg" : "sendmsg";
+    bool                        bWantRead               =   bDirection == SOCKET_TRANSFER_RECV;
+    bool                        bWantWrite              =   bDirection == SOCKET_TRANSFER_SEND;
+    int64_t                     i64Timeout              =   bDirection == SOCKET_TRANSFER_RECV ? LockedGetRecvTimeout() :
+                                                                                                 LockedGetSendTimeout();
+    // no SIGPIPE for a vanished peer - it is an EPIPE exception like any other failure
+    int                         nFlags                  =   bDirection == SOCKET_TRANSFER_RECV ? MSG_CMSG_CLOEXEC : MSG_NOSIGNAL;
+    uint64_t                    u64Bytes                =   0;
+    uint32_t                    u32BytesTransferred     =   0;
+    bool                        bTryFirst               =   m_bOptimisticIO;
+    void                      * pControl                =   pmsg->msg_control;
+    size_t                      uControlLen             =   0;
+
+    for (size_t i = 0; i < pmsg->msg_iovlen; i++)
+        u64Bytes += pmsg->msg_iov[i].iov_len;
+    if (u64Bytes > UINT32_MAX)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "bytes " + std::to_string(u64Bytes));
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> %s: %d (%s) %lu bytes TO %ld uS",
+        pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), u64Bytes, i64Timeout);
+
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64Timeout;
+    while (1)
+    {
+        if (bTryFirst == false)
+            LockedWait(bWantRead, bWantWrite, i64Expire - i64Now);
+
+        if (bDirection == SOCKET_TRANSFER_SEND)
+            nRC = sendmsg(LockedGetFD(), pmsg, nFlags | (bTryFirst ? MSG_DONTWAIT : 0));
+        else
+            nRC = recvmsg(LockedGetFD(), pmsg, nFlags | (bTryFirst ? MSG_DONTWAIT : 0));
+
+        if (nRC < 0)
+        {
+            int                 nSaveErrno              =   GetLastError();
+            if ((nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK) && bTryFirst)
+            {
+                bTryFirst = false;
+                continue;
+            }
+            if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            {
+                if (i64Timeout < 1 && u32BytesTransferred > 0)
+                    break;
+                if (i64Timeout < 1)
+                    throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString());
+                i64Now = TimeuS64();
+                if (i64Now >= i64Expire)
+                    throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " +
+                                                      std::to_string(LockedGetFD()) + " " + LockedGetPeerAddrString() + " timeout");
+                continue;
+            }
+            throw libthrocket::SocketSysException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " +
+                                                      LockedGetPeerAddrString() + " " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+        }
+
+        LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+            "UNX> %s: %d (%s) %zd bytes",
+            pcFunc, LockedGetFD(), LockedGetPeerAddrString().c_str(), nRC);
+
+        // descriptors went (or came) with this call and must not go again
+        if (pmsg->msg_control != NULL)
+        {
+            uControlLen = bDirection == SOCKET_TRANSFER_RECV ? pmsg->msg_controllen : 0;
+            pmsg->msg_control    = NULL;
+            pmsg->msg_controllen = 0;
+        }
+
+        // end of stream, or a datagram - which is whole or nothing
+        if (nRC == 0 || m_nSocketType != SOCK_STREAM)
+        {
+            u32BytesTransferred += nRC;
+            if (m_nSocketType != SOCK_STREAM && (pmsg->msg_flags & MSG_TRUNC) != 0)
+                LOGWARNING("UNX> %s: %d datagram truncated to %zd bytes", pcFunc, LockedGetFD(), nRC);
+            break;
+        }
+
+        u64Bytes            -=  nRC;
+        u32BytesTransferred +=  nRC;
+
+        // step over whatever has been fully transferred
+        size_t                  uDone                   =   nRC;
+        while (pmsg->msg_iovlen > 0 && uDone >= pmsg->msg_iov->iov_len)
+        {
+            uDone -= pmsg->msg_iov->iov_len;
+            pmsg->msg_iov++;
+            pmsg->msg_iovlen--;
+        }
+        if (uDone > 0)
+        {
+            pmsg->msg_iov->iov_base  = (uint8_t*) pmsg->msg_iov->iov_base + uDone;
+            pmsg->msg_iov->iov_len  -= uDone;
+        }
+        bTryFirst = false;
+
+        if (bShort || u64Bytes < 1)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, string(pcFunc) + " " + std::to_string(LockedGetFD()) + " " +
+                                                    LockedGetPeerAddrString() + " timeout");
+    }
+
+    pmsg->msg_control    = uControlLen > 0 ? pControl : NULL;
+    pmsg->msg_controllen = uControlLen;
+
+    return u32BytesTransferred;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixStreamSocket::LockedConnect(const string& strPath)
+{
+    struct sockaddr_un          sun;
+    socklen_t                   slen;
+
+    if (m_nSocket != INVALID_SOCKET)
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "m_nSocket != INVALID_SOCKET");
+
+    EncodePath(strPath, sun, slen);
+    LockedOpen();
+
+    try
+    {
+        LockedSetNonBlocking();
+    }
+    catch (const libthrocket::Exception & e)
+    {
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, e.GetDetail());
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> conn: %d (%s)",
+        LockedGetFD(), strPath.c_str());
+
+    // a local connect either completes at once or finds the backlog full (EAGAIN) - there is no EINPROGRESS to wait out,
+    // and a listener never reports itself writable; rather than sleep and retry under the lock, the caller is told to
+    // back off and Connect() again
+    while (connect(m_nSocket, (struct sockaddr*) &sun, slen) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        if (nSaveErrno == EINTR)
+            continue;
+        LockedClose();
+        if (nSaveErrno == EAGAIN)
+            throw libthrocket::SocketWouldBlockException(LIBTHROCKET_THROWN_BY, "connect: " + strPath + " backlog full");
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + strPath + " " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+    m_bConnected = true;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> conn: %d (%s) success",
+        LockedGetFD(), strPath.c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixStreamSocket::LockedTransfer(bool bDirection, uint8_t* pu8Bytes, uint32_t u32Bytes, bool bShort)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+
+    iov.iov_base = pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+
+    return LockedTransferMsg(bDirection, &msg, bShort);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixStreamSocket::LockedRecvAll(uint8_t* pu8Bytes, uint32_t u32Bytes)
+{
+    uint32_t                    u32Total                =   0;
+
+    while (u32Total < u32Bytes)
+    {
+        uint32_t                u32RC                   =   LockedTransfer(SOCKET_TRANSFER_RECV, pu8Bytes + u32Total, u32Bytes - u32Total,
+                                                                           true/*bShort*/);
+        if (u32RC == 0)
+            break;
+        u32Total += u32RC;
+    }
+
+    return u32Total;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixStreamSocket::LockedSendFDs(const uint8_t* pu8Bytes, uint32_t u32Bytes, const int* pnFDs, uint32_t u32FDs)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+    UnixControl                 control;
+
+    if (pu8Bytes == NULL || u32Bytes < 1)
+        throw libthrocket::SocketParamException(LIBTHROCKET_THROWN_BY, "descriptors need at least one byte to ride with");
+
+    iov.iov_base = (void*) pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    PackFDs(&msg, control.au8, pnFDs, u32FDs);
+
+    return LockedTransferMsg(SOCKET_TRANSFER_SEND, &msg, false/*bShort*/);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixStreamSocket::LockedRecvFDs(uint8_t* pu8Bytes, uint32_t u32Bytes, int* pnFDs, uint32_t& u32FDs)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+    UnixControl                 control;
+
+    iov.iov_base = pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov         = &iov;
+    msg.msg_iovlen      = 1;
+    msg.msg_control     = control.au8;
+    msg.msg_controllen  = sizeof(control.au8);
+
+    uint32_t                    u32RC                   =   LockedTransferMsg(SOCKET_TRANSFER_RECV, &msg, true/*bShort*/);
+    UnpackFDs(&msg, pnFDs, u32FDs);
+    return u32RC;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// the listen socket is non-blocking so that a connection taken by another thread between poll() and accept() cannot block us
+void
+libthrocket::UnixAcceptSocket::LockedBind(const string& strPath, int nListenLen)
+{
+    UnixSocket::LockedBind(strPath, nListenLen);
+    LockedSetNonBlocking();
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int
+libthrocket::UnixAcceptSocket::LockedAcceptFD(int nFlags)
+{
+    while (1)
+    {
+        int                     nFD                     =   accept4(m_nSocket, NULL, NULL, nFlags);
+        if (nFD != INVALID_SOCKET)
+            return nFD;
+
+        int                     nSaveErrno              =   GetLastError();
+        if (nSaveErrno == EAGAIN || nSaveErrno == EWOULDBLOCK)
+            return INVALID_SOCKET;
+        if (nSaveErrno == ECONNABORTED || nSaveErrno == EINTR)
+            continue;
+
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "accept4: " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::UnixStreamSocket *
+libthrocket::UnixAcceptSocket::LockedAccept(int64_t i64AcceptTimeout)
+{
+    int                         nFD;
+    int64_t                     i64Now                  =   TimeuS64();
+    int64_t                     i64Expire               =   i64Now + i64AcceptTimeout;
+    while (1)
+    {
+        LockedWait(true/*bWantRead*/, false/*bWantWrite*/, i64Expire - i64Now);
+
+        nFD = LockedAcceptFD(SOCK_CLOEXEC);
+        if (nFD != INVALID_SOCKET)
+            break;
+
+        i64Now = TimeuS64();
+        if (i64Now >= i64Expire)
+            throw libthrocket::SocketTimeoutException(LIBTHROCKET_THROWN_BY, "accept " + LockedGetLocalPath());
+    }
+
+    UnixStreamSocket          * pSock                   =   new UnixStreamSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout);
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> acpt: %d (%s)",
+        nFD, LockedGetLocalPath().c_str());
+
+    return pSock;
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+libthrocket::UnixStreamSocket *
+libthrocket::UnixAcceptSocket::LockedAcceptNonBlocking()
+{
+    int                         nFD                     =   LockedAcceptFD(SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (nFD == INVALID_SOCKET)
+        return NULL;
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> acpt: %d (%s) non-blocking",
+        nFD, LockedGetLocalPath().c_str());
+
+    return new UnixStreamSocket(nFD, m_i64RecvTimeout, m_i64SendTimeout);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+void
+libthrocket::UnixDatagramSocket::LockedConnect(const string& strPath)
+{
+    struct sockaddr_un          sun;
+    socklen_t                   slen;
+
+    EncodePath(strPath, sun, slen);
+    LockedOpen();
+
+    if (connect(m_nSocket, (struct sockaddr*) &sun, slen) != 0)
+    {
+        int                     nSaveErrno              =   GetLastError();
+        throw libthrocket::SocketConnectException(LIBTHROCKET_THROWN_BY, "connect: " + strPath + " " + std::to_string(nSaveErrno) +
+                                                      " (" + SocketErrorString(nSaveErrno) + ")");
+    }
+
+    LOGDEBUG(ADL_DMSK_SCK, ADL_DLVL_HIGH,
+        "UNX> conn: %d (%s) datagram",
+        LockedGetFD(), strPath.c_str());
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixDatagramSocket::LockedSend
+(
+    const string&               strPath,
+    const uint8_t*              pu8Bytes,
+    uint32_t                    u32Bytes,
+    const int*                  pnFDs,
+    uint32_t                    u32FDs
+)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+    struct sockaddr_un          sun;
+    socklen_t                   slen                    =   0;
+    UnixControl                 control;
+
+    // sending is the first thing an unbound client does
+    LockedOpen();
+
+    iov.iov_base = (void*) pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    if (strPath.size() > 0)
+    {
+        EncodePath(strPath, sun, slen);
+        msg.msg_name    = &sun;
+        msg.msg_namelen = slen;
+    }
+    PackFDs(&msg, control.au8, pnFDs, u32FDs);
+
+    return LockedTransferMsg(SOCKET_TRANSFER_SEND, &msg, true/*bShort*/);
+}
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+uint32_t
+libthrocket::UnixDatagramSocket::LockedRecv
+(
+    string&                     strPath,
+    uint8_t*                    pu8Bytes,
+    uint32_t                    u32Bytes,
+    int*                        pnFDs,
+    uint32_t*                   pu32FDs
+)
+{
+    struct iovec                iov;
+    struct msghdr               msg;
+    struct sockaddr_un          sun;
+    UnixControl                 control;
+
+    iov.iov_base = pu8Bytes;
+    iov.iov_len  = u32Bytes;
+    memset(&msg, 0, sizeof(msg));
+    memset(&sun, 0, sizeof(sun));
+    msg.msg_name    = &sun;
+    msg.msg_namelen = sizeof(sun);
+    msg.msg_iov     = &iov;
+    msg.msg_iovlen  = 1;
+    if (pu32FDs != NULL)
+    {
+        msg.msg_control     = control.au8;
+        msg.msg_controllen  = sizeof(control.au8);
+    }
+
+    uint32_t                    u32RC                   =   LockedTransferMsg(SOCKET_TRANSFER_RECV, &msg, true/*bShort*/);
+    strPath = DecodePath(sun, msg.msg_namelen);
+    if (pu32FDs != NULL)
+        UnpackFDs(&msg, pnFDs, *pu32FDs);
+    return u32RC;
+}
+
+//============================================================================================================================= 132
@@ -0,0 +1,126 @@
+//============================================================================================================================= 132
+//
+//  ResolverTest.cc
+//
+//      Resolv() - the process-wide Resolver - against a stub ResolverSource: a name is looked up once and then answered
+//      from the cache without waiting on a lookup thread, addresses pass straight through, and "no such host" throws.
+//      Exits non-zero on the first failure.
+//
+//  COLUMNS 132 TABSTOP 4 SPACE-FILL
+//
+//============================================================================================================================= 132
+
+/* ============================================================================
+
+Copyright 1998-2022 Jack Bates
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the “Software”), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+============================================================================ */
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+#include <atomic>
+#include <iostream>
+
+#include "Resolver.h"
+
+using namespace std;
+
+#define CHECK(b)                                                                                                            \
+    do { if ((b) == false) { cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #b ") failed" << endl; return 1; } } while (0)
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+// two pinned names, counting how often it is asked
+class StubSource            :   public libthrocket::ResolverSource
+{
+    public:
+                                StubSource()    :
+                                    m_uLookups(0)
+                                {}
+
+        virtual bool            Lookup(const string& strHostname, vector<string>& vecIPAddrs, int64_t& i64TTL)
+                                {
+                                    (void) i64TTL;
+                                    m_uLookups++;
+                                    if (strHostname == "alpha.test")
+                                        vecIPAddrs.push_back("192.0.2.1");
+                                    else if (strHostname == "beta.test")
+                                        vecIPAddrs.push_back("2001:db8::2");
+                                    return vecIPAddrs.size() > 0;
+                                }
+
+        std::atomic<size_t>     m_uLookups;
+};
+
+//------------------------------=-----------------------=---------------------------------------------------------------------- 132
+//
+int main()
+{
+    static StubSource           source;
+
+    libthrocket::SetResolvSource(&source);
+
+    // first time through a lookup thread; after that the cached answer, with no lookup and no wait
+    CHECK(libthrocket::Resolv("alpha.test") == "192.0.2.1");
+    CHECK(source.m_uLookups == 1);
+    CHECK(libthrocket::Resolv("alpha.test") == "192.0.2.1");
+    CHECK(libthrocket::Resolv("ALPHA.test") == "192.0.2.1");
+    CHECK(source.m_uLookups == 1);
+
+    CHECK(libthrocket::Resolv("beta.test") == "2001:db8::2");
+    CHECK(source.m_uLookups == 2);
+
+    // address literals never reach the source
+    CHECK(libthrocket::Resolv("198.51.100.7") == "198.51.100.7");
+    CHECK(source.m_uLookups == 2);
+
+    // no such host - thrown, then answered from the negative cache
+    for (int i = 0; i < 2; i++)
+    {
+        bool                    bThrown                 =   false;
+        try
+        {
+            libthrocket::Resolv("gamma.test");
+        }
+        catch (const libthrocket::ResolvLookupException & e)
+        {
+            bThrown = true;
+        }
+        CHECK(bThrown);
+    }
+    CHECK(source.m_uLookups == 3);
+
+    // the Resolver has already taken its source
+    bool                        bThrown                 =   false;
+    try
+    {
+        libthrocket::SetResolvSource(NULL);
+    }
+    catch (const libthrocket::ResolvParamException & e)
+    {
+        bThrown = true;
+    }
+    CHECK(bThrown);
+
+    cout << "ResolverTest: ok" << endl;
+    return 0;
+}
+
+//============================================================================================================================= 132